@@ -1,38 +1,84 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <getopt.h>
 
 #include "assembler.h"
 #include "symbol_table.h"
+#include "image_writer.h"
+#include "line_table.h"
 
-// Expected command-line arguments: paths to input .s file & output .bin file
-#define NUM_EXPECTED_ARGUMENTS 3
+// Expected positional arguments: paths to input .s file & output .bin file
+#define NUM_POSITIONAL_ARGUMENTS 2
 // Initial symbol table capacity
 #define INITIAL_TABLE_CAPACITY 10
+// Initial line table capacity
+#define INITIAL_LINES_CAPACITY 64
+
+/**
+ * Represents the identifiers of the long-only options
+ */
+enum {
+    SEGMENTED_OPTION = 256,
+    MAP_OPTION,
+};
+
+/**
+ * Defines the long options accepted by the assembler
+ */
+static struct option longOptions[] = {
+    {"segmented", no_argument, NULL, SEGMENTED_OPTION},
+    {"map", required_argument, NULL, MAP_OPTION},
+    {NULL, 0, NULL, 0},
+};
 
 /**
  * The entry point of the two-pass assembler program.
  * Opens the assembly source file and binary output file, initialises the symbol
  * table (which maps labels to memory addresses) and runs the 1st and 2nd passes
  * over the assembly file.
+ * With --segmented, writes a segmented image (see image_format.h) instead of a
+ * flat image. With --map, also writes a symbol map of the labels (see
+ * write_symbols) and of the source line of each instruction (see
+ * write_lines), from which the emulator reports addresses by label and
+ * coverage by source line.
  * Exits the program if an error occurs at any point.
  */
 int main(int argc, char **argv) {
-    // Exits the program if the argument count is invalid
-    if (argc != NUM_EXPECTED_ARGUMENTS) {
-        fprintf(stderr, "%s\n", "Usage: ./assemble <input_path> <output_path>");
+    // Parses the options - any option other than --segmented or --map is
+    // invalid
+    bool segmented = false;
+    char *map_path = NULL;
+    bool valid = true;
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        if (option == SEGMENTED_OPTION) {
+            segmented = true;
+        } else if (option == MAP_OPTION) {
+            map_path = optarg;
+        } else {
+            valid = false;
+        }
+    }
+
+    // Exits the program if the options or argument count are invalid
+    if (!valid || argc - optind != NUM_POSITIONAL_ARGUMENTS) {
+        fprintf(stderr, "%s\n", "Usage: ./assemble [--segmented] [--map <map_path>] <input_path> <output_path>");
         return EXIT_FAILURE;
     }
+    char *input_path = argv[optind];
+    char *output_path = argv[optind + 1];
 
-    // Opens input assembly file given by 1st command-line argument in read mode
-    FILE *in = fopen(argv[1] ,"r");
+    // Opens input assembly file given by 1st positional argument in read mode
+    FILE *in = fopen(input_path ,"r");
     if (in == NULL) {
         // Exits the program if null pointer is returned
         perror("Could not open input file");
         return EXIT_FAILURE;
     }
 
-    // Opens output binary file given by 2nd command-line argument in write mode
-    FILE *out = fopen(argv[2], "wb");
+    // Opens output binary file given by 2nd positional argument in write mode
+    FILE *out = fopen(output_path, "wb");
     if (out == NULL) {
         // Exits the program if null pointer is returned
         perror("Could not open output file");
@@ -49,8 +95,33 @@ int main(int argc, char **argv) {
     // Performs the 1st pass over the assembly source code
     first_pass(in, &labels);
 
-    // Performs the 2nd pass over the assembly source code
-    second_pass(in, out, &labels);
+    // Initialises the line table if a symbol map is requested
+    LineTable lines;
+    if (map_path != NULL && initialise_lines(&lines, INITIAL_LINES_CAPACITY) != 0) {
+        perror("Line table could not be initialised");
+        return EXIT_FAILURE;
+    }
+
+    // Performs the 2nd pass over the assembly source code, then completes the
+    // binary image
+    ImageWriter writer;
+    initialise_writer(&writer, out, segmented);
+    second_pass(in, &writer, &labels, map_path == NULL ? NULL : &lines);
+    if (finish_writer(&writer) != 0) {
+        perror("Could not write output file");
+        return EXIT_FAILURE;
+    }
+
+    // Writes the symbol map if requested
+    if (map_path != NULL) {
+        FILE *map = fopen(map_path, "w");
+        if (map == NULL || write_symbols(&labels, map) != 0
+                || write_lines(&lines, input_path, map) != 0 || fclose(map) != 0) {
+            perror("Could not write symbol map");
+            return EXIT_FAILURE;
+        }
+        free_lines(&lines);
+    }
 
     // Frees the dynamically allocated memory used for the symbol table
     free_table(&labels);
@@ -10,12 +10,16 @@
 #include "parser.h"
 #include "encoder.h"
 #include "symbol_table.h"
+#include "image_writer.h"
+#include "line_table.h"
 #include "mnemonics.h"
 #include "../common/utilities.h"
 #include "../common/instructions.h"
 
 #define MAX_LINE_LENGTH 100
 #define INT_DIRECTIVE_STR ".int"
+#define SPACE_DIRECTIVE_STR ".space"
+#define ZERO_DIRECTIVE_STR ".zero"
 
 /**
  * Returns true if a given string is all whitespace
@@ -38,6 +42,19 @@ static bool is_label_def(char *);
  */
 static bool is_int_directive(char *);
 
+/**
+ * Returns true if a given string is a .space or .zero directive (format:
+ * ".space N" or ".zero N")
+ */
+static bool is_space_directive(char *);
+
+/**
+ * Returns the number of words reserved by a .space or .zero directive - its
+ * size in bytes, rounded up to a whole number of words (as every line starts
+ * on a word boundary)
+ */
+static uint32_t get_space_words(char *);
+
 void first_pass(FILE *in, SymbolTable *labels) {
     // Tracks the current line number (ignoring label definitions)
     uint32_t line_num = 0;
@@ -63,6 +80,9 @@ void first_pass(FILE *in, SymbolTable *labels) {
 
                 // Adds the label and its corresponding address to symbol table
                 insert(labels, line, instr_addr);
+            } else if (is_space_directive(line)) {
+                // If line reserves space, skips the words it reserves
+                line_num += get_space_words(line);
             } else {
                 // If line is not a label definition, increments the line count
                 line_num++;
@@ -74,15 +94,24 @@ void first_pass(FILE *in, SymbolTable *labels) {
     fseek(in, 0, SEEK_SET);
 }
 
-int second_pass(FILE *in, FILE *out, SymbolTable *labels) {
+int second_pass(FILE *in, ImageWriter *out, SymbolTable *labels, LineTable *lines) {
     // Tracks the current line number (ignoring label definitions)
     uint32_t line_num = 0;
+    // Tracks the number of the source line being read, which a line too long
+    // for the buffer keeps across reads
+    uint32_t source_num = 0;
+    bool line_start = true;
 
     // Buffer for storing a line of the input file
     char buffer[MAX_LINE_LENGTH];
 
     // Reads the input file line by line
     while (fgets(buffer, MAX_LINE_LENGTH, in) != NULL) {
+        if (line_start) {
+            source_num++;
+        }
+        line_start = strchr(buffer, '\n') != NULL;
+
         // Removes the trailing newline character from the line
         buffer[strcspn(buffer, "\n")] = '\0';
 
@@ -91,8 +120,15 @@ int second_pass(FILE *in, FILE *out, SymbolTable *labels) {
             char *line = buffer;
             line = remove_leading_whitespace(line);
 
-            // Ignores label definitions
-            if (!is_label_def(line)) {
+            if (is_space_directive(line)) {
+                // Writes the zero words reserved by a .space or .zero directive
+                uint32_t num_words = get_space_words(line);
+                if (write_zeros(out, num_words) != 0) {
+                    return -1;
+                }
+                line_num += num_words;
+            } else if (!is_label_def(line)) {
+                // Ignores label definitions
                 // Tokenises the line - returns -1 if tokenisation fails
                 TokenisedString tokenised;
                 if (tokenise(line, &tokenised) != 0) {
@@ -105,6 +141,15 @@ int second_pass(FILE *in, FILE *out, SymbolTable *labels) {
                 if (strcmp(tokenised.tokens[0], NOP_STR) == 0) {
                     // If line is "nop", encodes it directly
                     encoded = NOP_PATTERN;
+                } else if (strcmp(tokenised.tokens[0], HLT_STR) == 0) {
+                    // If line is "hlt #imm", encodes it directly (hlt #0xf000
+                    // is a semihosting call)
+                    int imm;
+                    if (tokenised.num_tokens != 2 || sscanf(tokenised.tokens[1], "#%i", &imm) != 1) {
+                        free_tokens(&tokenised);
+                        return -1;
+                    }
+                    encoded = HLT_PATTERN | (uint32_t) (imm & 0xffff) << HLT_IMM_START;
                 } else if (is_int_directive(line)) {
                     // If line is .int directive, encodes its value directly
                     if (sscanf(tokenised.tokens[1], "0x%x", &encoded) != 1) {
@@ -122,7 +167,18 @@ int second_pass(FILE *in, FILE *out, SymbolTable *labels) {
                 }
 
                 // Writes the encoded instruction to the binary output file
-                fwrite(&encoded, sizeof(uint32_t), 1, out);
+                if (write_word(out, encoded) != 0) {
+                    free_tokens(&tokenised);
+                    return -1;
+                }
+
+                // Records the source line of the instruction (not of a .int
+                // directive, which is data) if requested
+                if (lines != NULL && !is_int_directive(line)
+                        && insert_line(lines, line_num * INSTR_BYTES, source_num) != 0) {
+                    free_tokens(&tokenised);
+                    return -1;
+                }
 
                 // Frees dynamically allocated memory used for token array
                 free_tokens(&tokenised);
@@ -161,4 +217,17 @@ static bool is_label_def(char *line) {
 static bool is_int_directive(char *line) {
     // Checks whether ".int" is present in the line
     return strstr(line, INT_DIRECTIVE_STR) != NULL;
+}
+
+static bool is_space_directive(char *line) {
+    // Checks whether the line starts with ".space" or ".zero"
+    return strncmp(line, SPACE_DIRECTIVE_STR, strlen(SPACE_DIRECTIVE_STR)) == 0
+        || strncmp(line, ZERO_DIRECTIVE_STR, strlen(ZERO_DIRECTIVE_STR)) == 0;
+}
+
+static uint32_t get_space_words(char *line) {
+    // Skips the directive name, then reads the size (decimal or 0x hexadecimal)
+    char *size = line + strcspn(line, " \t");
+    uint64_t num_bytes = strtoull(size, NULL, 0);
+    return (num_bytes + INSTR_BYTES - 1) / INSTR_BYTES;
 }
\ No newline at end of file
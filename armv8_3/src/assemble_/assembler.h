@@ -1,7 +1,11 @@
 #ifndef ASSEMBLER_H
 #define ASSEMBLER_H
 
+#include <stdio.h>
+
 #include "symbol_table.h"
+#include "image_writer.h"
+#include "line_table.h"
 
 /**
  * Performs the 1st pass of the assembler over the source code
@@ -12,12 +16,14 @@ extern void first_pass(FILE *, SymbolTable *);
 
 /**
  * Performs the 2nd pass of the assembler over the source code
- * Reads assembly file line by line and processes all .int directives and
- * instructions
+ * Reads assembly file line by line and processes all .int, .space and .zero
+ * directives and instructions
  * Tokenises, parses and encodes each instruction and writes the result to a
- * given binary file 
+ * given binary image writer
+ * Adds the source line of each instruction to a given line table, unless it
+ * is NULL
  * Returns -1 for failure, 0 for success
  */
-extern int second_pass(FILE *, FILE *, SymbolTable *);
+extern int second_pass(FILE *, ImageWriter *, SymbolTable *, LineTable *);
 
 #endif
\ No newline at end of file
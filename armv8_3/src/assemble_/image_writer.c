@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "image_writer.h"
+#include "../common/image_format.h"
+#include "../common/utilities.h"
+
+// Minimum size in bytes of a run of zero words which becomes a zero segment -
+// shorter runs are kept in the data segment, which is smaller than splitting it
+#define MIN_ZERO_SEGMENT_SIZE 64
+// Initial capacity of the segments and of the data of a segmented image
+#define INITIAL_SEGMENT_CAPACITY 4
+#define INITIAL_DATA_CAPACITY 1024
+
+/**
+ * Adds a segment to a segmented image (extending the last segment instead if
+ * it is of the same type)
+ * Returns 0 if success and -1 otherwise
+ */
+static int add_segment(ImageWriter *, SegmentType, uint32_t, uint32_t);
+
+/**
+ * Appends a given number of bytes (or zero bytes if NULL) to the last data
+ * segment of a segmented image
+ * Returns 0 if success and -1 otherwise
+ */
+static int append_data(ImageWriter *, const void *, uint32_t);
+
+/**
+ * Writes the zero words which have not been written yet - as a zero segment
+ * if there are enough of them (or if they end the image), otherwise as data
+ * Returns 0 if success and -1 otherwise
+ */
+static int flush_zeros(ImageWriter *, bool);
+
+void initialise_writer(ImageWriter *writer, FILE *out, bool segmented) {
+    writer->out = out;
+    writer->segmented = segmented;
+    writer->address = 0;
+    writer->segments = NULL;
+    writer->num_segments = 0;
+    writer->segment_capacity = 0;
+    writer->data = NULL;
+    writer->data_size = 0;
+    writer->data_capacity = 0;
+    writer->zero_address = 0;
+}
+
+int write_word(ImageWriter *writer, uint32_t word) {
+    if (!writer->segmented) {
+        writer->address += INSTR_BYTES;
+        return fwrite(&word, sizeof(uint32_t), 1, writer->out) == 1 ? 0 : -1;
+    }
+    if (word == 0) {
+        return write_zeros(writer, 1);
+    }
+    if (flush_zeros(writer, false) != 0) {
+        return -1;
+    }
+    writer->address += INSTR_BYTES;
+    writer->zero_address = writer->address;
+    return append_data(writer, &word, sizeof(uint32_t));
+}
+
+int write_zeros(ImageWriter *writer, uint32_t num_words) {
+    if (!writer->segmented) {
+        uint32_t zero = 0;
+        for (uint32_t i = 0; i < num_words; i++) {
+            if (write_word(writer, zero) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    // Zero words are only written once the run of them ends
+    writer->address += num_words * INSTR_BYTES;
+    return 0;
+}
+
+int finish_writer(ImageWriter *writer) {
+    int result = 0;
+    if (writer->segmented) {
+        ImageHeader header = { .num_segments = 0 };
+        memcpy(header.magic, IMAGE_MAGIC, IMAGE_MAGIC_LENGTH);
+
+        if (flush_zeros(writer, true) != 0) {
+            result = -1;
+        } else {
+            // Data follows the segment headers, so their offsets are moved on
+            header.num_segments = writer->num_segments;
+            uint32_t data_offset = sizeof(ImageHeader) + writer->num_segments * sizeof(SegmentHeader);
+            for (uint32_t i = 0; i < writer->num_segments; i++) {
+                if (writer->segments[i].type == SEGMENT_DATA) {
+                    writer->segments[i].offset += data_offset;
+                }
+            }
+            if (fwrite(&header, sizeof(header), 1, writer->out) != 1
+                    || fwrite(writer->segments, sizeof(SegmentHeader), writer->num_segments, writer->out) != writer->num_segments
+                    || fwrite(writer->data, 1, writer->data_size, writer->out) != writer->data_size) {
+                result = -1;
+            }
+        }
+    }
+    free(writer->segments);
+    free(writer->data);
+    writer->segments = NULL;
+    writer->data = NULL;
+    return result;
+}
+
+static int add_segment(ImageWriter *writer, SegmentType type, uint32_t address, uint32_t size) {
+    if (writer->num_segments > 0) {
+        SegmentHeader *last = &writer->segments[writer->num_segments - 1];
+        if (last->type == type && last->address + last->size == address) {
+            last->size += size;
+            return 0;
+        }
+    }
+    // Doubles the capacity of the segments if they are full
+    if (writer->num_segments == writer->segment_capacity) {
+        uint32_t capacity = writer->segment_capacity == 0 ? INITIAL_SEGMENT_CAPACITY : 2 * writer->segment_capacity;
+        SegmentHeader *segments = realloc(writer->segments, capacity * sizeof(SegmentHeader));
+        if (segments == NULL) {
+            return -1;
+        }
+        writer->segments = segments;
+        writer->segment_capacity = capacity;
+    }
+    SegmentHeader segment = {
+        .type = type,
+        .address = address,
+        .size = size,
+        .offset = type == SEGMENT_DATA ? writer->data_size : 0,
+    };
+    writer->segments[writer->num_segments++] = segment;
+    return 0;
+}
+
+static int append_data(ImageWriter *writer, const void *bytes, uint32_t size) {
+    if (add_segment(writer, SEGMENT_DATA, writer->address - size, size) != 0) {
+        return -1;
+    }
+    // Doubles the capacity of the data until it fits
+    if (writer->data_size + size > writer->data_capacity) {
+        uint32_t capacity = writer->data_capacity == 0 ? INITIAL_DATA_CAPACITY : writer->data_capacity;
+        while (writer->data_size + size > capacity) {
+            capacity *= 2;
+        }
+        uint8_t *data = realloc(writer->data, capacity);
+        if (data == NULL) {
+            return -1;
+        }
+        writer->data = data;
+        writer->data_capacity = capacity;
+    }
+    if (bytes == NULL) {
+        memset(writer->data + writer->data_size, 0, size);
+    } else {
+        memcpy(writer->data + writer->data_size, bytes, size);
+    }
+    writer->data_size += size;
+    return 0;
+}
+
+static int flush_zeros(ImageWriter *writer, bool last) {
+    uint32_t size = writer->address - writer->zero_address;
+    if (size == 0) {
+        return 0;
+    }
+    int result = size >= MIN_ZERO_SEGMENT_SIZE || last
+        ? add_segment(writer, SEGMENT_ZERO, writer->zero_address, size)
+        : append_data(writer, NULL, size);
+    writer->zero_address = writer->address;
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/image_format.h"
+
+/**
+ * Represents a writer of a binary image, either flat (every word is written in
+ * order) or segmented (see image_format.h), where runs of zero words of at
+ * least MIN_ZERO_SEGMENT_SIZE bytes become zero segments:
+ * out:          Output binary file
+ * segmented:    If set, the image is segmented
+ * address:      Address of the next word
+ * segments:     Segments written so far, and their number and capacity
+ * data:         Contents of the data segments, and their size and capacity
+ * zero_address: Address of the first of the zero words not written yet
+ */
+typedef struct {
+    FILE *out;
+    bool segmented;
+    uint32_t address;
+    SegmentHeader *segments;
+    uint32_t num_segments;
+    uint32_t segment_capacity;
+    uint8_t *data;
+    uint32_t data_size;
+    uint32_t data_capacity;
+    uint32_t zero_address;
+} ImageWriter;
+
+/**
+ * Initialises a writer of a flat or segmented image to a binary file
+ */
+extern void initialise_writer(ImageWriter *, FILE *, bool);
+
+/**
+ * Writes the next word of the image
+ * Returns 0 if success and -1 otherwise
+ */
+extern int write_word(ImageWriter *, uint32_t);
+
+/**
+ * Writes a given number of zero words (eg: for .space)
+ * Returns 0 if success and -1 otherwise
+ */
+extern int write_zeros(ImageWriter *, uint32_t);
+
+/**
+ * Completes the image (writing a segmented image to the file) and frees the
+ * memory used by the writer
+ * Returns 0 if success and -1 otherwise
+ */
+extern int finish_writer(ImageWriter *);
+
+#endif
\ No newline at end of file
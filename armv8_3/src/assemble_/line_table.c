@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "line_table.h"
+
+int initialise_lines(LineTable *line_table, int capacity) {
+    // Returns -1 if initial capacity is 0
+    if (capacity == 0) {
+        return -1;
+    }
+
+    // Returns -1 if memory cannot be allocated for the table entries
+    if ((line_table->entries = malloc(capacity * sizeof(LineTableEntry))) == NULL) {
+        return -1;
+    }
+
+    line_table->size = 0;
+    line_table->capacity = capacity;
+
+    return 0;
+}
+
+int insert_line(LineTable *line_table, uint32_t address, uint32_t line) {
+    // If the table is at full capacity, attempts to allocate more memory
+    if (line_table->size == line_table->capacity) {
+        int new_capacity = line_table->capacity * 2;
+        LineTableEntry *entries = realloc(line_table->entries, new_capacity * sizeof(LineTableEntry));
+        if (entries == NULL) {
+            // Returns -1 (failure) if more memory cannot be allocated
+            return -1;
+        }
+        line_table->entries = entries;
+        line_table->capacity = new_capacity;
+    }
+
+    LineTableEntry entry = {address, line};
+    line_table->entries[line_table->size] = entry;
+    line_table->size++;
+
+    return 0;
+}
+
+int write_lines(LineTable *line_table, char *source_path, FILE *fp) {
+    if (fprintf(fp, "source %s\n", source_path) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < line_table->size; i++) {
+        // %08x: Displays int in hexadecimal and pads with 0s up to width 8
+        if (fprintf(fp, "line 0x%08x %u\n", line_table->entries[i].address, line_table->entries[i].line) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void free_lines(LineTable *line_table) {
+    free(line_table->entries);
+}
\ No newline at end of file
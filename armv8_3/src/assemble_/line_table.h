@@ -0,0 +1,54 @@
+#ifndef LINE_TABLE_H
+#define LINE_TABLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Represents an entry in a line table: the address of an instruction and the
+ * number of the source line it was assembled from (counting from 1)
+ */
+typedef struct {
+    uint32_t address;
+    uint32_t line;
+} LineTableEntry;
+
+/**
+ * Represents a line table, containing an array of entries in address order,
+ * the current size and the table capacity
+ */
+typedef struct {
+    LineTableEntry *entries;
+    int size;
+    int capacity;
+} LineTable;
+
+/**
+ * Initialises a line table with size = 0 and a given capacity, dynamically
+ * allocating memory for the array of table entries
+ * Returns 0 for success, -1 for failure
+ */
+extern int initialise_lines(LineTable *, int);
+
+/**
+ * Adds the source line of the instruction at a given address to the line table
+ * Allocates more memory if the table is already at full capacity
+ * Returns 0 for success, -1 for failure
+ */
+extern int insert_line(LineTable *, uint32_t, uint32_t);
+
+/**
+ * Writes the path of the source file and the lines in the line table to a
+ * symbol map (a file stream), one record per line:
+ * source <path>
+ * line <address> <source line>
+ * Returns 0 for success, -1 for failure
+ */
+extern int write_lines(LineTable *, char *, FILE *);
+
+/**
+ * Frees the memory dynamically allocated by the table
+ */
+extern void free_lines(LineTable *);
+
+#endif
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 // Mnemonics for special instructions
 #define NOP_STR "nop"
+#define HLT_STR "hlt"
 
 // Mnemonics for data processing (arithmetic) instructions
 #define DP_ADD_STR "add"
@@ -59,6 +59,16 @@ uint32_t lookup(SymbolTable *sym_table, char *label) {
     assert(0);
 }
 
+int write_symbols(SymbolTable *sym_table, FILE *fp) {
+    for (int i = 0; i < sym_table->size; i++) {
+        // %08x: Displays int in hexadecimal and pads with 0s up to width 8
+        if (fprintf(fp, "label 0x%08x %s\n", sym_table->entries[i].value, sym_table->entries[i].str) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 void free_table(SymbolTable *sym_table) {
     for (int i = 0; i < sym_table->size; i++) {
         // Frees all dynamically allocated strings
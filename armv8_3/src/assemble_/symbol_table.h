@@ -1,6 +1,7 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
+#include <stdio.h>
 #include <stdint.h>
 
 /**
@@ -42,6 +43,13 @@ extern int insert(SymbolTable *, char *, uint32_t);
  */
 extern uint32_t lookup(SymbolTable *, char *);
 
+/**
+ * Writes the labels in the symbol table to a symbol map (a file stream), one
+ * record per line: label <address> <name>
+ * Returns 0 for success, -1 for failure
+ */
+extern int write_symbols(SymbolTable *, FILE *);
+
 /**
  * Frees the memory dynamically allocated by the table
  */
@@ -0,0 +1,52 @@
+#ifndef IMAGE_FORMAT_H
+#define IMAGE_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * Defines the segmented binary image format, which the assembler writes with
+ * --segmented and the emulator loads alongside flat images:
+ * ImageHeader, then num_segments SegmentHeaders, then the contents of each
+ * data segment at its offset in the file. Zero segments (eg: .space buffers)
+ * have no contents in the file, and are left untouched in memory (which is
+ * initialised to 0)
+ * A flat image is the contents of memory from address 0, so it is told apart
+ * by the magic, which is not a valid instruction
+ */
+#define IMAGE_MAGIC "\x7fSEGIMG"
+#define IMAGE_MAGIC_LENGTH 8
+
+/**
+ * Represents the types of segment in a segmented image
+ */
+typedef enum {
+    SEGMENT_DATA,
+    SEGMENT_ZERO,
+} SegmentType;
+
+/**
+ * Represents the header of a segmented image:
+ * magic:        IMAGE_MAGIC (without its terminating '\0')
+ * num_segments: Number of segment headers which follow
+ */
+typedef struct {
+    char magic[IMAGE_MAGIC_LENGTH];
+    uint32_t num_segments;
+    uint32_t reserved;
+} ImageHeader;
+
+/**
+ * Represents the header of a segment:
+ * type:    Data or zero segment
+ * address: Address in memory of the first byte of the segment
+ * size:    Size of the segment in bytes
+ * offset:  Offset of the contents of a data segment in the file (0 otherwise)
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t address;
+    uint32_t size;
+    uint32_t offset;
+} SegmentHeader;
+
+#endif
\ No newline at end of file
@@ -10,24 +10,18 @@
 #define NOP_PATTERN 0xd503201f
 
 /**
- * Defines the start and end bits of op0 and the bit masks and patterns which
- * are used with op0 to identify each instruction type:
- * op0   Instruction Type
- * 100x  Data Processing (Immediate)
- * x101  Data Processing (Register)
- * x1x0  Single Data Transfer
- * 101x  Branch
- */
-#define OP0_START 25
-#define OP0_END 28
-#define DP_IMM_MASK 14
-#define DP_IMM_PATTERN 8
-#define DP_REG_MASK 7
-#define DP_REG_PATTERN 5
-#define SDT_MASK 5
-#define SDT_PATTERN 4
-#define BRANCH_MASK 14
-#define BRANCH_PATTERN 10
+ * Defines the bit pattern of hlt #imm16 (imm16 at bits 5-20), and that of
+ * hlt #0xf000, which is reserved for semihosting calls (see semihost.h)
+ */
+#define HLT_PATTERN 0xd4400000
+#define HLT_IMM_START 5
+#define SEMIHOST_PATTERN 0xd45e0000
+
+/**
+ * The fixed bits (including op0, bits 25-28) which identify each instruction
+ * type and form are given by the instruction set description in isa.h, which
+ * uses the field positions defined below
+ */
 
 /**
  * Defines the start and end bits of sf, opc, rd fields, which are shared by all
@@ -246,17 +240,6 @@ typedef enum {
 ////////////////////////////////////////////////////////////////////////////////
 // Data Processing (Arithmetic):
 
-/**
- * Represents the fields of an arithmetic data processing instruction (imm/reg)
- */
-typedef struct {
-    uint8_t sf;
-    uint8_t opc;
-    uint8_t rd;
-    uint8_t rn;
-    uint64_t op2;
-} DPArithmeticFormat;
-
 /**
  * Defines the 4 types of arithmetic instruction: add, adds (add & set flags),
  * sub, subs (sub & set flags)
@@ -0,0 +1,260 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+#include "instructions.h"
+
+/**
+ * Machine-readable description of every supported instruction form, from which
+ * both the decoder (emulator) and the encoder (assembler) are generated, so
+ * that the two cannot drift apart
+ * Each form ISA_<NAME>(FIXED, KEY, FIELD, TAG) expands one of the following
+ * per part of the form, where member is a member of the InstrFormat union:
+ * FIXED(start, end, value):       bits start-end always hold value
+ * KEY(member, start, end, value): bits start-end always hold value, which is
+ *                                 also the value of member (eg: opi, M)
+ * FIELD(member, start, end):      bits start-end hold the value of member
+ * TAG(member, value):             member identifies the form, but is not
+ *                                 encoded (eg: imm_type, addr_mode)
+ */
+
+// add, adds, sub, subs (imm): sf opc 100 010 sh imm12 rn rd
+#define ISA_ADD_SUB_IMM(FIXED, KEY, FIELD, TAG) \
+    TAG(dp_imm_format.imm_type, IMM_ARITHMETIC) \
+    FIELD(dp_imm_format.sf, DP_SF_START, DP_SF_END) \
+    FIELD(dp_imm_format.opc, DP_OPC_START, DP_OPC_END) \
+    FIXED(26, 28, 0x4) \
+    KEY(dp_imm_format.opi, OPI_START, OPI_END, ARITHMETIC_OPI) \
+    FIELD(dp_imm_format.operand.Arithmetic.sh, SH_START, SH_END) \
+    FIELD(dp_imm_format.operand.Arithmetic.imm12, IMM12_START, IMM12_END) \
+    FIELD(dp_imm_format.operand.Arithmetic.rn, RN_START, RN_END) \
+    FIELD(dp_imm_format.rd, DP_RD_START, DP_RD_END)
+
+// movn, movz, movk: sf opc 100 101 hw imm16 rd
+#define ISA_MOVE_WIDE(FIXED, KEY, FIELD, TAG) \
+    TAG(dp_imm_format.imm_type, IMM_WIDE_MOVE) \
+    FIELD(dp_imm_format.sf, DP_SF_START, DP_SF_END) \
+    FIELD(dp_imm_format.opc, DP_OPC_START, DP_OPC_END) \
+    FIXED(26, 28, 0x4) \
+    KEY(dp_imm_format.opi, OPI_START, OPI_END, WIDE_MOVE_OPI) \
+    FIELD(dp_imm_format.operand.WideMove.hw, HW_START, HW_END) \
+    FIELD(dp_imm_format.operand.WideMove.imm16, IMM16_START, IMM16_END) \
+    FIELD(dp_imm_format.rd, DP_RD_START, DP_RD_END)
+
+// add, adds, sub, subs (reg): sf opc 0 101 1 shift 0 rm operand rn rd
+#define ISA_ADD_SUB_REG(FIXED, KEY, FIELD, TAG) \
+    TAG(dp_reg_format.reg_type, REG_ARITHMETIC) \
+    FIELD(dp_reg_format.sf, DP_SF_START, DP_SF_END) \
+    FIELD(dp_reg_format.opc, DP_OPC_START, DP_OPC_END) \
+    KEY(dp_reg_format.M, M_START, M_END, !MULTIPLY_M) \
+    FIXED(25, 27, 0x5) \
+    FIXED(ARITHMETIC_LOGICAL_BIT, ARITHMETIC_LOGICAL_BIT, ARITHMETIC_BIT) \
+    FIELD(dp_reg_format.opr.arithmetic_shift, SHIFT_START, SHIFT_END) \
+    FIXED(N_START, N_END, 0) \
+    FIELD(dp_reg_format.rm, RM_START, RM_END) \
+    FIELD(dp_reg_format.operand.arithmetic_logical_operand, OPERAND_START, OPERAND_END) \
+    FIELD(dp_reg_format.rn, RN_START, RN_END) \
+    FIELD(dp_reg_format.rd, DP_RD_START, DP_RD_END)
+
+// and, bic, orr, orn, eor, eon, ands, bics: sf opc 0 101 0 shift N rm operand rn rd
+#define ISA_LOGICAL_REG(FIXED, KEY, FIELD, TAG) \
+    TAG(dp_reg_format.reg_type, REG_LOGICAL) \
+    FIELD(dp_reg_format.sf, DP_SF_START, DP_SF_END) \
+    FIELD(dp_reg_format.opc, DP_OPC_START, DP_OPC_END) \
+    KEY(dp_reg_format.M, M_START, M_END, !MULTIPLY_M) \
+    FIXED(25, 27, 0x5) \
+    FIXED(ARITHMETIC_LOGICAL_BIT, ARITHMETIC_LOGICAL_BIT, !ARITHMETIC_BIT) \
+    FIELD(dp_reg_format.opr.logical_opr.shift, SHIFT_START, SHIFT_END) \
+    FIELD(dp_reg_format.opr.logical_opr.N, N_START, N_END) \
+    FIELD(dp_reg_format.rm, RM_START, RM_END) \
+    FIELD(dp_reg_format.operand.arithmetic_logical_operand, OPERAND_START, OPERAND_END) \
+    FIELD(dp_reg_format.rn, RN_START, RN_END) \
+    FIELD(dp_reg_format.rd, DP_RD_START, DP_RD_END)
+
+// madd, msub: sf 00 1 1011 000 rm x ra rn rd
+#define ISA_MULTIPLY(FIXED, KEY, FIELD, TAG) \
+    TAG(dp_reg_format.reg_type, REG_MULTIPLY) \
+    FIELD(dp_reg_format.sf, DP_SF_START, DP_SF_END) \
+    KEY(dp_reg_format.opc, DP_OPC_START, DP_OPC_END, 0) \
+    KEY(dp_reg_format.M, M_START, M_END, MULTIPLY_M) \
+    FIXED(24, 27, 0xb) \
+    FIXED(21, 23, 0) \
+    FIELD(dp_reg_format.rm, RM_START, RM_END) \
+    FIELD(dp_reg_format.operand.multiply_operand.x, X_START, X_END) \
+    FIELD(dp_reg_format.operand.multiply_operand.ra, RA_START, RA_END) \
+    FIELD(dp_reg_format.rn, RN_START, RN_END) \
+    FIELD(dp_reg_format.rd, DP_RD_START, DP_RD_END)
+
+// ldr, str (unsigned offset): 1 sf 11100 1 0 L imm12 xn rt
+#define ISA_LDR_STR_UNSIGNED(FIXED, KEY, FIELD, TAG) \
+    TAG(sdt_format.sdt_type, SDT) \
+    TAG(sdt_format.SDT.addr_mode, UNSIGNED_OFFSET) \
+    FIXED(SINGLE_DATA_TRANSFER_IDENTIFIER_START, SINGLE_DATA_TRANSFER_IDENTIFIER_END, SDT_IDENTIFIER) \
+    FIELD(sdt_format.sf, SF_START, SF_END) \
+    FIXED(25, 29, 0x1c) \
+    FIXED(U_START, U_END, UNSIGNED_OFFSET_U) \
+    FIXED(23, 23, 0) \
+    FIELD(sdt_format.SDT.L, L_START, L_END) \
+    FIELD(sdt_format.SDT.offset.imm12, IMM12_START, IMM12_END) \
+    FIELD(sdt_format.SDT.xn, XN_START, XN_END) \
+    FIELD(sdt_format.rt, RT_START, RT_END)
+
+// ldr, str (register offset): 1 sf 11100 0 0 L 1 xm 011010 xn rt
+#define ISA_LDR_STR_REGISTER(FIXED, KEY, FIELD, TAG) \
+    TAG(sdt_format.sdt_type, SDT) \
+    TAG(sdt_format.SDT.addr_mode, REGISTER_OFFSET) \
+    FIXED(SINGLE_DATA_TRANSFER_IDENTIFIER_START, SINGLE_DATA_TRANSFER_IDENTIFIER_END, SDT_IDENTIFIER) \
+    FIELD(sdt_format.sf, SF_START, SF_END) \
+    FIXED(25, 29, 0x1c) \
+    FIXED(U_START, U_END, !UNSIGNED_OFFSET_U) \
+    FIXED(23, 23, 0) \
+    FIELD(sdt_format.SDT.L, L_START, L_END) \
+    FIXED(R_START, R_END, REGISTER_OFFSET_R) \
+    FIELD(sdt_format.SDT.offset.xm, XM_START, XM_END) \
+    FIXED(10, 15, 0x1a) \
+    FIELD(sdt_format.SDT.xn, XN_START, XN_END) \
+    FIELD(sdt_format.rt, RT_START, RT_END)
+
+// ldr, str (pre-index): 1 sf 11100 0 0 L 0 simm9 1 1 xn rt
+#define ISA_LDR_STR_PRE(FIXED, KEY, FIELD, TAG) \
+    TAG(sdt_format.sdt_type, SDT) \
+    TAG(sdt_format.SDT.addr_mode, PRE_INDEX) \
+    FIXED(SINGLE_DATA_TRANSFER_IDENTIFIER_START, SINGLE_DATA_TRANSFER_IDENTIFIER_END, SDT_IDENTIFIER) \
+    FIELD(sdt_format.sf, SF_START, SF_END) \
+    FIXED(25, 29, 0x1c) \
+    FIXED(U_START, U_END, !UNSIGNED_OFFSET_U) \
+    FIXED(23, 23, 0) \
+    FIELD(sdt_format.SDT.L, L_START, L_END) \
+    FIXED(R_START, R_END, !REGISTER_OFFSET_R) \
+    FIELD(sdt_format.SDT.offset.simm9, SIMM9_START, SIMM9_END) \
+    FIXED(I_START, I_END, PRE_INDEX_I) \
+    FIXED(10, 10, 1) \
+    FIELD(sdt_format.SDT.xn, XN_START, XN_END) \
+    FIELD(sdt_format.rt, RT_START, RT_END)
+
+// ldr, str (post-index): 1 sf 11100 0 0 L 0 simm9 0 1 xn rt
+#define ISA_LDR_STR_POST(FIXED, KEY, FIELD, TAG) \
+    TAG(sdt_format.sdt_type, SDT) \
+    TAG(sdt_format.SDT.addr_mode, POST_INDEX) \
+    FIXED(SINGLE_DATA_TRANSFER_IDENTIFIER_START, SINGLE_DATA_TRANSFER_IDENTIFIER_END, SDT_IDENTIFIER) \
+    FIELD(sdt_format.sf, SF_START, SF_END) \
+    FIXED(25, 29, 0x1c) \
+    FIXED(U_START, U_END, !UNSIGNED_OFFSET_U) \
+    FIXED(23, 23, 0) \
+    FIELD(sdt_format.SDT.L, L_START, L_END) \
+    FIXED(R_START, R_END, !REGISTER_OFFSET_R) \
+    FIELD(sdt_format.SDT.offset.simm9, SIMM9_START, SIMM9_END) \
+    FIXED(I_START, I_END, POST_INDEX_I) \
+    FIXED(10, 10, 1) \
+    FIELD(sdt_format.SDT.xn, XN_START, XN_END) \
+    FIELD(sdt_format.rt, RT_START, RT_END)
+
+// ldr (literal): 0 sf 011000 simm19 rt
+#define ISA_LOAD_LITERAL(FIXED, KEY, FIELD, TAG) \
+    TAG(sdt_format.sdt_type, LOAD_LITERAL) \
+    FIXED(SINGLE_DATA_TRANSFER_IDENTIFIER_START, SINGLE_DATA_TRANSFER_IDENTIFIER_END, LOAD_LITERAL_IDENTIFIER) \
+    FIELD(sdt_format.sf, SF_START, SF_END) \
+    FIXED(24, 29, 0x18) \
+    FIELD(sdt_format.LoadLiteral.simm19, SIMM19_START, SIMM19_END) \
+    FIELD(sdt_format.rt, RT_START, RT_END)
+
+// b: 00 0101 simm26
+#define ISA_BRANCH(FIXED, KEY, FIELD, TAG) \
+    TAG(branch_format.branch_type, UNCONDITIONAL) \
+    FIXED(BRANCH_IDENTIFIER_START, BRANCH_IDENTIFIER_END, UNCONDITIONAL_IDENTIFIER) \
+    FIXED(26, 29, 0x5) \
+    FIELD(branch_format.Unconditional.simm26, SIMM26_START, SIMM26_END)
+
+// br: 11 0101 1000011111000000 xn 00000
+#define ISA_BRANCH_REGISTER(FIXED, KEY, FIELD, TAG) \
+    TAG(branch_format.branch_type, REGISTER) \
+    FIXED(BRANCH_IDENTIFIER_START, BRANCH_IDENTIFIER_END, REGISTER_IDENTIFIER) \
+    FIXED(26, 29, 0x5) \
+    FIXED(10, 25, 0x87c0) \
+    FIELD(branch_format.Register.xn, XN_START, XN_END) \
+    FIXED(0, 4, 0)
+
+// b.cond: 01 0101 00 simm19 0 cond
+#define ISA_BRANCH_CONDITIONAL(FIXED, KEY, FIELD, TAG) \
+    TAG(branch_format.branch_type, CONDITIONAL) \
+    FIXED(BRANCH_IDENTIFIER_START, BRANCH_IDENTIFIER_END, CONDITIONAL_IDENTIFIER) \
+    FIXED(26, 29, 0x5) \
+    FIXED(24, 25, 0) \
+    FIELD(branch_format.Conditional.simm19, SIMM19_START, SIMM19_END) \
+    FIXED(4, 4, 0) \
+    FIELD(branch_format.Conditional.cond, COND_START, COND_END)
+
+/**
+ * X-macro list of the instruction forms: X(NAME, name, TYPE, arg), where TYPE
+ * is the instruction type of the form and arg is passed through unchanged (eg:
+ * the key which the forms are matched against)
+ */
+#define ISA_FORMS(X, arg) \
+    X(ADD_SUB_IMM, add_sub_imm, DATA_PROCESSING_IMM, arg) \
+    X(MOVE_WIDE, move_wide, DATA_PROCESSING_IMM, arg) \
+    X(ADD_SUB_REG, add_sub_reg, DATA_PROCESSING_REG, arg) \
+    X(LOGICAL_REG, logical_reg, DATA_PROCESSING_REG, arg) \
+    X(MULTIPLY, multiply, DATA_PROCESSING_REG, arg) \
+    X(LDR_STR_UNSIGNED, ldr_str_unsigned, SINGLE_DATA_TRANSFER, arg) \
+    X(LDR_STR_REGISTER, ldr_str_register, SINGLE_DATA_TRANSFER, arg) \
+    X(LDR_STR_PRE, ldr_str_pre, SINGLE_DATA_TRANSFER, arg) \
+    X(LDR_STR_POST, ldr_str_post, SINGLE_DATA_TRANSFER, arg) \
+    X(LOAD_LITERAL, load_literal, SINGLE_DATA_TRANSFER, arg) \
+    X(BRANCH, branch, BRANCH, arg) \
+    X(BRANCH_REGISTER, branch_register, BRANCH, arg) \
+    X(BRANCH_CONDITIONAL, branch_conditional, BRANCH, arg)
+
+/**
+ * Represents the id of each instruction form, ISA_<NAME>
+ */
+#define ISA_FORM_ID(NAME, name, TYPE, arg) ISA_##NAME,
+typedef enum {
+    ISA_FORMS(ISA_FORM_ID, )
+    ISA_UNDEFINED,
+} IsaForm;
+#undef ISA_FORM_ID
+
+/**
+ * Parts of a form which are not used by an expansion
+ */
+#define ISA_IGNORE_FIXED(start, end, value)
+#define ISA_IGNORE_KEY(member, start, end, value)
+#define ISA_IGNORE_FIELD(member, start, end)
+#define ISA_IGNORE_TAG(member, value)
+
+/**
+ * Returns the bit mask of bits start-end, and a value placed in bits start-end
+ */
+#define ISA_RANGE(start, end) ((uint32_t) ((((uint64_t) 1 << ((end) - (start) + 1)) - 1) << (start)))
+#define ISA_BITS(start, end, value) (((uint32_t) (value) << (start)) & ISA_RANGE(start, end))
+
+/**
+ * Returns the mask and pattern of the bits which are fixed in a form - an
+ * instruction is of that form iff (instruction & mask) == pattern
+ */
+#define ISA_FIXED_MASK(start, end, value) | ISA_RANGE(start, end)
+#define ISA_KEY_MASK(member, start, end, value) | ISA_RANGE(start, end)
+#define ISA_FIXED_PATTERN(start, end, value) | ISA_BITS(start, end, value)
+#define ISA_KEY_PATTERN(member, start, end, value) | ISA_BITS(start, end, value)
+#define ISA_MASK(NAME) \
+    (0 ISA_##NAME(ISA_FIXED_MASK, ISA_KEY_MASK, ISA_IGNORE_FIELD, ISA_IGNORE_TAG))
+#define ISA_PATTERN(NAME) \
+    (0 ISA_##NAME(ISA_FIXED_PATTERN, ISA_KEY_PATTERN, ISA_IGNORE_FIELD, ISA_IGNORE_TAG))
+
+/**
+ * Defines the bits which select the form of an instruction in the decoder's
+ * decision tree: the top byte (bits 24-31) selects the form, except for the
+ * register offset and pre/post-index transfers, which share a top byte and are
+ * then told apart by bits 10-11
+ * ISA_KEY returns the 10-bit key of an instruction (or of a mask or pattern)
+ */
+#define ISA_TOP_START 24
+#define ISA_SELECT_START 10
+#define ISA_SELECT_BITS 2
+#define ISA_NUM_KEYS 1024
+#define ISA_KEY(instr) \
+    ((uint32_t) (instr) >> ISA_TOP_START << ISA_SELECT_BITS \
+        | ((uint32_t) (instr) >> ISA_SELECT_START & ((1 << ISA_SELECT_BITS) - 1)))
+
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * Defines the page of live counters which the emulator publishes with
+ * --live NAME, as a POSIX shared memory object (/dev/shm/NAME) which another
+ * process (eg: emustat) maps read-only, without pausing the guest:
+ * A LiveStats record at offset 0 of a LIVE_STATS_SIZE byte object, every
+ * field in host byte order. The emulator updates it every LIVE_INTERVAL
+ * instructions, and once more when the guest stops, and removes the object
+ * when it exits (a reader which has it mapped still sees the final values)
+ * The record also names the memory file of guest memory, which a reader can
+ * map read-only to see guest memory live
+ * The fields are guarded by a sequence number (a seqlock): it is odd while
+ * the emulator updates them, and changes with every update, so a reader
+ * copies the record, then retries if the sequence number was odd or has
+ * changed since it was read
+ */
+#define LIVE_STATS_MAGIC "\x7f" "EMUSTAT"
+#define LIVE_STATS_MAGIC_LENGTH 8
+#define LIVE_STATS_VERSION 2
+#define LIVE_STATS_SIZE 4096
+// Size of the buffer holding the path of the memory file of guest memory
+#define LIVE_PATH_LENGTH 64
+
+// Number of instructions retired between updates of the live counters
+#define LIVE_INTERVAL (1 << 20)
+
+/**
+ * Represents the states of the guest published in the live counters
+ */
+typedef enum {
+    LIVE_RUNNING,
+    LIVE_HALTED,
+    LIVE_FAULTED,
+    LIVE_STOPPED,
+    LIVE_EXITED,
+} LiveState;
+
+/**
+ * Represents the live counters of a running emulator:
+ * magic:    LIVE_STATS_MAGIC (without its terminating '\0')
+ * version:  LIVE_STATS_VERSION
+ * state:    State of the guest (a LiveState)
+ * sequence: Sequence number of the update (odd while it is being written)
+ * pid:      Process id of the emulator
+ * retired:  Number of instructions retired
+ * pc:       Program counter of the guest
+ * loads:    Number of loads from guest memory
+ * stores:   Number of stores to guest memory
+ * rate:     Instructions retired per second over the last second (or since
+ *           the guest started, in its first second)
+ * started:  Time at which the guest started (CLOCK_MONOTONIC, nanoseconds)
+ * updated:  Time of the last update (CLOCK_MONOTONIC, nanoseconds)
+ * memory:   Path of the memory file of guest memory (/proc/<pid>/fd/<fd>), or
+ *           empty if guest memory is not shared with one
+ * size:     Size of guest memory in bytes
+ * The magic, version, pid, started, memory and size fields are written once,
+ * before the first update
+ */
+typedef struct {
+    char magic[LIVE_STATS_MAGIC_LENGTH];
+    uint32_t version;
+    uint32_t state;
+    _Atomic uint64_t sequence;
+    uint64_t pid;
+    uint64_t retired;
+    uint64_t pc;
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t rate;
+    uint64_t started;
+    uint64_t updated;
+    char memory[LIVE_PATH_LENGTH];
+    uint64_t size;
+} LiveStats;
+
+_Static_assert(sizeof(LiveStats) <= LIVE_STATS_SIZE, "live counters must fit in their page");
+
+#endif
\ No newline at end of file
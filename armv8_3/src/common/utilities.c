@@ -51,40 +51,4 @@ uint64_t logical_shift_left(uint64_t value, int shift_amount, int sf) {
         shifted = truncate_32_bits(shifted);
     }
     return shifted;
-}
-
-uint64_t logical_shift_right(uint64_t value, int shift_amount, int sf) {
-    assert(sf == BIT_MODE_32 || sf == BIT_MODE_64);
-    uint64_t shifted = value >> shift_amount;
-    if (sf == BIT_MODE_32) {
-        shifted = truncate_32_bits(shifted);
-    }
-    return shifted;
-}
-
-uint64_t arithmetic_shift_right(uint64_t value, int shift_amount, int sf) {
-    assert(sf == BIT_MODE_32 || sf == BIT_MODE_64);
-    // Gets the size in bits of the operand
-    int bit_size = sf == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64; 
-    int sign = extract_bits(value, bit_size - 1, bit_size - 1);
-    uint64_t shifted = value >> shift_amount;
-    if (sign == 1) {
-        shifted |= get_bit_mask(bit_size - shift_amount, bit_size - 1);
-    }
-    if (sf == BIT_MODE_32) {
-        shifted = truncate_32_bits(shifted);
-    }
-    return shifted;
-}
-
-uint64_t rotate_right(uint64_t value, int shift_amount, int sf) {
-    assert(sf == BIT_MODE_32 || sf == BIT_MODE_64);
-    // Gets the size in bits of the operand
-    int bit_size = sf == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64;
-    // Shifts value to the right and does bitwise OR with the bits carried out
-    uint64_t rotated = (value >> shift_amount) | (value << (bit_size - shift_amount));
-    if (sf == BIT_MODE_32) {
-        rotated = truncate_32_bits(rotated);
-    }
-    return rotated;
 }
\ No newline at end of file
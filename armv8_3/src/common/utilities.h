@@ -13,6 +13,14 @@
 #define BIT_SIZE_64 64
 #define SIGN_BIT_64 63
 
+/**
+ * Defines the unsigned and signed types of a W-bit value and its sign bit, used
+ * to specialise operations on the bit width W (32 or 64) at compile time
+ */
+#define UINT_TYPE(W) uint##W##_t
+#define INT_TYPE(W) int##W##_t
+#define SIGN_OF(W, value) ((value) >> ((W) - 1))
+
 #define MEMORY_SIZE 2097152 // Size of the ARMv8 memory (2MB) in bytes
 #define REGISTER_SIZE 64 // Size of a general-purpose register in bits
 #define NUM_GENERAL_REGISTERS 31 // Number of general-purpose registers
@@ -20,6 +28,7 @@
 #define INSTR_BYTES 4 // Represents the size of an instruction in bytes
 
 #define ZERO_REG_INDEX 31 // The index of the zero register
+#define NO_LIMIT UINT64_MAX // Instruction limit of a CPU which runs until halt
 #define ZERO_REG_VAL 0 // The value of the zero register
 
 /**
@@ -49,17 +58,62 @@ typedef struct {
 /**
  * Represents the state of the CPU in an ARMv8 machine:
  * memory:    Pointer to memory block representing byte-addressable ARMv8 memory
+ * memory_fd: File descriptor of the memory file which memory maps, while it is
+ *            shared with the file (-1 once forked, or for a forked copy)
  * registers: An array representing 64-bit general purpose registers
  * zr:        Represents the (64-bit) Zero Register 
  * pc:        Represents the (64-bit) Program Counter
  * pstate:    Represents the Processor State register
+ * cache:     Pointer to the cache of decoded micro-ops (one entry per word)
+ * retired:   Number of instructions retired (executed) so far
+ * stats:     Pointer to the execution statistics (NULL unless gathered)
+ * fault:     Guest address of the memory access which stopped execution, if
+ *            the program accessed memory out of bounds
+ * watches:   Pointer to the armed watchpoints (NULL unless any are set)
+ * history:   Pointer to the recorded execution history (NULL unless recording)
+ * limit:     Number of instructions retired at which execution stops, or the
+ *            next snapshot is taken if recording (NO_LIMIT if none)
+ * precise:   If set, each dispatch executes a single instruction (no idioms
+ *            or fused pairs are formed)
+ * digest:    Pointer to the running digest of memory (NULL unless computed)
+ * caches:    Pointer to the simulated cache hierarchy, which every fetch and
+ *            data access is passed through (NULL unless simulated)
+ * timing:    Pointer to the pipeline timing model, which every executed
+ *            instruction is passed through (NULL unless modelled)
+ * loops:     Pointer to the loop profile, which every taken branch is passed
+ *            through (NULL unless profiled)
+ * accesses:  Pointer to the memory access profile, which every load and store
+ *            is passed through (NULL unless profiled)
+ * coverage:  Pointer to the bitmap of the instruction words executed, one bit
+ *            per word of memory (NULL unless recorded)
+ * live:      Pointer to the live counters, in which every load and store is
+ *            counted (NULL unless published)
+ * semihost:  Pointer to the state of the semihosting interface (NULL unless
+ *            enabled, when semihosting calls are executed as nops)
  */ 
 typedef struct {
     uint8_t *memory;
+    int memory_fd;
     uint64_t registers[NUM_GENERAL_REGISTERS];
     uint64_t zr;
     uint64_t pc;
     PState pstate;
+    struct DecodeCache *cache;
+    uint64_t retired;
+    struct Statistics *stats;
+    uint64_t fault;
+    struct WatchList *watches;
+    struct History *history;
+    uint64_t limit;
+    bool precise;
+    struct MemoryDigest *digest;
+    struct CacheModel *caches;
+    struct TimingModel *timing;
+    struct LoopProfile *loops;
+    struct MemoryProfile *accesses;
+    uint8_t *coverage;
+    struct LiveCounters *live;
+    struct Semihost *semihost;
 } CPUState;
 
 /**
@@ -105,19 +159,4 @@ extern uint64_t calculate_pc_offset(uint64_t, int32_t, int);
  */
 extern uint64_t logical_shift_left(uint64_t, int, int);
 
-/**
- * Logically shifts a 32-bit or 64-bit value right by shift amount
- */
-extern uint64_t logical_shift_right(uint64_t, int, int);
-
-/**
- * Arithmetically shifts a 32-bit or 64-bit value right by shift amount
- */
-extern uint64_t arithmetic_shift_right(uint64_t, int, int);
-
-/**
- * Rotates a 32-bit or 64-bit value right by shift amount
- */
-extern uint64_t rotate_right(uint64_t, int, int);
-
 #endif
\ No newline at end of file
@@ -0,0 +1,638 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "batch.h"
+#include "emulator.h"
+#include "micro_op.h"
+#include "decoder.h"
+#include "memory.h"
+#include "seed.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+
+// Initial capacity of the list of seed lines
+#define INITIAL_SEEDS_CAPACITY 16
+
+/**
+ * Represents a vector of signed 64-bit lanes (for arithmetic shifts)
+ */
+typedef int64_t SignedLaneVector __attribute__((vector_size(LANE_VECTOR_BYTES)));
+
+/**
+ * Declares a type LanePtr representing a pointer to a lane handler, which
+ * executes a micro-op at a given PC for every guest whose lane is set in the
+ * active lane vectors (clearing the lane of any guest which leaves lockstep)
+ */
+typedef void (*LanePtr)(MicroOp *, Batch *, uint64_t, LaneVector *);
+
+/**
+ * A lane vector with every lane 0
+ */
+static const LaneVector zeroLanes;
+
+/**
+ * Accesses the lane of a given guest in an array of lane vectors
+ */
+#define LANE(vectors, guest) \
+    ((vectors)[(guest) / LANES_PER_VECTOR][(guest) % LANES_PER_VECTOR])
+
+/**
+ * Lane-wise equivalents of the register, shift and flag operations of the
+ * handlers: values are kept zero-extended to 64 bits in every lane, and each
+ * result is truncated to the bit width W of the operation
+ */
+#define LANE_TRUNCATE(W, value) ((W) == BIT_SIZE_32 ? (value) & UINT32_MAX : (value))
+#define LANE_SIGN(W, value) (((value) >> ((W) - 1)) & 1)
+#define LANE_TRUTH(condition) ((LaneVector) (condition) & 1)
+#define LANE_SELECT(mask, value, old) (((value) & (mask)) | ((old) & ~(mask)))
+#define READ_LANES(W, batch, index, g) \
+    ((index) == ZERO_REG_INDEX ? zeroLanes : LANE_TRUNCATE(W, (batch)->registers[index][g]))
+#define WRITE_LANES(W, batch, index, g, value, mask) \
+    do { \
+        if ((index) != ZERO_REG_INDEX) { \
+            LaneVector *lanes = &(batch)->registers[index][g]; \
+            *lanes = LANE_SELECT(mask, LANE_TRUNCATE(W, value), *lanes); \
+        } \
+    } while (0)
+
+#define LANES_LSL(W, value, amount) LANE_TRUNCATE(W, (value) << (amount))
+#define LANES_LSR(W, value, amount) ((value) >> (amount))
+#define LANES_ASR(W, value, amount) \
+    LANE_TRUNCATE(W, (LaneVector) ((SignedLaneVector) ((value) << (BIT_SIZE_64 - (W))) \
+        >> (BIT_SIZE_64 - (W) + (amount))))
+#define LANES_ROR(W, value, amount) \
+    ((amount) == 0 ? (value) : LANE_TRUNCATE(W, (value) >> (amount) | (value) << ((W) - (amount))))
+
+#define LANE_NO_FLAGS(W, batch, g, mask, op1, op2, result)
+#define LANE_SET_FLAGS_ADD(W, batch, g, mask, op1, op2, result) \
+    write_flag_lanes(batch, g, mask, LANE_SIGN(W, result), LANE_TRUTH((result) == 0), \
+        LANE_TRUTH((result) < (op1)), LANE_SIGN(W, ~((op1) ^ (op2)) & ((op2) ^ (result))));
+#define LANE_SET_FLAGS_SUB(W, batch, g, mask, op1, op2, result) \
+    write_flag_lanes(batch, g, mask, LANE_SIGN(W, result), LANE_TRUTH((result) == 0), \
+        LANE_TRUTH((op1) >= (op2)), LANE_SIGN(W, ((op1) ^ (op2)) & ~((op2) ^ (result))));
+
+/**
+ * Returns true if any lane of a lane vector is set
+ */
+static bool any_lane(LaneVector);
+
+/**
+ * Sets the condition flags of the lanes set in a mask, in a given lane vector
+ */
+static void write_flag_lanes(Batch *, int, LaneVector, LaneVector, LaneVector,
+    LaneVector, LaneVector);
+
+/**
+ * Returns the lanes (0 or 1) of a given lane vector in which a condition code
+ * holds
+ */
+static LaneVector get_condition_lanes(uint8_t, Batch *, int);
+
+/**
+ * Reads or writes a register of a given guest in a given bit width
+ */
+static uint64_t read_lane(Batch *, int, uint32_t, int);
+static void write_lane(Batch *, int, uint32_t, int, uint64_t);
+
+/**
+ * Loads memory into, or stores memory from, register rt of a given guest, in a
+ * given bit mode. If the access is out of bounds, the guest leaves lockstep
+ * instead, so that its own emulator faults precisely
+ * Returns true if the access was made
+ */
+static bool transfer_lane(Batch *, int, uint64_t, LaneVector *, bool, BitMode,
+    uint64_t, uint32_t);
+
+/**
+ * Records that a given number of bytes at an address have been written
+ */
+static void mark_written(Batch *, uint64_t, int);
+
+/**
+ * Decodes the word at a given index of the binary into a micro-op
+ */
+static void decode_word(Batch *, uint64_t);
+
+/**
+ * Runs a basic block at a given PC for the guests set in the active lane
+ * vectors, until they branch, halt or all leave lockstep
+ */
+static void run_block(Batch *, uint64_t, LaneVector *);
+
+/**
+ * Stops running a guest in lockstep at a given PC (clearing its active lane),
+ * either because it halted or to finish on its own
+ */
+static void leave_lockstep(Batch *, int, uint64_t, LaneVector *, bool);
+
+/**
+ * Defines the arithmetic lane handlers - the 2nd operand is an expression of
+ * the micro-op op, the batch and the lane vector index g
+ */
+#define LANE_ARITHMETIC_HANDLER(handler, operator, flags, W, operand) \
+static void handler(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) { \
+    for (int g = 0; g < batch->num_vectors; g++) { \
+        if (!any_lane(active[g])) { \
+            continue; \
+        } \
+        LaneVector op1 = READ_LANES(W, batch, op->rn, g); \
+        LaneVector op2 = operand; \
+        LaneVector result = LANE_TRUNCATE(W, op1 operator op2); \
+        LANE_##flags(W, batch, g, active[g], op1, op2, result) \
+        WRITE_LANES(W, batch, op->rd, g, result, active[g]); \
+    } \
+}
+#define LANE_ARITHMETIC_IMM_HANDLER(W, name, operator, flags) \
+    LANE_ARITHMETIC_HANDLER(lanes_##name##_imm_##W, operator, flags, W, \
+        zeroLanes + (uint64_t) op->imm)
+#define DEFINE_LANE_ARITHMETIC_IMM_HANDLERS(NAME, name, operator, flags) \
+    FOR_EACH_WIDTH(LANE_ARITHMETIC_IMM_HANDLER, name, operator, flags)
+
+ARITHMETIC_OPS(DEFINE_LANE_ARITHMETIC_IMM_HANDLERS)
+
+#define LANE_ARITHMETIC_REG_HANDLER(W, SHIFT, shift, name, operator, flags) \
+    LANE_ARITHMETIC_HANDLER(lanes_##name##_##shift##_##W, operator, flags, W, \
+        LANES_##SHIFT(W, READ_LANES(W, batch, op->rm, g), op->aux))
+#define LANE_ARITHMETIC_REG_SHIFT_HANDLERS(SHIFT, shift, name, operator, flags) \
+    FOR_EACH_WIDTH(LANE_ARITHMETIC_REG_HANDLER, SHIFT, shift, name, operator, flags)
+#define DEFINE_LANE_ARITHMETIC_REG_HANDLERS(NAME, name, operator, flags) \
+    FOR_EACH_ARITHMETIC_SHIFT(LANE_ARITHMETIC_REG_SHIFT_HANDLERS, name, operator, flags)
+
+ARITHMETIC_OPS(DEFINE_LANE_ARITHMETIC_REG_HANDLERS)
+
+/**
+ * Defines the logical lane handlers (ands and bics clear C and V)
+ */
+#define LANE_LOGICAL_HANDLER(W, SHIFT, shift, name, operator, negate, set_flags) \
+static void lanes_##name##_##shift##_##W(MicroOp *op, Batch *batch, uint64_t pc, \
+        LaneVector *active) { \
+    for (int g = 0; g < batch->num_vectors; g++) { \
+        if (!any_lane(active[g])) { \
+            continue; \
+        } \
+        LaneVector rn = READ_LANES(W, batch, op->rn, g); \
+        LaneVector op2 = LANES_##SHIFT(W, READ_LANES(W, batch, op->rm, g), op->aux); \
+        LaneVector result = LANE_TRUNCATE(W, rn operator (negate ? ~op2 : op2)); \
+        if (set_flags) { \
+            write_flag_lanes(batch, g, active[g], LANE_SIGN(W, result), \
+                LANE_TRUTH(result == 0), zeroLanes, zeroLanes); \
+        } \
+        WRITE_LANES(W, batch, op->rd, g, result, active[g]); \
+    } \
+}
+#define LANE_LOGICAL_SHIFT_HANDLERS(SHIFT, shift, name, operator, negate, set_flags) \
+    FOR_EACH_WIDTH(LANE_LOGICAL_HANDLER, SHIFT, shift, name, operator, negate, set_flags)
+#define DEFINE_LANE_LOGICAL_HANDLERS(NAME, name, operator, negate, set_flags) \
+    FOR_EACH_LOGICAL_SHIFT(LANE_LOGICAL_SHIFT_HANDLERS, name, operator, negate, set_flags)
+
+LOGICAL_OPS(DEFINE_LANE_LOGICAL_HANDLERS)
+
+/**
+ * Defines the multiply lane handlers
+ */
+#define LANE_MULTIPLY_HANDLER(W, name, operator) \
+static void lanes_##name##_##W(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) { \
+    for (int g = 0; g < batch->num_vectors; g++) { \
+        if (!any_lane(active[g])) { \
+            continue; \
+        } \
+        LaneVector rn = READ_LANES(W, batch, op->rn, g); \
+        LaneVector rm = READ_LANES(W, batch, op->rm, g); \
+        LaneVector ra = READ_LANES(W, batch, op->aux, g); \
+        WRITE_LANES(W, batch, op->rd, g, ra operator rn * rm, active[g]); \
+    } \
+}
+#define DEFINE_LANE_MULTIPLY_HANDLERS(NAME, name, operator) \
+    FOR_EACH_WIDTH(LANE_MULTIPLY_HANDLER, name, operator)
+
+MULTIPLY_OPS(DEFINE_LANE_MULTIPLY_HANDLERS)
+
+/**
+ * Defines the wide move lane handlers - the operand imm16 << shift is the same
+ * in every lane
+ */
+#define LANE_WIDE_MOVE_HANDLER(W, name, opc) \
+static void lanes_##name##_##W(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) { \
+    uint64_t operand = (uint64_t) op->imm << op->aux; \
+    uint64_t mask = (((uint64_t) 1 << IMM16_LENGTH) - 1) << op->aux; \
+    for (int g = 0; g < batch->num_vectors; g++) { \
+        if (!any_lane(active[g])) { \
+            continue; \
+        } \
+        LaneVector value; \
+        if (opc == MOVZ_OPC) { \
+            value = zeroLanes + operand; \
+        } else if (opc == MOVN_OPC) { \
+            value = zeroLanes + ~operand; \
+        } else { \
+            value = (READ_LANES(W, batch, op->rd, g) & ~mask) | operand; \
+        } \
+        WRITE_LANES(W, batch, op->rd, g, value, active[g]); \
+    } \
+}
+#define DEFINE_LANE_WIDE_MOVE_HANDLERS(NAME, name, opc) \
+    FOR_EACH_WIDTH(LANE_WIDE_MOVE_HANDLER, name, opc)
+
+WIDE_MOVE_OPS(DEFINE_LANE_WIDE_MOVE_HANDLERS)
+
+/**
+ * Defines the transfer lane handlers - each guest accesses its own memory, so
+ * transfers are made one guest at a time
+ */
+#define LANE_TRANSFER_HANDLER(W, name, L, mode) \
+static void lanes_##name##_##W(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) { \
+    for (int i = 0; i < batch->num_guests; i++) { \
+        if (LANE(active, i) == 0) { \
+            continue; \
+        } \
+        uint64_t transfer_addr = read_lane(batch, W, op->rn, i); \
+        uint64_t write_back = transfer_addr + op->imm; \
+        if ((mode) == UNSIGNED_OFFSET || (mode) == PRE_INDEX) { \
+            transfer_addr = write_back; \
+        } else if ((mode) == REGISTER_OFFSET) { \
+            transfer_addr += read_lane(batch, W, op->rm, i); \
+        } \
+        if (transfer_lane(batch, i, pc, active, (L) == LOAD_L, BIT_MODE_##W, \
+                transfer_addr, op->rd) \
+                && ((mode) == PRE_INDEX || (mode) == POST_INDEX)) { \
+            write_lane(batch, W, op->rn, i, write_back); \
+        } \
+    } \
+}
+#define DEFINE_LANE_TRANSFER_HANDLERS(NAME, name, L, mode) \
+    FOR_EACH_WIDTH(LANE_TRANSFER_HANDLER, name, L, mode)
+
+TRANSFER_OPS(DEFINE_LANE_TRANSFER_HANDLERS)
+
+/**
+ * Defines the load literal lane handlers
+ */
+#define LANE_LOAD_LITERAL_HANDLER(W, name) \
+static void lanes_##name##_##W(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) { \
+    for (int i = 0; i < batch->num_guests; i++) { \
+        if (LANE(active, i) != 0) { \
+            transfer_lane(batch, i, pc, active, true, BIT_MODE_##W, (int64_t) op->imm, op->rd); \
+        } \
+    } \
+}
+
+FOR_EACH_WIDTH(LANE_LOAD_LITERAL_HANDLER, ldr_literal)
+
+static void lanes_nop(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) {
+}
+
+static void lanes_b(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) {
+    for (int i = 0; i < batch->num_guests; i++) {
+        if (LANE(active, i) != 0) {
+            batch->pc[i] = (int64_t) op->imm;
+        }
+    }
+}
+
+static void lanes_br(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) {
+    for (int i = 0; i < batch->num_guests; i++) {
+        if (LANE(active, i) != 0) {
+            batch->pc[i] = read_lane(batch, BIT_SIZE_64, op->rn, i);
+        }
+    }
+}
+
+static void lanes_b_cond(MicroOp *op, Batch *batch, uint64_t pc, LaneVector *active) {
+    for (int g = 0; g < batch->num_vectors; g++) {
+        if (!any_lane(active[g])) {
+            continue;
+        }
+        // Guests diverge here if the condition holds in only some lanes
+        LaneVector taken = get_condition_lanes(op->aux, batch, g);
+        for (int k = 0; k < LANES_PER_VECTOR; k++) {
+            if (active[g][k] != 0) {
+                batch->pc[g * LANES_PER_VECTOR + k] = taken[k] ? (int64_t) op->imm : pc + INSTR_BYTES;
+            }
+        }
+    }
+}
+
+/**
+ * Defines the static table of lane handlers, indexed by HandlerId
+ * Fused pairs and idioms have no entry, as blocks are not fused in lockstep
+ */
+#define HANDLER(W, NAME, name) [UOP_##NAME##_##W] = &lanes_##name##_##W,
+static LanePtr laneTable[NUM_HANDLERS] = {
+    [UOP_NOP] = &lanes_nop,
+    SPECIALISED_HANDLERS
+    [UOP_B] = &lanes_b,
+    [UOP_BR] = &lanes_br,
+    [UOP_B_COND] = &lanes_b_cond,
+};
+#undef HANDLER
+
+int load_batch(FILE *seeds, CPUState *cpu, Batch *batch) {
+    *batch = (Batch) {0};
+
+    // Reads the seed lines, one per guest
+    int capacity = INITIAL_SEEDS_CAPACITY;
+    char **lines = malloc(capacity * sizeof(char *));
+    int num_lines = 0;
+    char *line = NULL;
+    size_t size = 0;
+    while (lines != NULL && getline(&line, &size, seeds) != -1) {
+        if (num_lines == capacity) {
+            capacity *= 2;
+            char **grown = realloc(lines, capacity * sizeof(char *));
+            if (grown == NULL) {
+                break;
+            }
+            lines = grown;
+        }
+        lines[num_lines++] = line;
+        line = NULL;
+        size = 0;
+    }
+    free(line);
+
+    // Allocates the lockstep state, with the lanes of each guest 0
+    int num_guests = num_lines;
+    batch->num_vectors = (num_guests + LANES_PER_VECTOR - 1) / LANES_PER_VECTOR;
+    size_t lanes_size = batch->num_vectors * sizeof(LaneVector);
+    LaneVector *lanes = NULL;
+    if (num_guests > 0) {
+        lanes = aligned_alloc(LANE_VECTOR_BYTES, (NUM_GENERAL_REGISTERS + NUM_FLAGS) * lanes_size);
+    }
+    batch->guests = calloc(num_guests, sizeof(CPUState));
+    batch->reasons = calloc(num_guests, sizeof(StopReason));
+    batch->pc = calloc(num_guests, sizeof(uint64_t));
+    batch->running = calloc(num_guests, sizeof(bool));
+    batch->alone = calloc(num_guests, sizeof(bool));
+    batch->ops = calloc(MEMORY_SIZE / INSTR_BYTES, sizeof(MicroOp));
+    batch->raw = calloc(MEMORY_SIZE / INSTR_BYTES, sizeof(uint32_t));
+    batch->written = calloc(MEMORY_SIZE / INSTR_BYTES, sizeof(bool));
+    batch->registers[0] = lanes;
+    int result = -1;
+    if (lines != NULL && lanes != NULL && batch->guests != NULL && batch->reasons != NULL
+            && batch->pc != NULL && batch->running != NULL && batch->alone != NULL
+            && batch->ops != NULL && batch->raw != NULL && batch->written != NULL
+            && fork_emulator(cpu, num_guests, batch->guests) == 0) {
+        batch->num_guests = num_guests;
+        batch->image = cpu->memory;
+        memset(lanes, 0, (NUM_GENERAL_REGISTERS + NUM_FLAGS) * lanes_size);
+        for (int r = 0; r < NUM_GENERAL_REGISTERS; r++) {
+            batch->registers[r] = &lanes[r * batch->num_vectors];
+        }
+        for (int f = 0; f < NUM_FLAGS; f++) {
+            batch->flags[f] = &lanes[(NUM_GENERAL_REGISTERS + f) * batch->num_vectors];
+        }
+        result = 0;
+
+        // Applies each seed to its guest, then loads its state into its lanes
+        for (int i = 0; i < num_guests; i++) {
+            CPUState *guest = &batch->guests[i];
+            if (apply_seed(guest, lines[i], batch->written) != 0) {
+                fprintf(stderr, "Invalid seed on line %d.\n", i + 1);
+                result = -1;
+                break;
+            }
+            for (int r = 0; r < NUM_GENERAL_REGISTERS; r++) {
+                LANE(batch->registers[r], i) = guest->registers[r];
+            }
+            LANE(batch->flags[FLAG_N], i) = guest->pstate.n_flag;
+            LANE(batch->flags[FLAG_Z], i) = guest->pstate.z_flag;
+            LANE(batch->flags[FLAG_C], i) = guest->pstate.c_flag;
+            LANE(batch->flags[FLAG_V], i) = guest->pstate.v_flag;
+            batch->pc[i] = guest->pc;
+            batch->running[i] = true;
+        }
+    }
+
+    for (int i = 0; i < num_lines; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+    return result;
+}
+
+void run_batch(Batch *batch) {
+    LaneVector *active = aligned_alloc(LANE_VECTOR_BYTES, batch->num_vectors * sizeof(LaneVector));
+    // Without active lanes, every guest runs on its own
+    for (int i = 0; active == NULL && i < batch->num_guests; i++) {
+        batch->running[i] = false;
+        batch->alone[i] = true;
+    }
+
+    for (;;) {
+        // Runs the guests which are furthest behind (lowest PC) first, so that
+        // guests which diverged at a branch reconverge where their paths meet
+        uint64_t pc = UINT64_MAX;
+        bool any = false;
+        for (int i = 0; i < batch->num_guests; i++) {
+            if (batch->running[i] && batch->pc[i] <= pc) {
+                pc = batch->pc[i];
+                any = true;
+            }
+        }
+        if (!any) {
+            break;
+        }
+        for (int g = 0; g < batch->num_vectors; g++) {
+            active[g] = zeroLanes;
+        }
+        for (int i = 0; i < batch->num_guests; i++) {
+            if (batch->running[i] && batch->pc[i] == pc) {
+                LANE(active, i) = UINT64_MAX;
+            }
+        }
+        run_block(batch, pc, active);
+    }
+    free(active);
+
+    // Finishes each guest which left lockstep on its own
+    for (int i = 0; i < batch->num_guests; i++) {
+        if (batch->alone[i]) {
+            batch->reasons[i] = run_emulator(&batch->guests[i]);
+        }
+    }
+}
+
+void free_batch(Batch *batch) {
+    for (int i = 0; i < batch->num_guests; i++) {
+        free_emulator(&batch->guests[i]);
+    }
+    free(batch->guests);
+    free(batch->reasons);
+    free(batch->pc);
+    free(batch->running);
+    free(batch->alone);
+    free(batch->ops);
+    free(batch->raw);
+    free(batch->written);
+    // The lanes of every register and flag are allocated together
+    free(batch->registers[0]);
+}
+
+static void run_block(Batch *batch, uint64_t pc, LaneVector *active) {
+    for (;;) {
+        // The PC is out of bounds or misaligned - each guest faults on its own
+        if (pc >= MEMORY_SIZE || pc % INSTR_BYTES != 0) {
+            for (int i = 0; i < batch->num_guests; i++) {
+                if (LANE(active, i) != 0) {
+                    leave_lockstep(batch, i, pc, active, false);
+                }
+            }
+            return;
+        }
+
+        uint64_t index = pc / INSTR_BYTES;
+        MicroOp *op = &batch->ops[index];
+        if (op->handler == UOP_DECODE) {
+            decode_word(batch, index);
+        }
+
+        // A guest which overwrote this word runs its own code on its own
+        bool any = false;
+        for (int i = 0; i < batch->num_guests; i++) {
+            if (LANE(active, i) == 0) {
+                continue;
+            }
+            if (batch->written[index]
+                    && read_memory(BIT_MODE_32, batch->guests[i].memory, pc) != batch->raw[index]) {
+                leave_lockstep(batch, i, pc, active, false);
+            } else if (batch->raw[index] == HALT_PATTERN) {
+                leave_lockstep(batch, i, pc, active, true);
+            } else {
+                any = true;
+            }
+        }
+        if (!any) {
+            return;
+        }
+
+        laneTable[op->handler](op, batch, pc, active);
+
+        // A branch ends the block, leaving the PC of each guest at its target
+        if (op->handler == UOP_B || op->handler == UOP_BR || op->handler == UOP_B_COND) {
+            return;
+        }
+        pc += INSTR_BYTES;
+    }
+}
+
+static void leave_lockstep(Batch *batch, int guest, uint64_t pc, LaneVector *active, bool halted) {
+    CPUState *cpu = &batch->guests[guest];
+    for (int r = 0; r < NUM_GENERAL_REGISTERS; r++) {
+        cpu->registers[r] = LANE(batch->registers[r], guest);
+    }
+    PState pstate = {
+        .n_flag = LANE(batch->flags[FLAG_N], guest),
+        .z_flag = LANE(batch->flags[FLAG_Z], guest),
+        .c_flag = LANE(batch->flags[FLAG_C], guest),
+        .v_flag = LANE(batch->flags[FLAG_V], guest),
+    };
+    cpu->pstate = pstate;
+    cpu->pc = pc;
+    batch->pc[guest] = pc;
+    batch->running[guest] = false;
+    batch->alone[guest] = !halted;
+    batch->reasons[guest] = STOP_HALT;
+    LANE(active, guest) = 0;
+}
+
+static void decode_word(Batch *batch, uint64_t index) {
+    uint64_t address = index * INSTR_BYTES;
+    uint32_t instr = read_memory(BIT_MODE_32, batch->image, address);
+    batch->raw[index] = instr;
+    // The halt word is checked for before execution, so it needs no micro-op,
+    // and an undefined word is executed as a nop
+    Instr decoded;
+    if (instr == NOP_PATTERN || instr == HALT_PATTERN || decode(instr, &decoded) != 0) {
+        batch->ops[index] = (MicroOp) { .handler = UOP_NOP };
+    } else {
+        lower_instr(&decoded, address, &batch->ops[index]);
+    }
+}
+
+static bool transfer_lane(Batch *batch, int guest, uint64_t pc, LaneVector *active, bool load,
+        BitMode mode, uint64_t address, uint32_t rt) {
+    int width = mode == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64;
+    int bytes = width / CHAR_BIT;
+    // A guest whose access would fault does so on its own
+    uint64_t base = address;
+    if (base > MEMORY_SIZE - bytes) {
+        leave_lockstep(batch, guest, pc, active, false);
+        return false;
+    }
+    uint8_t *memory = batch->guests[guest].memory;
+    if (load) {
+        write_lane(batch, width, rt, guest, read_memory(mode, memory, base));
+    } else {
+        write_memory(mode, memory, base, read_lane(batch, width, rt, guest));
+        mark_written(batch, base, bytes);
+    }
+    return true;
+}
+
+static void mark_written(Batch *batch, uint64_t address, int bytes) {
+    for (uint64_t word = address / INSTR_BYTES; word <= (address + bytes - 1) / INSTR_BYTES; word++) {
+        batch->written[word] = true;
+    }
+}
+
+static uint64_t read_lane(Batch *batch, int width, uint32_t index, int guest) {
+    if (index == ZERO_REG_INDEX) {
+        return ZERO_REG_VAL;
+    }
+    uint64_t value = LANE(batch->registers[index], guest);
+    return width == BIT_SIZE_32 ? truncate_32_bits(value) : value;
+}
+
+static void write_lane(Batch *batch, int width, uint32_t index, int guest, uint64_t value) {
+    if (index != ZERO_REG_INDEX) {
+        LANE(batch->registers[index], guest) = width == BIT_SIZE_32 ? truncate_32_bits(value) : value;
+    }
+}
+
+static bool any_lane(LaneVector lanes) {
+    for (int k = 0; k < LANES_PER_VECTOR; k++) {
+        if (lanes[k] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void write_flag_lanes(Batch *batch, int g, LaneVector mask, LaneVector n, LaneVector z,
+        LaneVector c, LaneVector v) {
+    batch->flags[FLAG_N][g] = LANE_SELECT(mask, n, batch->flags[FLAG_N][g]);
+    batch->flags[FLAG_Z][g] = LANE_SELECT(mask, z, batch->flags[FLAG_Z][g]);
+    batch->flags[FLAG_C][g] = LANE_SELECT(mask, c, batch->flags[FLAG_C][g]);
+    batch->flags[FLAG_V][g] = LANE_SELECT(mask, v, batch->flags[FLAG_V][g]);
+}
+
+static LaneVector get_condition_lanes(uint8_t cond, Batch *batch, int g) {
+    LaneVector z = batch->flags[FLAG_Z][g];
+    // N == V in the lanes where ge holds
+    LaneVector ge = (batch->flags[FLAG_N][g] ^ batch->flags[FLAG_V][g]) ^ 1;
+    switch (cond) {
+        case EQ:
+            return z;
+        case NE:
+            return z ^ 1;
+        case GE:
+            return ge;
+        case LT:
+            return ge ^ 1;
+        case GT:
+            return (z ^ 1) & ge;
+        case LE:
+            return ((z ^ 1) & ge) ^ 1;
+        case AL:
+            return zeroLanes + 1;
+        default:
+            // Assume valid condition code - should not reach this case
+            assert(0);
+            return zeroLanes;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "emulator.h"
+#include "micro_op.h"
+
+/**
+ * Represents a vector of 64-bit lanes, one per guest, which the host operates
+ * on with SIMD instructions (16 bytes: the SSE2/NEON register width)
+ */
+#define LANE_VECTOR_BYTES 16
+#define LANES_PER_VECTOR (LANE_VECTOR_BYTES / (int) sizeof(uint64_t))
+typedef uint64_t LaneVector __attribute__((vector_size(LANE_VECTOR_BYTES)));
+
+/**
+ * Represents the index of each condition flag in the lane vectors of a batch
+ */
+typedef enum {
+    FLAG_N,
+    FLAG_Z,
+    FLAG_C,
+    FLAG_V,
+    NUM_FLAGS,
+} FlagIndex;
+
+/**
+ * Represents a batch of guests which run the same binary in lockstep:
+ * num_guests:  Number of guests
+ * guests:      CPU state of each guest - its memory (a copy-on-write copy of
+ *              the loaded binary), and its registers, PC and flags once it has
+ *              left lockstep
+ * reasons:     Reason each guest stopped
+ * num_vectors: Number of lane vectors which hold one value of every guest
+ * registers:   Each general-purpose register of every guest, in lane vectors
+ *              (struct-of-arrays layout)
+ * flags:       Each condition flag (N, Z, C, V: 0 or 1) of every guest, in
+ *              lane vectors
+ * pc:          PC of each guest
+ * running:     Set while a guest runs in lockstep
+ * alone:       Set if a guest left lockstep before it stopped, to finish on
+ *              its own (see run_batch)
+ * image:       Memory holding the binary, from which instructions are decoded
+ * ops:         Micro-op of each word of the binary, decoded on first execution
+ * raw:         Word from which each micro-op was decoded
+ * written:     Set for each word which some guest has written
+ */
+typedef struct {
+    int num_guests;
+    CPUState *guests;
+    StopReason *reasons;
+    int num_vectors;
+    LaneVector *registers[NUM_GENERAL_REGISTERS];
+    LaneVector *flags[NUM_FLAGS];
+    uint64_t *pc;
+    bool *running;
+    bool *alone;
+    uint8_t *image;
+    MicroOp *ops;
+    uint32_t *raw;
+    bool *written;
+} Batch;
+
+/**
+ * Forks a loaded, paused emulator into a batch of guests, one per line of a
+ * seeds file. Each line is a whitespace-separated list of assignments applied
+ * to its guest: xN=VALUE sets register N, ADDR=WORD writes a 32-bit word to
+ * memory (an empty line runs the binary unchanged)
+ * The forked emulator keeps the binary, which the batch decodes
+ * Returns 0 if success and -1 otherwise
+ */
+extern int load_batch(FILE *, CPUState *, Batch *);
+
+/**
+ * Runs every guest of a batch until it stops, storing the reason in reasons:
+ * Each step runs a basic block for every guest whose PC is the lowest, with
+ * their registers and flags updated a lane vector at a time, so guests which
+ * diverge at a branch reconverge where their paths meet
+ * A guest which accesses memory out of bounds, executes code which a guest
+ * has overwritten, or jumps to a misaligned address leaves lockstep, and
+ * finishes on its own with run_emulator (which handles each case precisely)
+ */
+extern void run_batch(Batch *);
+
+/**
+ * Frees the guests of a batch and its lockstep state
+ */
+extern void free_batch(Batch *);
+
+#endif
\ No newline at end of file
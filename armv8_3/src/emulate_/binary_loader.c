@@ -1,14 +1,30 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "binary_loader.h"
 #include "../common/utilities.h"
+#include "../common/image_format.h"
 
 /**
  * Returns the size of a file in bytes or -1 if failure
  */
 static int get_file_size(FILE *);
 
+/**
+ * Returns true if a file of a given size starts with the header of a segmented
+ * image (and moves the file pointer back to the start)
+ */
+static bool is_segmented(FILE *, int);
+
+/**
+ * Loads a segmented image of a given size into memory: reads the contents of
+ * each data segment directly to its address, leaving zero segments untouched
+ * Returns the end address of the last segment if success and -1 otherwise
+ */
+static int load_segmented(FILE *, uint8_t *, int);
+
 FILE *open_file(char filename[]) {
     return fopen(filename, "rb");
 }
@@ -19,6 +35,10 @@ int close_file(FILE *fp) {
 
 int load_file(FILE *fp, uint8_t *memory) {
     int file_size = get_file_size(fp);
+    // Loads segmented images segment by segment
+    if (file_size >= 0 && is_segmented(fp, file_size)) {
+        return load_segmented(fp, memory, file_size);
+    }
     // Returns -1 if file size is negative or greater than emulator memory size
     if (file_size < 0  || file_size > MEMORY_SIZE) {
         return -1;
@@ -29,8 +49,51 @@ int load_file(FILE *fp, uint8_t *memory) {
     if (num_bytes_read != file_size && ferror(fp)) {
         return -1;
     }
-    // Returns 0 if the file has been read successfully
-    return 0;
+    // Returns the size of the file if it has been read successfully
+    return file_size;
+}
+
+static bool is_segmented(FILE *fp, int file_size) {
+    ImageHeader header;
+    bool segmented = file_size >= (int) sizeof(header)
+        && fread(&header, sizeof(header), 1, fp) == 1
+        && memcmp(header.magic, IMAGE_MAGIC, IMAGE_MAGIC_LENGTH) == 0;
+    rewind(fp);
+    return segmented;
+}
+
+static int load_segmented(FILE *fp, uint8_t *memory, int file_size) {
+    ImageHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1) {
+        return -1;
+    }
+
+    uint64_t end = 0;
+    for (uint32_t i = 0; i < header.num_segments; i++) {
+        // Reads the next segment header (segment contents are read after it,
+        // so the file pointer is moved back to the table each time)
+        long table_offset = sizeof(header) + (long) i * sizeof(SegmentHeader);
+        SegmentHeader segment;
+        if (fseek(fp, table_offset, SEEK_SET) != 0 || fread(&segment, sizeof(segment), 1, fp) != 1) {
+            return -1;
+        }
+        // Returns -1 if the segment does not fit in memory (or the file)
+        uint64_t segment_end = (uint64_t) segment.address + segment.size;
+        if (segment_end > MEMORY_SIZE) {
+            return -1;
+        }
+        if (segment.type == SEGMENT_DATA) {
+            if ((uint64_t) segment.offset + segment.size > (uint64_t) file_size
+                    || fseek(fp, segment.offset, SEEK_SET) != 0
+                    || fread(memory + segment.address, sizeof(uint8_t), segment.size, fp) != segment.size) {
+                return -1;
+            }
+        } else if (segment.type != SEGMENT_ZERO) {
+            return -1;
+        }
+        end = segment_end > end ? segment_end : end;
+    }
+    return end;
 }
 
 static int get_file_size(FILE *fp) {
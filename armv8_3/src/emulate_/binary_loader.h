@@ -16,8 +16,10 @@ extern FILE *open_file(char[]);
 extern int close_file(FILE *);
 
 /**
- * Loads a binary file into byte-addressable memory given by a pointer - returns
- * 0 if success and -1 otherwise
+ * Loads a binary file, either a flat image or a segmented image (see
+ * image_format.h), into byte-addressable memory given by a pointer - returns
+ * the size of the image in bytes (the end address of its last segment) if
+ * success and -1 otherwise
  */
 extern int load_file(FILE *, uint8_t *);
 
@@ -3,26 +3,11 @@
 #include <assert.h>
 
 #include "branch.h"
+#include "micro_op.h"
 #include "../common/utilities.h"
 #include "../common/instructions.h"
 #include "registers.h"
 
-/**
- * Executes a decoded unconditional branch instruction
- */
-static void execute_unconditional(Instr *, CPUState *);
-
-/**
- * Executes a decoded register branch instruction
- */ 
-static void execute_register(Instr *, CPUState *);
-
-/**
- * Executes a decoded conditional branch instruction
- * Returns a boolean representing whether the branch condition was satisfied
- */
-static bool execute_conditional(Instr *, CPUState *);
-
 /**
  * For a given condition code, determines whether its corresponding condition
  * holds using the condition flags of the PSTATE register:
@@ -36,47 +21,23 @@ static bool execute_conditional(Instr *, CPUState *);
  */
 static int evaluate_condition(uint8_t, CPUState *);
 
-void decode_branch(uint32_t instr, Instr *decoded) {
-    BranchFormat format;
-
-    // Identifies the branch subtype (uncond, register, cond) using bits 30-31
-    switch (extract_bits(instr, BRANCH_IDENTIFIER_START, BRANCH_IDENTIFIER_END)) {
-        case UNCONDITIONAL_IDENTIFIER:
-            // Sets fields for Unconditional Branch type
-            format.branch_type = UNCONDITIONAL;
-            format.Unconditional.simm26 = extract_bits(instr, SIMM26_START, SIMM26_END);
-            break;
-        case REGISTER_IDENTIFIER:
-            // Sets fields for Register Branch type
-            format.branch_type = REGISTER;
-            format.Register.xn = extract_bits(instr, XN_START, XN_END);
-            break;
-        case CONDITIONAL_IDENTIFIER:
-            // Sets fields for Conditional Branch type
-            format.branch_type = CONDITIONAL;
-            format.Conditional.simm19 = (int32_t) extract_bits(instr, SIMM19_START, SIMM19_END);
-            format.Conditional.cond = extract_bits(instr, COND_START, COND_END);
-            break;
-    }
-
-    // Sets the type and format of the decoded instruction
-    decoded->type = BRANCH;
-    decoded->format.branch_format = format;
-}
-
-void execute_branch(Instr *instr, CPUState *cpu) {
-    switch (instr->format.branch_format.branch_type) {
+void lower_branch(Instr *instr, uint64_t address, MicroOp *op) {
+    BranchFormat format = instr->format.branch_format;
+    switch (format.branch_type) {
         case UNCONDITIONAL:
-            execute_unconditional(instr, cpu);
+            op->handler = UOP_B;
+            // Precomputes the absolute target PC + simm26 * 4
+            op->imm = calculate_pc_offset(address, format.Unconditional.simm26, SIMM26_LENGTH);
             break;
         case REGISTER:
-            execute_register(instr, cpu);
+            op->handler = UOP_BR;
+            op->rn = format.Register.xn;
             break;
         case CONDITIONAL:
-            // Increments the PC as normal if branch condition was not satisfied
-            if (!execute_conditional(instr, cpu)) {
-                increment_pc(cpu);
-            }
+            op->handler = UOP_B_COND;
+            // Precomputes the absolute target PC + simm19 * 4
+            op->imm = calculate_pc_offset(address, format.Conditional.simm19, SIMM19_LENGTH);
+            op->aux = format.Conditional.cond;
             break;
         default:
             // Assume valid instruction - should not reach this case 
@@ -84,26 +45,27 @@ void execute_branch(Instr *instr, CPUState *cpu) {
     }
 }
 
-static void execute_unconditional(Instr *instr, CPUState *cpu) {
-    // Adds the offset simm26 * 4 to the program counter
-    int32_t offset = instr->format.branch_format.Unconditional.simm26;
-    cpu->pc = calculate_pc_offset(cpu->pc, offset, SIMM26_LENGTH);
+int execute_b(MicroOp *op, CPUState *cpu) {
+    // Sets the program counter to the precomputed target
+    cpu->pc = (int64_t) op->imm;
+    return 1;
 }
 
-static void execute_register(Instr *instr, CPUState *cpu) {
+int execute_br(MicroOp *op, CPUState *cpu) {
     // Sets the program counter to the address stored in register Xn
-    cpu->pc = read_register(BIT_SIZE_64, cpu->registers, instr->format.branch_format.Register.xn);
+    cpu->pc = READ_REGISTER(64, cpu->registers, op->rn);
+    return 1;
 }
 
-static bool execute_conditional(Instr *instr, CPUState *cpu) {
-    // Adds the offset simm19 * 4 to the program counter if condition satisfied
-    if (evaluate_condition(instr->format.branch_format.Conditional.cond, cpu)) {
-        int32_t offset = instr->format.branch_format.Conditional.simm19;
-        cpu->pc = calculate_pc_offset(cpu->pc, offset, SIMM19_LENGTH);
-        // Returns true if branch condition is satisfied
-        return true;
+int execute_b_cond(MicroOp *op, CPUState *cpu) {
+    // Branches to the precomputed target if the condition is satisfied,
+    // otherwise increments the PC as normal
+    if (evaluate_condition(op->aux, cpu)) {
+        cpu->pc = (int64_t) op->imm;
+    } else {
+        increment_pc(cpu);
     }
-    return false;
+    return 1;
 }
 
 static int evaluate_condition(uint8_t cond, CPUState *cpu) {
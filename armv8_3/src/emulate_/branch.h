@@ -5,16 +5,26 @@
 
 #include "../common/utilities.h"
 #include "../common/instructions.h"
+#include "micro_op.h"
 
 /**
- * Decodes a 32-bit branch instruction into an internal representation
+ * Lowers a decoded branch instruction at a given address into a micro-op
  */
-extern void decode_branch(uint32_t, Instr *);
+extern void lower_branch(Instr *, uint64_t, MicroOp *);
 
 /**
- * Executes a decoded branch instruction using a pointer to its internal
- * representation and updates the CPU state accordingly
+ * Executes an unconditional branch micro-op
  */
-extern void execute_branch(Instr *, CPUState *);
+extern int execute_b(MicroOp *, CPUState *);
+
+/**
+ * Executes a register branch micro-op
+ */
+extern int execute_br(MicroOp *, CPUState *);
+
+/**
+ * Executes a conditional branch micro-op
+ */
+extern int execute_b_cond(MicroOp *, CPUState *);
 
 #endif
\ No newline at end of file
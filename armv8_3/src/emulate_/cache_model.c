@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cache_model.h"
+#include "symbols.h"
+
+// Delimiter between the fields of a cache configuration
+#define CONFIG_DELIMITER ":"
+// Number of required and optional fields in a cache configuration
+#define NUM_REQUIRED_FIELDS 4
+#define NUM_CONFIG_FIELDS 6
+// Multipliers of the size suffixes k and m
+#define KILOBYTE 1024
+#define MEGABYTE (1024 * 1024)
+// Seed of the generator which chooses random victims (xorshift64)
+#define RANDOM_SEED 0x9e3779b97f4a7c15
+
+/**
+ * Names of the cache levels and replacement policies, as configured and
+ * reported
+ */
+static const char *levelNames[NUM_CACHE_LEVELS] = {
+    [CACHE_L1I] = "l1i",
+    [CACHE_L1D] = "l1d",
+    [CACHE_L2] = "l2",
+};
+static const char *policyNames[] = {
+    [REPLACE_LRU] = "lru",
+    [REPLACE_FIFO] = "fifo",
+    [REPLACE_RANDOM] = "random",
+};
+
+/**
+ * Looks up a line in a cache, and fills it in if it missed
+ * Returns true if the cache held the line
+ */
+static bool access_line(CacheModel *, Cache *, uint64_t);
+
+/**
+ * Returns the next random number of the generator of a cache model
+ */
+static uint64_t next_random(CacheModel *);
+
+/**
+ * Parses a size in bytes with an optional k or m suffix
+ * Returns 0 if success and -1 if the size is invalid
+ */
+static int parse_size(char *, uint64_t *);
+
+/**
+ * Writes the counters of the accesses under a label to a file stream
+ */
+static void write_counters(CacheCounters *, FILE *);
+
+void get_default_caches(CacheConfig *configs) {
+    configs[CACHE_L1I] = (CacheConfig) {
+        .size = 32 * KILOBYTE, .ways = 2, .line_size = 64, .policy = REPLACE_LRU, .latency = 0,
+    };
+    configs[CACHE_L1D] = (CacheConfig) {
+        .size = 32 * KILOBYTE, .ways = 4, .line_size = 64, .policy = REPLACE_LRU, .latency = 0,
+    };
+    configs[CACHE_L2] = (CacheConfig) {
+        .size = 512 * KILOBYTE, .ways = 16, .line_size = 64, .policy = REPLACE_LRU, .latency = 12,
+    };
+}
+
+int parse_cache_config(char *string, CacheConfig *configs) {
+    char *fields[NUM_CONFIG_FIELDS];
+    int num_fields = 0;
+    for (char *field = strtok(string, CONFIG_DELIMITER); field != NULL;
+            field = strtok(NULL, CONFIG_DELIMITER)) {
+        if (num_fields == NUM_CONFIG_FIELDS) {
+            return -1;
+        }
+        fields[num_fields++] = field;
+    }
+    if (num_fields < NUM_REQUIRED_FIELDS) {
+        return -1;
+    }
+
+    // Finds the level, keeping its latency unless one is given
+    int level = 0;
+    while (level < NUM_CACHE_LEVELS && strcmp(fields[0], levelNames[level]) != 0) {
+        level++;
+    }
+    if (level == NUM_CACHE_LEVELS) {
+        return -1;
+    }
+    CacheConfig config = configs[level];
+    char *end;
+    if (parse_size(fields[1], &config.size) != 0) {
+        return -1;
+    }
+    config.ways = strtoull(fields[2], &end, 10);
+    if (end == fields[2] || *end != '\0') {
+        return -1;
+    }
+    if (parse_size(fields[3], &config.line_size) != 0) {
+        return -1;
+    }
+    config.policy = REPLACE_LRU;
+    if (num_fields > 4) {
+        int policy = REPLACE_LRU;
+        while (policy <= REPLACE_RANDOM && strcmp(fields[4], policyNames[policy]) != 0) {
+            policy++;
+        }
+        if (policy > REPLACE_RANDOM) {
+            return -1;
+        }
+        config.policy = policy;
+    }
+    if (num_fields > 5) {
+        config.latency = strtoull(fields[5], &end, 10);
+        if (end == fields[5] || *end != '\0') {
+            return -1;
+        }
+    }
+
+    // Lines must be a power of 2 bytes, and each set must hold at least one
+    // line of every way
+    bool valid = config.line_size > 0 && (config.line_size & (config.line_size - 1)) == 0
+        && config.ways > 0 && config.size % (config.ways * config.line_size) == 0
+        && config.size >= config.ways * config.line_size;
+    if (!valid) {
+        return -1;
+    }
+    configs[level] = config;
+    return 0;
+}
+
+int start_cache_model(CacheModel *model, CacheConfig *configs, uint64_t memory_latency,
+        SymbolMap *symbols) {
+    *model = (CacheModel) {
+        .memory_latency = memory_latency,
+        .random = RANDOM_SEED,
+        .symbols = symbols,
+    };
+    int num_counters = (symbols == NULL ? 0 : symbols->num_symbols) + 1;
+    model->counters = calloc(num_counters, sizeof(CacheCounters));
+    bool allocated = model->counters != NULL;
+    for (int level = 0; level < NUM_CACHE_LEVELS; level++) {
+        Cache *cache = &model->caches[level];
+        cache->config = configs[level];
+        cache->num_sets = configs[level].size / (configs[level].ways * configs[level].line_size);
+        cache->tags = calloc(configs[level].size / configs[level].line_size, sizeof(uint64_t));
+        cache->stamps = calloc(configs[level].size / configs[level].line_size, sizeof(uint64_t));
+        allocated = allocated && cache->tags != NULL && cache->stamps != NULL;
+    }
+    if (!allocated) {
+        stop_cache_model(model);
+        return -1;
+    }
+    return 0;
+}
+
+void model_access(CacheModel *model, AccessType type, uint64_t pc, uint64_t address, int bytes) {
+    CacheCounters *counters = &model->counters[0];
+    if (model->symbols != NULL) {
+        counters = &model->counters[find_symbol(model->symbols, pc) + 1];
+    }
+    CacheLevel level = type == ACCESS_FETCH ? CACHE_L1I : CACHE_L1D;
+    Cache *l1 = &model->caches[level];
+    Cache *l2 = &model->caches[CACHE_L2];
+
+    // Looks up each L1 line which the access spans (L2 lines may be larger)
+    uint64_t line_size = l1->config.line_size;
+    for (uint64_t line = address / line_size; line <= (address + bytes - 1) / line_size; line++) {
+        uint64_t stalls = l1->config.latency;
+        bool l1_hit = access_line(model, l1, line);
+        bool l2_hit = true;
+        if (!l1_hit) {
+            l2_hit = access_line(model, l2, line * line_size / l2->config.line_size);
+            stalls = l2->config.latency + (l2_hit ? 0 : model->memory_latency);
+        }
+
+        CacheCounters *targets[] = {counters, &model->total};
+        for (int i = 0; i < 2; i++) {
+            if (type == ACCESS_FETCH) {
+                targets[i]->fetches++;
+                targets[i]->fetch_misses += !l1_hit;
+            } else {
+                targets[i]->data++;
+                targets[i]->data_misses += !l1_hit;
+            }
+            targets[i]->l2_misses += !l2_hit;
+            targets[i]->stalls += stalls;
+        }
+    }
+}
+
+void write_cache_report(CacheModel *model, FILE *fp) {
+    fprintf(fp, "%s", "Caches:\n");
+    for (int level = 0; level < NUM_CACHE_LEVELS; level++) {
+        Cache *cache = &model->caches[level];
+        uint64_t accesses = cache->hits + cache->misses;
+        fprintf(fp, "  %-3s %7lu bytes, %2lu-way, %3lu-byte lines, %-6s: %lu hits, %lu misses (%.2f%%)\n",
+            levelNames[level], cache->config.size, cache->config.ways, cache->config.line_size,
+            policyNames[cache->config.policy], cache->hits, cache->misses,
+            accesses == 0 ? 0.0 : 100.0 * cache->misses / accesses);
+    }
+    fprintf(fp, "Estimated stall cycles: %lu\n", model->total.stalls);
+
+    // Writes the counters under each label which made an access
+    fprintf(fp, "%-26s %10s %8s %10s %8s %8s %12s\n",
+        "Label", "Fetches", "Misses", "Data", "Misses", "L2 miss", "Stalls");
+    int num_labels = model->symbols == NULL ? 0 : model->symbols->num_symbols;
+    for (int i = 0; i <= num_labels; i++) {
+        CacheCounters *counters = &model->counters[i];
+        if (counters->fetches + counters->data == 0) {
+            continue;
+        }
+        fprintf(fp, "%-26s ", i == 0 ? "(start)" : model->symbols->symbols[i - 1].name);
+        write_counters(counters, fp);
+    }
+    fprintf(fp, "%-26s ", "(total)");
+    write_counters(&model->total, fp);
+}
+
+void stop_cache_model(CacheModel *model) {
+    for (int level = 0; level < NUM_CACHE_LEVELS; level++) {
+        free(model->caches[level].tags);
+        free(model->caches[level].stamps);
+    }
+    free(model->counters);
+}
+
+static bool access_line(CacheModel *model, Cache *cache, uint64_t line) {
+    uint64_t ways = cache->config.ways;
+    uint64_t *tags = &cache->tags[(line % cache->num_sets) * ways];
+    uint64_t *stamps = &cache->stamps[(line % cache->num_sets) * ways];
+    model->time++;
+
+    for (uint64_t way = 0; way < ways; way++) {
+        if (tags[way] == line + 1) {
+            // Only LRU ages lines on use - FIFO keeps the time of the fill
+            if (cache->config.policy == REPLACE_LRU) {
+                stamps[way] = model->time;
+            }
+            cache->hits++;
+            return true;
+        }
+    }
+
+    // Fills an empty way if any, otherwise replaces a victim chosen by the
+    // replacement policy (the oldest stamp, for LRU and FIFO)
+    uint64_t victim = 0;
+    while (victim < ways && tags[victim] != 0) {
+        victim++;
+    }
+    if (victim == ways && cache->config.policy == REPLACE_RANDOM) {
+        victim = next_random(model) % ways;
+    } else if (victim == ways) {
+        victim = 0;
+        for (uint64_t way = 1; way < ways; way++) {
+            if (stamps[way] < stamps[victim]) {
+                victim = way;
+            }
+        }
+    }
+    tags[victim] = line + 1;
+    stamps[victim] = model->time;
+    cache->misses++;
+    return false;
+}
+
+static uint64_t next_random(CacheModel *model) {
+    model->random ^= model->random << 13;
+    model->random ^= model->random >> 7;
+    model->random ^= model->random << 17;
+    return model->random;
+}
+
+static int parse_size(char *string, uint64_t *size) {
+    char *end;
+    *size = strtoull(string, &end, 10);
+    if (end == string) {
+        return -1;
+    }
+    if (*end == 'k' || *end == 'K') {
+        *size *= KILOBYTE;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        *size *= MEGABYTE;
+        end++;
+    }
+    return *end == '\0' && *size > 0 ? 0 : -1;
+}
+
+static void write_counters(CacheCounters *counters, FILE *fp) {
+    fprintf(fp, "%10lu %8lu %10lu %8lu %8lu %12lu\n", counters->fetches, counters->fetch_misses,
+        counters->data, counters->data_misses, counters->l2_misses, counters->stalls);
+}
\ No newline at end of file
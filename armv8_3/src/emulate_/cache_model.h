@@ -0,0 +1,160 @@
+#ifndef CACHE_MODEL_H
+#define CACHE_MODEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "symbols.h"
+
+/**
+ * Represents the levels of the simulated cache hierarchy: split level 1
+ * instruction and data caches, backed by a unified level 2 cache
+ */
+typedef enum {
+    CACHE_L1I,
+    CACHE_L1D,
+    CACHE_L2,
+    NUM_CACHE_LEVELS,
+} CacheLevel;
+
+/**
+ * Represents the policies which choose the line of a full set to replace
+ */
+typedef enum {
+    REPLACE_LRU,
+    REPLACE_FIFO,
+    REPLACE_RANDOM,
+} ReplacementPolicy;
+
+/**
+ * Represents the types of memory access which the caches are given
+ */
+typedef enum {
+    ACCESS_FETCH,
+    ACCESS_LOAD,
+    ACCESS_STORE,
+} AccessType;
+
+/**
+ * Represents the configuration of a cache:
+ * size:      Capacity in bytes
+ * ways:      Associativity (number of lines in a set)
+ * line_size: Line size in bytes (a power of 2)
+ * policy:    Replacement policy
+ * latency:   Stall cycles of an access served by this cache
+ */
+typedef struct {
+    uint64_t size;
+    uint64_t ways;
+    uint64_t line_size;
+    ReplacementPolicy policy;
+    uint64_t latency;
+} CacheConfig;
+
+/**
+ * Represents a simulated cache:
+ * config:   Configuration
+ * num_sets: Number of sets
+ * tags:     Line number (address / line size) + 1 held by each way of each
+ *           set, 0 if the way is empty
+ * stamps:   Time at which each way was last used (LRU) or filled (FIFO)
+ * hits:     Number of accesses to a line which the cache held
+ * misses:   Number of accesses to a line which the cache did not hold
+ */
+typedef struct {
+    CacheConfig config;
+    uint64_t num_sets;
+    uint64_t *tags;
+    uint64_t *stamps;
+    uint64_t hits;
+    uint64_t misses;
+} Cache;
+
+/**
+ * Represents the counters of the accesses made by the instructions under a
+ * label (or by every instruction):
+ * fetches:      Number of lines fetched
+ * fetch_misses: Number of fetched lines missed by L1I
+ * data:         Number of lines loaded or stored
+ * data_misses:  Number of loaded or stored lines missed by L1D
+ * l2_misses:    Number of lines missed by L2
+ * stalls:       Estimated stall cycles
+ */
+typedef struct {
+    uint64_t fetches;
+    uint64_t fetch_misses;
+    uint64_t data;
+    uint64_t data_misses;
+    uint64_t l2_misses;
+    uint64_t stalls;
+} CacheCounters;
+
+/**
+ * Represents the simulated cache hierarchy, which every instruction fetch and
+ * data access of the guest is passed through:
+ * caches:         Cache at each level
+ * memory_latency: Stall cycles of an access served by memory (in addition to
+ *                 the latency of L2)
+ * time:           Number of lines accessed so far
+ * random:         State of the generator which chooses random victims
+ * symbols:        Symbol map by which accesses are counted (NULL if none)
+ * counters:       Counters of the accesses made under each label (index i + 1
+ *                 for label i) and before the first label (index 0)
+ * total:          Counters of every access
+ */
+typedef struct CacheModel {
+    Cache caches[NUM_CACHE_LEVELS];
+    uint64_t memory_latency;
+    uint64_t time;
+    uint64_t random;
+    SymbolMap *symbols;
+    CacheCounters *counters;
+    CacheCounters total;
+} CacheModel;
+
+// Default stall cycles of an access served by memory
+#define DEFAULT_MEMORY_LATENCY 100
+
+/**
+ * Sets the default configuration of each cache level, modelled on a Cortex-A
+ * class core: 32KB 2-way L1I, 32KB 4-way L1D, 512KB 16-way L2 (64-byte lines,
+ * LRU replacement, L2 latency 12 cycles)
+ */
+extern void get_default_caches(CacheConfig *);
+
+/**
+ * Parses the configuration of a cache level, LEVEL:SIZE:WAYS:LINE[:POLICY[:LATENCY]]
+ * (eg: l1d:32k:4:64:lru), into the configuration of every level
+ * LEVEL is l1i, l1d or l2, SIZE is in bytes (with an optional k or m suffix),
+ * and POLICY is lru, fifo or random
+ * Returns 0 if success and -1 if the configuration is invalid
+ */
+extern int parse_cache_config(char *, CacheConfig *);
+
+/**
+ * Starts simulating an empty cache hierarchy with the configuration of every
+ * level, a memory latency and a symbol map (or NULL)
+ * Returns 0 if success and -1 if allocation fails
+ */
+extern int start_cache_model(CacheModel *, CacheConfig *, uint64_t, SymbolMap *);
+
+/**
+ * Passes an access of a number of bytes at a guest address, made by the
+ * instruction at a given PC, through the cache hierarchy: each line it spans
+ * is looked up in L1I (fetches) or L1D (loads and stores), then in L2 if it
+ * missed, and filled into each cache which missed it (write-allocate)
+ */
+extern void model_access(CacheModel *, AccessType, uint64_t, uint64_t, int);
+
+/**
+ * Writes the hits and misses of each cache, and the accesses, misses and
+ * estimated stall cycles under each label, to a file stream
+ */
+extern void write_cache_report(CacheModel *, FILE *);
+
+/**
+ * Stops simulating a cache hierarchy, freeing it
+ */
+extern void stop_cache_model(CacheModel *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "coverage.h"
+#include "symbols.h"
+#include "../common/utilities.h"
+
+/**
+ * Represents the coverage of a source line
+ */
+typedef enum {
+    LINE_NO_INSTRUCTIONS,
+    LINE_NOT_EXECUTED,
+    LINE_EXECUTED,
+} LineCoverage;
+
+/**
+ * Returns the coverage of each source line number of a symbol map (a line is
+ * executed if any of its instructions is marked in a coverage bitmap), and
+ * sets the highest line number
+ * Returns NULL if the map has no source lines or allocation fails
+ */
+static LineCoverage *get_line_coverage(uint8_t *, SymbolMap *, int *);
+
+uint8_t *allocate_coverage(void) {
+    return calloc(COVERAGE_BYTES, sizeof(uint8_t));
+}
+
+bool is_covered(uint8_t *coverage, uint64_t address) {
+    return (coverage[address / INSTR_BYTES / CHAR_BIT] >> (address / INSTR_BYTES % CHAR_BIT)) & 1;
+}
+
+int write_coverage(uint8_t *coverage, FILE *fp) {
+    return fwrite(coverage, sizeof(uint8_t), COVERAGE_BYTES, fp) == COVERAGE_BYTES ? 0 : -1;
+}
+
+int write_lcov(uint8_t *coverage, SymbolMap *symbols, FILE *fp) {
+    int max_line;
+    LineCoverage *lines = get_line_coverage(coverage, symbols, &max_line);
+    if (lines == NULL) {
+        return -1;
+    }
+
+    // Writes a single record, for the source file of the binary
+    int found = 0;
+    int hit = 0;
+    fprintf(fp, "TN:\nSF:%s\n", symbols->source == NULL ? "" : symbols->source);
+    for (int line = 1; line <= max_line; line++) {
+        if (lines[line] != LINE_NO_INSTRUCTIONS) {
+            fprintf(fp, "DA:%d,%d\n", line, lines[line] == LINE_EXECUTED);
+            found++;
+            hit += lines[line] == LINE_EXECUTED;
+        }
+    }
+    fprintf(fp, "LF:%d\nLH:%d\nend_of_record\n", found, hit);
+    free(lines);
+    return 0;
+}
+
+void write_coverage_summary(uint8_t *coverage, SymbolMap *symbols, FILE *fp) {
+    uint64_t words = 0;
+    for (uint64_t byte = 0; byte < COVERAGE_BYTES; byte++) {
+        for (uint8_t bits = coverage[byte]; bits != 0; bits &= bits - 1) {
+            words++;
+        }
+    }
+    fprintf(fp, "Coverage: %lu instructions executed", words);
+
+    int max_line;
+    LineCoverage *lines = symbols == NULL ? NULL : get_line_coverage(coverage, symbols, &max_line);
+    if (lines != NULL) {
+        int found = 0;
+        int hit = 0;
+        for (int line = 1; line <= max_line; line++) {
+            found += lines[line] != LINE_NO_INSTRUCTIONS;
+            hit += lines[line] == LINE_EXECUTED;
+        }
+        fprintf(fp, ", %d of %d source lines (%.2f%%)", hit, found, 100.0 * hit / found);
+        free(lines);
+    }
+    fprintf(fp, "%s", "\n");
+}
+
+static LineCoverage *get_line_coverage(uint8_t *coverage, SymbolMap *symbols, int *max_line) {
+    if (symbols->num_lines == 0) {
+        return NULL;
+    }
+    *max_line = 0;
+    for (int i = 0; i < symbols->num_lines; i++) {
+        if (symbols->lines[i].line > *max_line) {
+            *max_line = symbols->lines[i].line;
+        }
+    }
+
+    // A line may hold several instructions (one too long for the line buffer
+    // of the assembler is assembled in pieces), and is executed if any of them
+    // was
+    LineCoverage *lines = calloc(*max_line + 1, sizeof(LineCoverage));
+    if (lines == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < symbols->num_lines; i++) {
+        SourceLine *line = &symbols->lines[i];
+        bool executed = line->address < MEMORY_SIZE && is_covered(coverage, line->address);
+        if (executed) {
+            lines[line->line] = LINE_EXECUTED;
+        } else if (lines[line->line] == LINE_NO_INSTRUCTIONS) {
+            lines[line->line] = LINE_NOT_EXECUTED;
+        }
+    }
+    return lines;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "../common/utilities.h"
+#include "symbols.h"
+
+// Number of bytes of a coverage bitmap: one bit per instruction word of guest
+// memory, bit (i % 8) of byte (i / 8) for the word at address 4 * i
+#define COVERAGE_BYTES (MEMORY_SIZE / INSTR_BYTES / CHAR_BIT)
+
+// Marks the instruction word at an address as executed in a coverage bitmap
+#define MARK_COVERED(coverage, address) \
+    ((coverage)[(address) / INSTR_BYTES / CHAR_BIT] |= 1 << ((address) / INSTR_BYTES % CHAR_BIT))
+
+/**
+ * Allocates a coverage bitmap in which no instruction word is executed
+ * Returns a pointer to it, or NULL if allocation fails
+ */
+extern uint8_t *allocate_coverage(void);
+
+/**
+ * Returns true if the instruction word at an address is marked as executed
+ */
+extern bool is_covered(uint8_t *, uint64_t);
+
+/**
+ * Writes a coverage bitmap to a file stream as raw bytes
+ * Returns 0 if success and -1 if the bitmap cannot be written
+ */
+extern int write_coverage(uint8_t *, FILE *);
+
+/**
+ * Writes the coverage of the source lines of a symbol map to a file stream as
+ * an lcov tracefile: a DA record per source line with an instruction, whose
+ * count is 1 if any of its instructions was executed
+ * Returns 0 if success and -1 if the map has no source lines
+ */
+extern int write_lcov(uint8_t *, SymbolMap *, FILE *);
+
+/**
+ * Writes a summary of a coverage bitmap to a file stream: the number of
+ * instruction words executed, and the number of source lines executed out of
+ * those of the symbol map (if it is not NULL and has source lines)
+ */
+extern void write_coverage_summary(uint8_t *, SymbolMap *, FILE *);
+
+#endif
\ No newline at end of file
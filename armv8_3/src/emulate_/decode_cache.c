@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "decode_cache.h"
+#include "micro_op.h"
+#include "../common/utilities.h"
+
+// Identifies a cache file
+#define CACHE_MAGIC "UOPCACHE"
+#define CACHE_MAGIC_LENGTH 8
+// Size of the header of a cache file, which is followed by the cache itself
+// (a multiple of every host page size, so that the cache can be mapped)
+#define CACHE_HEADER_SIZE 65536
+// Maximum length of the path of a cache file
+#define MAX_PATH_LENGTH 4096
+// Path of the running emulator executable
+#define EXECUTABLE_PATH "/proc/self/exe"
+// Offset basis and prime of the 64-bit FNV-1a hash
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325
+#define FNV_PRIME 0x100000001b3
+
+/**
+ * Represents the header of a cache file:
+ * magic:      CACHE_MAGIC
+ * build:      Hash of the identity (inode, size, modification time) of the
+ *             emulator executable - micro-ops are only valid for the build
+ *             which lowered them, as handler ids change with each build
+ * image:      Hash of the binary image
+ * image_size: Size of the binary image in bytes
+ * checksum:   Checksum of the decoded entries of the cache (see
+ *             get_checksum), against which a damaged file is detected
+ */
+typedef struct {
+    char magic[CACHE_MAGIC_LENGTH];
+    uint64_t build;
+    uint64_t image;
+    uint64_t image_size;
+    uint64_t checksum;
+} CacheHeader;
+
+/**
+ * Returns the 64-bit FNV-1a hash of a given number of bytes
+ */
+static uint64_t hash_bytes(const uint8_t *, uint64_t);
+
+/**
+ * Returns the checksum of the decoded entries of a decode cache: the 64-bit
+ * FNV-1a hash, a word at a time, of the index, word and micro-op of each entry
+ * which is not UOP_DECODE (the others are holes in a cache file)
+ */
+static uint64_t get_checksum(const DecodeCache *);
+
+/**
+ * Sets the header of the cache file of a binary image
+ * Returns 0 if success and -1 if the emulator executable cannot be identified
+ */
+static int make_header(CacheHeader *, uint8_t *, int);
+
+/**
+ * Writes the path of the cache file of a binary image (named by its hash) in
+ * a directory to a buffer of MAX_PATH_LENGTH bytes
+ * Returns 0 if success and -1 if the path is too long
+ */
+static int get_cache_path(char *, char *, CacheHeader *);
+
+/**
+ * Writes a given number of bytes at an offset in a file
+ * Returns 0 if success and -1 otherwise
+ */
+static int write_at(int, const void *, uint64_t, uint64_t);
+
+DecodeCache *allocate_cache(void) {
+    // Anonymous pages are initialised to 0 (UOP_DECODE), and only backed once used
+    DecodeCache *cache = mmap(NULL, sizeof(DecodeCache), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return cache == MAP_FAILED ? NULL : cache;
+}
+
+void clear_cache(DecodeCache *cache) {
+    // Discarded anonymous pages are initialised to 0 again when next used
+    madvise(cache, sizeof(DecodeCache), MADV_DONTNEED);
+}
+
+void free_cache(DecodeCache *cache) {
+    munmap(cache, sizeof(DecodeCache));
+}
+
+int load_cache(DecodeCache *cache, char *dir, uint8_t *image, int image_size) {
+    CacheHeader expected;
+    char path[MAX_PATH_LENGTH];
+    if (make_header(&expected, image, image_size) != 0 || get_cache_path(path, dir, &expected) != 0) {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    // The header must match (the same image, decoded by this build), and the
+    // file must hold the whole cache, as an access to a mapped page past its
+    // end would raise SIGBUS
+    CacheHeader header;
+    struct stat file;
+    bool valid = fstat(fd, &file) == 0 && file.st_size >= CACHE_HEADER_SIZE + sizeof(DecodeCache)
+        && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+        && memcmp(&header, &expected, offsetof(CacheHeader, checksum)) == 0;
+
+    // The contents must match the checksum before they replace the cache, so
+    // that no micro-op of a damaged file is ever executed
+    if (valid) {
+        DecodeCache *contents = mmap(NULL, sizeof(DecodeCache), PROT_READ, MAP_PRIVATE, fd,
+            CACHE_HEADER_SIZE);
+        valid = contents != MAP_FAILED && get_checksum(contents) == header.checksum;
+        if (contents != MAP_FAILED) {
+            munmap(contents, sizeof(DecodeCache));
+        }
+    }
+    void *mapped = MAP_FAILED;
+    if (valid) {
+        mapped = mmap(cache, sizeof(DecodeCache), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_FIXED, fd, CACHE_HEADER_SIZE);
+    }
+    close(fd);
+    return mapped == MAP_FAILED ? -1 : 0;
+}
+
+int save_cache(DecodeCache *cache, char *dir, uint8_t *image, int image_size) {
+    // Nothing is saved unless every decoded entry was lowered from the word in
+    // the image (so that a later run which loads the image finds them valid)
+    for (int i = 0; i < NUM_CACHE_ENTRIES; i++) {
+        if (cache->ops[i].handler != UOP_DECODE) {
+            uint32_t word = 0;
+            if ((i + 1) * INSTR_BYTES <= image_size) {
+                memcpy(&word, image + i * INSTR_BYTES, INSTR_BYTES);
+            }
+            if (cache->raw[i] != word) {
+                return 0;
+            }
+        }
+    }
+
+    CacheHeader header;
+    char path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH];
+    if (make_header(&header, image, image_size) != 0 || get_cache_path(path, dir, &header) != 0
+            || snprintf(temp_path, MAX_PATH_LENGTH, "%s.XXXXXX", path) >= MAX_PATH_LENGTH) {
+        return -1;
+    }
+    header.checksum = get_checksum(cache);
+
+    // Writes a temporary file, which is renamed into place once complete so
+    // that a concurrent run never maps a partial cache file
+    int fd = mkstemp(temp_path);
+    if (fd == -1) {
+        return -1;
+    }
+    bool failed = ftruncate(fd, CACHE_HEADER_SIZE + sizeof(DecodeCache)) != 0
+        || write_at(fd, &header, sizeof(header), 0) != 0;
+
+    // Writes each run of decoded entries (the rest of the file is a hole,
+    // which reads as 0, ie: UOP_DECODE)
+    uint64_t raw_offset = CACHE_HEADER_SIZE + offsetof(DecodeCache, raw);
+    uint64_t ops_offset = CACHE_HEADER_SIZE + offsetof(DecodeCache, ops);
+    for (int start = 0; !failed && start < NUM_CACHE_ENTRIES;) {
+        if (cache->ops[start].handler == UOP_DECODE) {
+            start++;
+            continue;
+        }
+        int end = start;
+        while (end < NUM_CACHE_ENTRIES && cache->ops[end].handler != UOP_DECODE) {
+            end++;
+        }
+        failed = write_at(fd, &cache->raw[start], (end - start) * sizeof(uint32_t),
+                raw_offset + start * sizeof(uint32_t)) != 0
+            || write_at(fd, &cache->ops[start], (end - start) * sizeof(MicroOp),
+                ops_offset + start * sizeof(MicroOp)) != 0;
+        start = end;
+    }
+
+    failed = close(fd) != 0 || failed || rename(temp_path, path) != 0;
+    if (failed) {
+        unlink(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t hash_bytes(const uint8_t *bytes, uint64_t length) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (uint64_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t get_checksum(const DecodeCache *cache) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (uint64_t i = 0; i < NUM_CACHE_ENTRIES; i++) {
+        if (cache->ops[i].handler == UOP_DECODE) {
+            continue;
+        }
+        uint64_t op;
+        memcpy(&op, &cache->ops[i], sizeof(op));
+        hash = (hash ^ i) * FNV_PRIME;
+        hash = (hash ^ cache->raw[i]) * FNV_PRIME;
+        hash = (hash ^ op) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static int make_header(CacheHeader *header, uint8_t *image, int image_size) {
+    struct stat executable;
+    if (stat(EXECUTABLE_PATH, &executable) != 0) {
+        return -1;
+    }
+    uint64_t identity[] = {executable.st_ino, executable.st_size, executable.st_mtime};
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CACHE_MAGIC, CACHE_MAGIC_LENGTH);
+    header->build = hash_bytes((const uint8_t *) identity, sizeof(identity));
+    header->image = hash_bytes(image, image_size);
+    header->image_size = image_size;
+    return 0;
+}
+
+static int get_cache_path(char *path, char *dir, CacheHeader *header) {
+    int length = snprintf(path, MAX_PATH_LENGTH, "%s/%016lx.uops", dir, header->image);
+    return length < MAX_PATH_LENGTH ? 0 : -1;
+}
+
+static int write_at(int fd, const void *bytes, uint64_t length, uint64_t offset) {
+    return pwrite(fd, bytes, length, offset) == (ssize_t) length ? 0 : -1;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <stdint.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+// Number of cache entries (one for every instruction word in memory)
+#define NUM_CACHE_ENTRIES (MEMORY_SIZE / INSTR_BYTES)
+// Maximum number of instructions decoded when a new block is formed
+#define MAX_BLOCK_LENGTH 64
+// Maximum number of instructions spanned by an idiom or a fused pair
+#define MAX_PATTERN_LENGTH 4
+
+/**
+ * Represents the cache of decoded instruction words, one entry per word:
+ * raw: The 32-bit words the micro-ops were lowered from - compared against
+ *      memory on every fetch so that self-modifying code is re-decoded
+ * ops: The micro-ops, UOP_DECODE until filled in by block formation
+ * The words and micro-ops are kept in separate arrays so that the micro-ops
+ * of hot code are packed densely
+ */
+typedef struct DecodeCache {
+    uint32_t raw[NUM_CACHE_ENTRIES];
+    MicroOp ops[NUM_CACHE_ENTRIES];
+} DecodeCache;
+
+/**
+ * Allocates an empty decode cache (every micro-op is UOP_DECODE), as its own
+ * mapping so that a cache file can later be mapped over it
+ * Returns a pointer to the cache, or NULL if allocation fails
+ */
+extern DecodeCache *allocate_cache(void);
+
+/**
+ * Empties a decode cache (every micro-op is UOP_DECODE again), releasing its
+ * pages
+ */
+extern void clear_cache(DecodeCache *);
+
+/**
+ * Frees a decode cache
+ */
+extern void free_cache(DecodeCache *);
+
+/**
+ * Maps the cache file of a binary image (of a given size in bytes) from a
+ * directory over a decode cache, replacing its contents with the blocks
+ * decoded by an earlier run of the same image by the same build - the
+ * mapping is private, so the file is never written by this run
+ * A file is only valid if it holds a whole cache whose decoded entries match
+ * the checksum in its header, so a damaged file is a miss (the checksum
+ * detects damage, not deliberate changes - the directory must be trusted)
+ * Returns 0 if success and -1 if there is no valid cache file
+ */
+extern int load_cache(DecodeCache *, char *, uint8_t *, int);
+
+/**
+ * Saves the blocks decoded during a run of a binary image to its cache file
+ * in a directory, unless the run modified any instruction which it decoded
+ * (only the decoded entries are written - the rest of the file is sparse)
+ * Returns 0 if success (or nothing is saved) and -1 otherwise
+ */
+extern int save_cache(DecodeCache *, char *, uint8_t *, int);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <stdint.h>
+
+#include "decoder.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+#include "../common/isa.h"
+
+/**
+ * Declares a type DecodePtr representing a pointer to a decode function
+ */
+typedef void (*DecodePtr)(uint32_t, Instr *);
+
+/**
+ * Defines the decode function of each form, decode_<name>, which sets the type
+ * of the decoded instruction and every member of its format given by the form
+ */
+#define DECODE_KEY(member, start, end, value) decoded->format.member = (value);
+#define DECODE_FIELD(member, start, end) decoded->format.member = extract_bits(instr, start, end);
+#define DECODE_TAG(member, value) decoded->format.member = (value);
+#define DECODE_FORM(NAME, name, TYPE, arg) \
+static void decode_##name(uint32_t instr, Instr *decoded) { \
+    *decoded = (Instr) { .type = TYPE }; \
+    ISA_##NAME(ISA_IGNORE_FIXED, DECODE_KEY, DECODE_FIELD, DECODE_TAG) \
+}
+ISA_FORMS(DECODE_FORM, )
+
+/**
+ * Declares an entry of the decode table: the mask and pattern of the fixed bits
+ * of a form, and a pointer to its decode function
+ */
+typedef struct {
+    uint32_t mask;
+    uint32_t pattern;
+    DecodePtr func_ptr;
+} DecodeEntry;
+
+/**
+ * Defines a table that maps each form to its fixed bits and decode function
+ */
+#define DECODE_ENTRY(NAME, name, TYPE, arg) {ISA_MASK(NAME), ISA_PATTERN(NAME), &decode_##name},
+static DecodeEntry decodeTable[] = {
+    ISA_FORMS(DECODE_ENTRY, )
+};
+
+/**
+ * Defines the key mask and key pattern of each form, ie: its fixed bits which
+ * lie in the key of an instruction (see ISA_KEY)
+ */
+#define KEY_CONSTANTS(NAME, name, TYPE, arg) \
+    NAME##_KEY_MASK = ISA_KEY(ISA_MASK(NAME)), \
+    NAME##_KEY_PATTERN = ISA_KEY(ISA_PATTERN(NAME)),
+enum {
+    ISA_FORMS(KEY_CONSTANTS, )
+};
+
+/**
+ * Expand X once per key in [i, i + N)
+ */
+#define REPEAT_4(X, i) X(i) X((i) + 1) X((i) + 2) X((i) + 3)
+#define REPEAT_16(X, i) REPEAT_4(X, i) REPEAT_4(X, (i) + 4) REPEAT_4(X, (i) + 8) REPEAT_4(X, (i) + 12)
+#define REPEAT_64(X, i) REPEAT_16(X, i) REPEAT_16(X, (i) + 16) REPEAT_16(X, (i) + 32) REPEAT_16(X, (i) + 48)
+#define REPEAT_256(X, i) REPEAT_64(X, i) REPEAT_64(X, (i) + 64) REPEAT_64(X, (i) + 128) REPEAT_64(X, (i) + 192)
+#define REPEAT_1024(X, i) REPEAT_256(X, i) REPEAT_256(X, (i) + 256) REPEAT_256(X, (i) + 512) REPEAT_256(X, (i) + 768)
+
+/**
+ * Defines the decision tree (top byte, then bits 10-11) flattened into a table
+ * indexed by key, which maps each key to the first form whose fixed bits match
+ * it, or to ISA_UNDEFINED - computed entirely by the compiler
+ */
+#define MATCH_FORM(NAME, name, TYPE, key) \
+    ((key) & NAME##_KEY_MASK) == NAME##_KEY_PATTERN ? ISA_##NAME :
+#define TREE_ENTRY(key) ISA_FORMS(MATCH_FORM, key) ISA_UNDEFINED,
+static const uint8_t decodeTree[ISA_NUM_KEYS] = {
+    REPEAT_1024(TREE_ENTRY, 0)
+};
+
+_Static_assert(ISA_UNDEFINED <= UINT8_MAX, "form ids must fit in 8 bits");
+_Static_assert(ISA_NUM_KEYS == 1 << (32 - ISA_TOP_START + ISA_SELECT_BITS), "every key must be in the tree");
+
+int decode(uint32_t instr, Instr *decoded) {
+    // Looks up the form of the instruction in the decision tree
+    IsaForm form = decodeTree[ISA_KEY(instr)];
+    if (form == ISA_UNDEFINED) {
+        return -1;
+    }
+    // Checks the fixed bits outside the key, then passes the instruction to
+    // the decode function of its form
+    DecodeEntry *entry = &decodeTable[form];
+    if ((instr & entry->mask) != entry->pattern) {
+        return -1;
+    }
+    entry->func_ptr(instr, decoded);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+
+#include "../common/instructions.h"
+
+/**
+ * Decodes a 32-bit instruction into an internal representation, using the
+ * decoder generated from the instruction set description (see isa.h)
+ * Returns -1 if the instruction is not of any supported form (eg: it is data),
+ * otherwise returns 0
+ */
+extern int decode(uint32_t, Instr *);
+
+#endif
\ No newline at end of file
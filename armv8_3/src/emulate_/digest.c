@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "digest.h"
+#include "../common/utilities.h"
+
+// Multipliers of the 2 halves of a digest (odd, with well-mixed bits)
+#define MULTIPLIER_HIGH 0x9e3779b97f4a7c15
+#define MULTIPLIER_LOW 0xc2b2ae3d27d4eb4f
+// Number of hexadecimal digits in each half of a digest
+#define HALF_DIGITS (DIGEST_DIGITS / 2)
+
+/**
+ * Mixes a 64-bit word into a digest
+ */
+static void mix_word(Digest *, uint64_t);
+
+/**
+ * Finalises a digest, so that every bit depends on every word mixed into it
+ */
+static Digest finalise(Digest);
+
+/**
+ * Returns the digest of a chunk of guest memory (depending on its index, so
+ * that the sum of the digests depends on where each chunk is)
+ */
+static Digest hash_chunk(MemoryDigest *, int);
+
+/**
+ * Hashes a chunk of guest memory again, replacing its digest in the sum
+ */
+static void update_chunk(MemoryDigest *, int);
+
+/**
+ * Hashes again every chunk of each page which is dirty (or every chunk, if not
+ * tracking dirty pages), updating the sum, and write-protects the pages again
+ */
+static void update_pages(MemoryDigest *);
+
+int start_digest(MemoryDigest *digest, uint8_t *memory, bool tracking) {
+    digest->memory = memory;
+    // The host page size only matters for tracking dirty pages, each of
+    // which must hold whole chunks
+    digest->page_size = sysconf(_SC_PAGESIZE);
+    if (tracking && (digest->page_size <= 0 || digest->page_size % DIGEST_CHUNK_SIZE != 0
+            || MEMORY_SIZE % digest->page_size != 0)) {
+        return -1;
+    }
+
+    digest->sum = (Digest) { 0 };
+    for (int chunk = 0; chunk < NUM_DIGEST_CHUNKS; chunk++) {
+        digest->chunks[chunk] = hash_chunk(digest, chunk);
+        digest->sum.high += digest->chunks[chunk].high;
+        digest->sum.low += digest->chunks[chunk].low;
+        digest->dirty[chunk] = false;
+    }
+
+    digest->tracking = tracking;
+    if (tracking && mprotect(memory, MEMORY_SIZE, PROT_READ) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+bool handle_digest_fault(MemoryDigest *digest, void *host) {
+    uint8_t *byte = host;
+    if (!digest->tracking || byte < digest->memory || byte >= digest->memory + MEMORY_SIZE) {
+        return false;
+    }
+    int page = (byte - digest->memory) / digest->page_size;
+    digest->dirty[page] = true;
+    mprotect(digest->memory + page * digest->page_size, digest->page_size, PROT_READ | PROT_WRITE);
+    return true;
+}
+
+Digest get_state_digest(MemoryDigest *digest, CPUState *cpu) {
+    update_pages(digest);
+
+    Digest state = digest->sum;
+    for (int i = 0; i < NUM_GENERAL_REGISTERS; i++) {
+        mix_word(&state, cpu->registers[i]);
+    }
+    mix_word(&state, cpu->pc);
+    PState pstate = cpu->pstate;
+    mix_word(&state, pstate.n_flag << 3 | pstate.z_flag << 2 | pstate.c_flag << 1 | pstate.v_flag);
+    return finalise(state);
+}
+
+void stop_digest(MemoryDigest *digest) {
+    if (digest->tracking) {
+        mprotect(digest->memory, MEMORY_SIZE, PROT_READ | PROT_WRITE);
+        digest->tracking = false;
+    }
+}
+
+int parse_digest(char *string, Digest *digest) {
+    if (strlen(string) != DIGEST_DIGITS) {
+        return -1;
+    }
+    uint64_t halves[2] = {0, 0};
+    for (int i = 0; i < DIGEST_DIGITS; i++) {
+        char digit = tolower((unsigned char) string[i]);
+        if (!isxdigit((unsigned char) digit)) {
+            return -1;
+        }
+        uint64_t value = isdigit((unsigned char) digit) ? digit - '0' : digit - 'a' + 10;
+        halves[i / HALF_DIGITS] = halves[i / HALF_DIGITS] << 4 | value;
+    }
+    digest->high = halves[0];
+    digest->low = halves[1];
+    return 0;
+}
+
+void write_digest(Digest digest, FILE *fp) {
+    fprintf(fp, "%016lx%016lx", digest.high, digest.low);
+}
+
+static void mix_word(Digest *digest, uint64_t word) {
+    digest->high = (digest->high ^ word) * MULTIPLIER_HIGH;
+    digest->high ^= digest->high >> 32;
+    digest->low = (digest->low + word) * MULTIPLIER_LOW;
+    digest->low ^= digest->low >> 29;
+}
+
+static Digest finalise(Digest digest) {
+    // Each half is mixed with the other, then avalanched
+    uint64_t high = digest.high ^ (digest.low * MULTIPLIER_HIGH);
+    uint64_t low = digest.low ^ (digest.high * MULTIPLIER_LOW);
+    high ^= high >> 33;
+    high *= MULTIPLIER_LOW;
+    high ^= high >> 29;
+    low ^= low >> 31;
+    low *= MULTIPLIER_HIGH;
+    low ^= low >> 32;
+    return (Digest) { .high = high, .low = low };
+}
+
+static Digest hash_chunk(MemoryDigest *digest, int chunk) {
+    Digest hash = { .high = chunk, .low = ~(uint64_t) chunk };
+    uint8_t *start = digest->memory + chunk * DIGEST_CHUNK_SIZE;
+    for (int i = 0; i < DIGEST_CHUNK_SIZE; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, start + i, sizeof(word));
+        mix_word(&hash, word);
+    }
+    return finalise(hash);
+}
+
+static void update_chunk(MemoryDigest *digest, int chunk) {
+    Digest hash = hash_chunk(digest, chunk);
+    digest->sum.high += hash.high - digest->chunks[chunk].high;
+    digest->sum.low += hash.low - digest->chunks[chunk].low;
+    digest->chunks[chunk] = hash;
+}
+
+static void update_pages(MemoryDigest *digest) {
+    if (!digest->tracking) {
+        for (int chunk = 0; chunk < NUM_DIGEST_CHUNKS; chunk++) {
+            update_chunk(digest, chunk);
+        }
+        return;
+    }
+
+    int num_pages = MEMORY_SIZE / digest->page_size;
+    int chunks_per_page = digest->page_size / DIGEST_CHUNK_SIZE;
+    for (int page = 0; page < num_pages; page++) {
+        if (!digest->dirty[page]) {
+            continue;
+        }
+        for (int chunk = page * chunks_per_page; chunk < (page + 1) * chunks_per_page; chunk++) {
+            update_chunk(digest, chunk);
+        }
+        digest->dirty[page] = false;
+        mprotect(digest->memory + page * digest->page_size, digest->page_size, PROT_READ);
+    }
+}
\ No newline at end of file
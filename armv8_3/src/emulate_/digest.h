@@ -0,0 +1,86 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+
+// Size in bytes of the chunks of guest memory which are hashed separately,
+// independent of the host page size so that digests agree across hosts
+#define DIGEST_CHUNK_SIZE 4096
+// Number of chunks of guest memory, and the maximum number of guest memory
+// pages (of host pages of at least the chunk size)
+#define NUM_DIGEST_CHUNKS (MEMORY_SIZE / DIGEST_CHUNK_SIZE)
+// Number of hexadecimal digits in a digest
+#define DIGEST_DIGITS 32
+
+/**
+ * Represents a 128-bit digest, as 2 64-bit halves
+ */
+typedef struct {
+    uint64_t high;
+    uint64_t low;
+} Digest;
+
+/**
+ * Represents the running digest of guest memory: the sum of the digests of
+ * its chunks, so that a chunk which changes is updated by replacing its digest
+ * in the sum, without hashing the rest of memory again:
+ * memory:    Guest memory
+ * page_size: Host page size in bytes (a multiple of the chunk size)
+ * chunks:    Digest of each chunk, as of the last update
+ * sum:       Sum (modulo 2^64 in each half) of the digests of the chunks
+ * tracking:  If set, memory is write-protected after each update, so that the
+ *            first write to each host page faults and marks it dirty -
+ *            otherwise every chunk is hashed on update
+ * dirty:     Set for each host page written since the last update
+ */
+typedef struct MemoryDigest {
+    uint8_t *memory;
+    long page_size;
+    Digest chunks[NUM_DIGEST_CHUNKS];
+    Digest sum;
+    bool tracking;
+    volatile bool dirty[NUM_DIGEST_CHUNKS];
+} MemoryDigest;
+
+/**
+ * Hashes every chunk of guest memory and, if tracking dirty pages,
+ * write-protects guest memory
+ * Returns 0 if success and -1 otherwise
+ */
+extern int start_digest(MemoryDigest *, uint8_t *, bool);
+
+/**
+ * Handles SIGSEGV on a host address: if it lies in write-protected guest
+ * memory, marks its page dirty, unprotects it and returns true (the write is
+ * then retried), otherwise returns false
+ */
+extern bool handle_digest_fault(MemoryDigest *, void *);
+
+/**
+ * Returns the digest of the whole state of the CPU: guest memory (hashing the
+ * chunks of the dirty pages again), the general-purpose registers, PC and PSTATE flags - ie:
+ * everything written by write_output
+ */
+extern Digest get_state_digest(MemoryDigest *, CPUState *);
+
+/**
+ * Stops tracking dirty pages, leaving guest memory writable
+ */
+extern void stop_digest(MemoryDigest *);
+
+/**
+ * Parses a digest of 32 hexadecimal digits
+ * Returns 0 if success and -1 if the digest is invalid
+ */
+extern int parse_digest(char *, Digest *);
+
+/**
+ * Writes a digest as 32 hexadecimal digits to a file stream
+ */
+extern void write_digest(Digest, FILE *);
+
+#endif
\ No newline at end of file
@@ -5,16 +5,48 @@
 
 #include "../common/utilities.h"
 #include "../common/instructions.h"
+#include "registers.h"
+#include "micro_op.h"
 
 /**
- * Executes a decoded data processing arithmetic (imm/reg) instruction using a
- * pointer to its internal representation and updates the CPU state accordingly
+ * Set condition flags in PSTATE register after a 32-bit or 64-bit addition or
+ * subtraction of op1 and op2:
+ * N - sign bit of result
+ * Z = 1 if result was zero
+ * C = 1 if addition produced a carry or subtraction produced a borrow
+ * V = 1 if there is signed overflow/underflow
+ */
+extern void set_flags_add_32(uint32_t, uint32_t, uint32_t, CPUState *);
+extern void set_flags_add_64(uint64_t, uint64_t, uint64_t, CPUState *);
+extern void set_flags_sub_32(uint32_t, uint32_t, uint32_t, CPUState *);
+extern void set_flags_sub_64(uint64_t, uint64_t, uint64_t, CPUState *);
+
+/**
+ * Flag setters named in ARITHMETIC_OPS - adds/subs set the flags, add/sub don't
+ */
+#define NO_FLAGS(W, op1, op2, result, cpu)
+#define SET_FLAGS_ADD(W, op1, op2, result, cpu) set_flags_add_##W(op1, op2, result, cpu);
+#define SET_FLAGS_SUB(W, op1, op2, result, cpu) set_flags_sub_##W(op1, op2, result, cpu);
+
+/**
+ * Defines a handler for a data processing arithmetic (imm/reg) micro-op,
+ * specialised on its operation and bit width W, whose 2nd operand is given by
+ * an expression of the micro-op op and the CPU state cpu:
  * opc Instruction
  * 00  add
  * 01  adds
  * 10  sub
  * 11  subs
  */
-extern void execute_dp_arithmetic(DPArithmeticFormat *, CPUState *);
+#define ARITHMETIC_HANDLER(handler, operator, flags, W, operand) \
+int handler(MicroOp *op, CPUState *cpu) { \
+    UINT_TYPE(W) op1 = READ_REGISTER(W, cpu->registers, op->rn); \
+    UINT_TYPE(W) op2 = operand; \
+    UINT_TYPE(W) result = op1 operator op2; \
+    flags(W, op1, op2, result, cpu) \
+    WRITE_REGISTER(W, cpu->registers, op->rd, result); \
+    increment_pc(cpu); \
+    return 1; \
+}
 
 #endif
\ No newline at end of file
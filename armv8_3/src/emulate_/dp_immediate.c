@@ -3,100 +3,90 @@
 
 #include "dp_immediate.h"
 #include "dp_arithmetic.h"
+#include "micro_op.h"
 #include "../common/utilities.h"
 #include "../common/instructions.h"
 #include "registers.h"
 
-/**
- * Executes a decoded wide move instruction, using the opc to determine its type
- */ 
-static void execute_dp_imm_wide_move(Instr *, CPUState *);
-
-void decode_dp_imm(uint32_t instr, Instr *decoded) {
-    // Sets fields common to every type of dp immediate instruction
-    DPImmFormat format = {
-        .sf  = extract_bits(instr, DP_SF_START, DP_SF_END),
-        .opc = extract_bits(instr, DP_OPC_START, DP_OPC_END),
-        .opi = extract_bits(instr, OPI_START, OPI_END),
-        .rd  = extract_bits(instr, DP_RD_START, DP_RD_END),
-    };
-    
-    // Determines the instruction subtype (arithmetic, wide move) using the opi
-    if (format.opi == ARITHMETIC_OPI) {
-        // Sets fields for arithmetic instruction
-        format.imm_type = IMM_ARITHMETIC;
-        format.operand.Arithmetic.sh = extract_bits(instr, SH_START, SH_END);
-        format.operand.Arithmetic.imm12 = extract_bits(instr, IMM12_START, IMM12_END);
-        format.operand.Arithmetic.rn = extract_bits(instr, RN_START, RN_END);
-    } else {
-        // Sets fields for wide move instruction
-        format.imm_type = IMM_WIDE_MOVE;
-        format.operand.WideMove.hw = extract_bits(instr, HW_START, HW_END);
-        format.operand.WideMove.imm16 = extract_bits(instr, IMM16_START, IMM16_END);
-    }
-
-    // Sets the type and format of the decoded instruction
-    decoded->type = DATA_PROCESSING_IMM;
-    decoded->format.dp_imm_format = format;
-}
-
-void execute_dp_imm(Instr *instr, CPUState *cpu) {
+void lower_dp_imm(Instr *instr, uint64_t address, MicroOp *op) {
     DPImmFormat format = instr->format.dp_imm_format;
-    
+    op->sf = format.sf;
+    op->rd = format.rd;
+
     switch (format.imm_type) {
-        case IMM_ARITHMETIC: ;
-            uint64_t op2 = (uint64_t) format.operand.Arithmetic.imm12;
+        case IMM_ARITHMETIC:
+            // Arithmetic handlers are in opc order (add, adds, sub, subs), each
+            // with a 32-bit and a 64-bit variant
+            op->handler = UOP_ADD_IMM_32 + format.opc * NUM_WIDTHS + format.sf;
+            op->rn = format.operand.Arithmetic.rn;
+            // Pre-shifts imm12 left by 12 bits if sh is set
+            op->imm = format.operand.Arithmetic.imm12;
             if (format.operand.Arithmetic.sh == LEFT_SHIFT_SH) {
-                op2 = logical_shift_left(op2, IMM12_LENGTH, format.sf);
+                op->imm = logical_shift_left(op->imm, IMM12_LENGTH, format.sf);
             }
-            DPArithmeticFormat arithmetic_format = {
-                format.sf,
-                format.opc,
-                format.rd,
-                format.operand.Arithmetic.rn,
-                op2,
-            };
-            execute_dp_arithmetic(&arithmetic_format, cpu);
             break;
         case IMM_WIDE_MOVE:
-            execute_dp_imm_wide_move(instr, cpu);
+            switch (format.opc) {
+                case MOVN_OPC:
+                    op->handler = UOP_MOVN_32 + format.sf;
+                    break;
+                case MOVZ_OPC:
+                    op->handler = UOP_MOVZ_32 + format.sf;
+                    break;
+                case MOVK_OPC:
+                    op->handler = UOP_MOVK_32 + format.sf;
+                    break;
+                default:
+                    // Assumes valid instruction - should not reach this case
+                    assert(0);
+            }
+            // Computes the shift (shift = hw * 16) once, at lowering
+            op->imm = format.operand.WideMove.imm16;
+            op->aux = format.operand.WideMove.hw * IMM16_LENGTH;
             break;
         default:
             // Assumes valid instruction - should not reach this case
             assert(0);
-    };
-    increment_pc(cpu);
+    }
 }
 
-static void execute_dp_imm_wide_move(Instr *instr, CPUState *cpu) {
-    DPImmFormat format = instr->format.dp_imm_format;
-    // Computes shift (shift = hw * 16) and operand value (op = imm16 << shift)
-    uint16_t shift = format.operand.WideMove.hw * IMM16_LENGTH;
-    uint64_t op = (uint64_t) format.operand.WideMove.imm16 << shift;
-    // Determines the move operation using opc and sets register rd accordingly
-    uint64_t value;
-    switch (format.opc) {
-        // Executes move wide with zero (rd := op)
-        case MOVZ_OPC:
-            value = op;
-            break;
-        // Executes move wide with NOT (rd := ~op)
-        case MOVN_OPC:
-            value = ~op;
-            break;
-        // Executes move wide with keep (rd[shift + 15 : shift] := imm16)
-        case MOVK_OPC: ;
-            // Reads 32-bit or 64-bit value (determined by sf) from register rd
-            uint64_t reg = read_register(format.sf, cpu->registers, format.rd);
-            // Creates a mask with 1s in positions 'shift' to 'shift + 15'
-            uint64_t mask = get_bit_mask(shift, shift + IMM16_LENGTH - 1);
-            // reg & ~mask: Clears bits shift to shift + 15 of reg to 0
-            // | op:        Fills bits shift to shift + 15 of reg with imm16
-            value = (reg & ~mask) | op;
-            break;
-        default:
-            assert(0);
-    };
-    // Writes new value to register rd- sf = 0: 32-bit mode, sf = 1: 64-bit mode 
-    write_register(format.sf, cpu->registers, format.rd, value);
-}
\ No newline at end of file
+/**
+ * Defines the arithmetic (immediate) handlers - the 2nd operand is the
+ * pre-shifted immediate
+ */
+#define ARITHMETIC_IMM_HANDLER(W, name, operator, flags) \
+    ARITHMETIC_HANDLER(execute_##name##_imm_##W, operator, flags, W, op->imm)
+#define DEFINE_ARITHMETIC_IMM_HANDLERS(NAME, name, operator, flags) \
+    FOR_EACH_WIDTH(ARITHMETIC_IMM_HANDLER, name, operator, flags)
+
+ARITHMETIC_OPS(DEFINE_ARITHMETIC_IMM_HANDLERS)
+
+/**
+ * Defines the wide move handlers - the opc is known at compile time, so each
+ * handler only contains the code for its own operation:
+ * movz: rd := op
+ * movn: rd := ~op
+ * movk: rd[shift + 15 : shift] := imm16
+ * where op = imm16 << shift
+ */
+#define WIDE_MOVE_HANDLER(W, name, opc) \
+int execute_##name##_##W(MicroOp *op, CPUState *cpu) { \
+    UINT_TYPE(W) operand = (uint64_t) op->imm << op->aux; \
+    UINT_TYPE(W) value; \
+    if (opc == MOVZ_OPC) { \
+        value = operand; \
+    } else if (opc == MOVN_OPC) { \
+        value = ~operand; \
+    } else { \
+        /* Clears bits shift to shift + 15 of rd, then fills them with imm16 */ \
+        UINT_TYPE(W) mask = (((uint64_t) 1 << IMM16_LENGTH) - 1) << op->aux; \
+        value = (READ_REGISTER(W, cpu->registers, op->rd) & ~mask) | operand; \
+    } \
+    WRITE_REGISTER(W, cpu->registers, op->rd, value); \
+    increment_pc(cpu); \
+    return 1; \
+}
+#define DEFINE_WIDE_MOVE_HANDLERS(NAME, name, opc) \
+    FOR_EACH_WIDTH(WIDE_MOVE_HANDLER, name, opc)
+
+WIDE_MOVE_OPS(DEFINE_WIDE_MOVE_HANDLERS)
\ No newline at end of file
@@ -5,17 +5,22 @@
 
 #include "../common/utilities.h"
 #include "../common/instructions.h"
+#include "micro_op.h"
 
 /**
- * Decodes a 32-bit data processing (immediate) instruction into an internal
- * representation
+ * Lowers a decoded data processing (immediate) instruction into a micro-op
+ * with the handler specialised for its operation and bit width
  */
-extern void decode_dp_imm(uint32_t, Instr *);
+extern void lower_dp_imm(Instr *, uint64_t, MicroOp *);
 
 /**
- * Executes a decoded data processing (immediate) instruction using a pointer to
- * its internal representation and updates the CPU state accordingly
+ * Declares the specialised arithmetic (immediate) handlers execute_add_imm_32,
+ * ..., execute_subs_imm_64 and wide move handlers execute_movn_32, ...,
+ * execute_movk_64
  */
-extern void execute_dp_imm(Instr *, CPUState *);
+#define HANDLER(W, NAME, name) extern int execute_##name##_##W(MicroOp *, CPUState *);
+ARITHMETIC_OPS(ARITHMETIC_IMM_HANDLERS)
+WIDE_MOVE_OPS(WIDE_MOVE_HANDLERS)
+#undef HANDLER
 
 #endif
\ No newline at end of file
@@ -5,17 +5,24 @@
 
 #include "../common/utilities.h"
 #include "../common/instructions.h"
+#include "micro_op.h"
 
 /**
- * Decodes a 32-bit data processing (register) instruction into an internal
- * representation
+ * Lowers a decoded data processing (register) instruction into a micro-op
+ * with the handler specialised for its operation, shift type and bit width
  */
-extern void decode_dp_reg(uint32_t, Instr *);
+extern void lower_dp_reg(Instr *, uint64_t, MicroOp *);
 
 /**
- * Executes a decoded data processing (register) instruction using a pointer to
- * its internal representation and updates the CPU state accordingly
+ * Declares the specialised arithmetic (register) handlers execute_add_lsl_32,
+ * ..., execute_subs_asr_64, logical handlers execute_and_lsl_32, ...,
+ * execute_bics_ror_64 and multiply handlers execute_madd_32, ...,
+ * execute_msub_64
  */
-extern void execute_dp_reg(Instr *, CPUState *);
+#define HANDLER(W, NAME, name) extern int execute_##name##_##W(MicroOp *, CPUState *);
+ARITHMETIC_OPS(ARITHMETIC_REG_HANDLERS)
+LOGICAL_OPS(LOGICAL_REG_HANDLERS)
+MULTIPLY_OPS(MULTIPLY_HANDLERS)
+#undef HANDLER
 
 #endif
\ No newline at end of file
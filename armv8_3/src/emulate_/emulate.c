@@ -1,10 +1,33 @@
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "binary_loader.h"
 #include "emulator.h"
+#include "options.h"
+#include "statistics.h"
+#include "watch.h"
+#include "history.h"
+#include "digest.h"
+#include "decode_cache.h"
+#include "batch.h"
+#include "symbols.h"
+#include "cache_model.h"
+#include "timing_model.h"
+#include "loops.h"
+#include "memory_profile.h"
+#include "coverage.h"
+#include "live_counters.h"
+#include "semihost.h"
+#include "memory.h"
 
-// Expected command-line arguments: paths to input .bin file & output .out file
-#define NUM_EXPECTED_ARGUMENTS 3
+/**
+ * Runs a batch of guests forked from a loaded emulator, one per line of the
+ * seeds file given by the options, and writes the final state of each guest
+ * to the output file in turn - the emulator is freed
+ * Returns the exit status of the emulator program
+ */
+static int emulate_batch(CPUState *, Options *);
 
 /**
  * The entry point of the emulator program.
@@ -13,14 +36,15 @@
  * Upon termination, writes the emulator state to a specified .out file.
  */
 int main(int argc, char **argv) {
-    // Exits the program if the argument count is invalid
-    if (argc != NUM_EXPECTED_ARGUMENTS) {
-        fprintf(stderr, "%s", "Usage: ./emulate <input_path> <output_path>\n");
+    // Exits the program if the arguments are invalid
+    Options options;
+    if (parse_options(argc, argv, &options) != 0) {
+        print_usage();
         return EXIT_FAILURE;
     }
 
-    // Opens binary file given by 1st command-line argument in read binary mode
-    FILE *in = open_file(argv[1]);
+    // Opens binary file given by 1st positional argument in read binary mode
+    FILE *in = open_file(options.input_path);
     // Exits the program if null pointer is returned
     if (in == NULL) {
         fprintf(stderr, "%s", "Input file could not be opened.\n");
@@ -35,7 +59,8 @@ int main(int argc, char **argv) {
     }
     
     // Loads the binary file into memory
-    if (load_file(in, (&cpu)->memory) != 0) {
+    int image_size = load_file(in, (&cpu)->memory);
+    if (image_size < 0) {
         fprintf(stderr, "%s", "Binary file could not be loaded into memory.\n");
         return EXIT_FAILURE;
     }
@@ -46,28 +71,368 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    // Runs the main execution pipeline of the emulator
-    run_emulator(&cpu);
+    // Runs a batch of guests instead, if a seeds file is given
+    if (options.batch_path != NULL) {
+        return emulate_batch(&cpu, &options);
+    }
 
-    // Opens output file given by 2nd command-line argument in write text mode
-    FILE *out = fopen(argv[2], "w");
-    // Exits the program if null pointer is returned
-    if (out == NULL) {
-        fprintf(stderr, "%s", "Output file could not be opened.\n");
+    // Gathers execution statistics if requested
+    Statistics stats = {0};
+    if (options.stats) {
+        cpu.stats = &stats;
+    }
+
+    // Protects the pages of watched memory, if any watchpoints are set
+    if (options.watches.num_points > 0) {
+        if (arm_watchpoints(&options.watches, cpu.memory) != 0) {
+            fprintf(stderr, "%s", "Watchpoints could not be set.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.watches = &options.watches;
+        cpu.precise = true;
+    }
+
+    // Loads the symbol map, if given, by which addresses are reported
+    SymbolMap symbols = { .symbols = NULL, .num_symbols = 0 };
+    if (options.symbols != NULL) {
+        FILE *map = fopen(options.symbols, "r");
+        if (map == NULL || load_symbols(map, &symbols) != 0) {
+            fprintf(stderr, "%s", "Symbol map could not be loaded.\n");
+            return EXIT_FAILURE;
+        }
+        fclose(map);
+    }
+
+    // Simulates caches if requested - each access must be made by its own
+    // instruction, so no idioms or fused pairs are formed
+    CacheModel caches;
+    if (options.cache_sim) {
+        if (start_cache_model(&caches, options.caches, options.mem_latency,
+                options.symbols != NULL ? &symbols : NULL) != 0) {
+            fprintf(stderr, "%s", "Caches could not be simulated.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.caches = &caches;
+        cpu.precise = true;
+    }
+
+    // Models the timing of the pipeline if requested, adding the stalls of
+    // the simulated caches (if any) - each instruction is timed on its own
+    TimingModel timing;
+    if (options.timing) {
+        if (start_timing_model(&timing, &options.pipeline, cpu.caches,
+                options.symbols != NULL ? &symbols : NULL) != 0) {
+            fprintf(stderr, "%s", "Pipeline timing could not be modelled.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.timing = &timing;
+        cpu.precise = true;
+    }
+
+    // Profiles loops if requested (idioms and fused pairs still run)
+    LoopProfile loops;
+    if (options.loops) {
+        start_loop_profile(&loops, options.symbols != NULL ? &symbols : NULL);
+        cpu.loops = &loops;
+    }
+
+    // Profiles memory accesses if requested (idioms profile each access they
+    // stand for)
+    if (options.memprofile != NULL) {
+        cpu.accesses = start_memory_profile(options.symbols != NULL ? &symbols : NULL);
+        if (cpu.accesses == NULL) {
+            fprintf(stderr, "%s", "Memory accesses could not be profiled.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Records which instruction words are executed if requested (a single bit
+    // is set per word of each dispatch, so idioms and fused pairs still run)
+    if (options.coverage != NULL || options.lcov != NULL) {
+        if (options.lcov != NULL && symbols.num_lines == 0) {
+            fprintf(stderr, "%s", "Symbol map has no source lines.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.coverage = allocate_coverage();
+        if (cpu.coverage == NULL) {
+            fprintf(stderr, "%s", "Coverage could not be recorded.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Records the execution history if it is to be reversed (memory is then
+    // write-protected, so watchpoints cannot be set as well)
+    History history = { .pages = NULL };
+    if (options.reverse != REVERSE_NONE) {
+        if (cpu.watches != NULL || start_history(&history, &cpu, options.interval) != 0) {
+            fprintf(stderr, "%s", "Execution history could not be recorded.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Skips decoding the blocks decoded by an earlier run of the same binary,
+    // unless each instruction must be run on its own (fused pairs and idioms
+    // are cached as well). The image is kept to key the cache file
+    uint8_t *image = NULL;
+    bool cached = false;
+    if (options.cache_dir != NULL && !cpu.precise) {
+        image = malloc(image_size);
+        if (image != NULL) {
+            memcpy(image, cpu.memory, image_size);
+            cached = load_cache(cpu.cache, options.cache_dir, image, image_size) == 0;
+        }
+    }
+
+    // Keeps a running digest of memory if the final state is to be digested,
+    // tracking dirty pages unless memory is already protected for another use
+    MemoryDigest digest;
+    if (options.digest || options.expect) {
+        bool tracking = cpu.watches == NULL && cpu.history == NULL;
+        if (start_digest(&digest, cpu.memory, tracking) != 0) {
+            fprintf(stderr, "%s", "State digest could not be computed.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.digest = &digest;
+    }
+
+    // Writes the path of the memory file of guest memory to stderr if
+    // requested, so that another process can map it read-only to see guest
+    // memory live (the path is also published with the live counters)
+    if (options.expose) {
+        char path[LIVE_PATH_LENGTH];
+        if (get_memory_path(cpu.memory_fd, path, LIVE_PATH_LENGTH) != 0) {
+            fprintf(stderr, "%s", "Guest memory could not be exposed.\n");
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "Guest memory: %s (%d bytes)\n", path, MEMORY_SIZE);
+    }
+
+    // Publishes live counters if requested, which are counted on each load
+    // and store, and published between slices of the run
+    LiveCounters live;
+    if (options.live != NULL) {
+        if (start_live_counters(&live, options.live, cpu.memory_fd) != 0) {
+            fprintf(stderr, "%s", "Live counters could not be published.\n");
+            return EXIT_FAILURE;
+        }
+        cpu.live = &live;
+    }
+
+    // Executes semihosting calls if requested, whose console output is
+    // buffered until the program stops
+    Semihost semihost;
+    if (options.semihost) {
+        start_semihost(&semihost);
+        cpu.semihost = &semihost;
+    }
+
+    // Runs the main execution pipeline of the emulator, which stops early if
+    // the program accesses memory out of bounds, hits a stopping watchpoint or
+    // exits through a semihosting call
+    StopReason reason = cpu.live == NULL ? run_emulator(&cpu) : run_live(&cpu);
+    if (cpu.live != NULL) {
+        stop_live_counters(&live);
+        cpu.live = NULL;
+    }
+    if (cpu.semihost != NULL) {
+        if (flush_semihost(&semihost) != 0) {
+            fprintf(stderr, "%s", "Semihosting output could not be written.\n");
+        }
+        cpu.semihost = NULL;
+    }
+    bool faulted = reason == STOP_MEMORY_FAULT;
+    if (faulted) {
+        fprintf(stderr, "Memory fault at address 0x%lx (PC = 0x%lx).\n", cpu.fault, cpu.pc);
+    } else if (reason == STOP_WATCHPOINT) {
+        fprintf(stderr, "Stopped at watchpoint (PC = 0x%lx).\n", cpu.pc);
+    }
+    if (cpu.watches != NULL) {
+        disarm_watchpoints(cpu.watches);
+    }
+    if (cpu.history != NULL) {
+        stop_history(&history, &cpu);
+    }
+
+    // Writes the execution statistics to stderr if requested
+    if (options.stats) {
+        write_statistics(&stats, cpu.retired, stderr);
+        cpu.stats = NULL;
+    }
+
+    // Writes the histogram of memory accesses to its file, and the heatmap to
+    // stderr, if requested
+    if (cpu.accesses != NULL) {
+        FILE *histogram = fopen(options.memprofile, "w");
+        if (histogram == NULL) {
+            fprintf(stderr, "%s", "Memory profile could not be written.\n");
+        } else {
+            write_memory_histogram(cpu.accesses, histogram);
+            fclose(histogram);
+        }
+        write_memory_heatmap(cpu.accesses, stderr);
+        stop_memory_profile(cpu.accesses);
+        cpu.accesses = NULL;
+    }
+
+    // Writes the coverage bitmap and lcov tracefile to their files, and a
+    // summary to stderr, if requested
+    if (cpu.coverage != NULL) {
+        FILE *bitmap = options.coverage == NULL ? NULL : fopen(options.coverage, "wb");
+        if (options.coverage != NULL && (bitmap == NULL || write_coverage(cpu.coverage, bitmap) != 0)) {
+            fprintf(stderr, "%s", "Coverage bitmap could not be written.\n");
+        }
+        if (bitmap != NULL) {
+            fclose(bitmap);
+        }
+        FILE *tracefile = options.lcov == NULL ? NULL : fopen(options.lcov, "w");
+        if (options.lcov != NULL && (tracefile == NULL || write_lcov(cpu.coverage, &symbols, tracefile) != 0)) {
+            fprintf(stderr, "%s", "Coverage tracefile could not be written.\n");
+        }
+        if (tracefile != NULL) {
+            fclose(tracefile);
+        }
+        write_coverage_summary(cpu.coverage, options.symbols != NULL ? &symbols : NULL, stderr);
+        free(cpu.coverage);
+        cpu.coverage = NULL;
+    }
+
+    // Writes the loop report to stderr if requested
+    if (cpu.loops != NULL) {
+        write_loop_report(&loops, cpu.retired, stderr);
+        stop_loop_profile(&loops);
+        cpu.loops = NULL;
+    }
+
+    // Writes the pipeline timing report to stderr if requested
+    if (cpu.timing != NULL) {
+        write_timing_report(&timing, stderr);
+        stop_timing_model(&timing);
+        cpu.timing = NULL;
+    }
+
+    // Writes the simulated cache report to stderr if requested
+    if (cpu.caches != NULL) {
+        write_cache_report(&caches, stderr);
+        stop_cache_model(&caches);
+        cpu.caches = NULL;
+    }
+    free_symbols(&symbols);
+
+    // Reverses execution if requested, replaying from the recorded history
+    if (options.reverse == REVERSE_STEP) {
+        if (reverse_step(&history, &cpu, options.steps) == 0) {
+            fprintf(stderr, "Reversed to instruction %lu (PC = 0x%lx).\n", cpu.retired, cpu.pc);
+        } else {
+            fprintf(stderr, "%s", "Execution history does not reach back that far.\n");
+        }
+    } else if (options.reverse == REVERSE_TO_WRITE) {
+        WatchPoint *written = &options.written.points[0];
+        if (reverse_to_write(&history, &cpu, &options.written) == 0) {
+            fprintf(stderr, "Reversed to last write to 0x%lx by instruction at PC = 0x%lx (instruction %lu).\n",
+                written->address, options.written.last_pc, cpu.retired);
+        } else {
+            fprintf(stderr, "No write to 0x%lx in the execution history.\n", written->address);
+        }
+    }
+    free_history(&history);
+
+    // Saves the decoded blocks for later runs, if not loaded from the cache
+    // (a replayed history decodes precisely, so is not saved either)
+    if (image != NULL && !cached && options.reverse == REVERSE_NONE
+            && save_cache(cpu.cache, options.cache_dir, image, image_size) != 0) {
+        fprintf(stderr, "%s", "Decoded blocks could not be saved to the cache.\n");
+    }
+    free(image);
+
+    // Digests the final state, and checks it against the expected digest
+    bool mismatched = false;
+    if (cpu.digest != NULL) {
+        Digest state = get_state_digest(&digest, &cpu);
+        stop_digest(&digest);
+        cpu.digest = NULL;
+        if (options.digest) {
+            fprintf(stderr, "%s", "State digest: ");
+            write_digest(state, stderr);
+            fprintf(stderr, "%s", "\n");
+        }
+        mismatched = options.expect && (state.high != options.expected.high || state.low != options.expected.low);
+        if (mismatched) {
+            fprintf(stderr, "%s", "State digest does not match the expected digest.\n");
+        }
+    }
+
+    // The output file may be omitted if a digest is expected
+    if (options.output_path != NULL) {
+        // Opens output file given by 2nd positional argument in write text mode
+        FILE *out = fopen(options.output_path, "w");
+        // Exits the program if null pointer is returned
+        if (out == NULL) {
+            fprintf(stderr, "%s", "Output file could not be opened.\n");
+            return EXIT_FAILURE;
+        }
+
+        // Writes the final emulator state to the output file
+        write_output(&cpu, out);
+
+        // Closes the output file and exits the program if attempt fails
+        if (close_file(out) != 0) {
+            fprintf(stderr, "%s", "Error occurred while closing output file");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Frees all dynamically allocated memory associated with the emulator
+    free_emulator(&cpu);
+    
+    if (faulted || mismatched) {
         return EXIT_FAILURE;
     }
+    // A program which exited through a semihosting call gives the exit status
+    return reason == STOP_EXIT ? semihost.status : EXIT_SUCCESS;
+}
 
-    // Writes the final emulator state to the output file
-    write_output(&cpu, out);
+static int emulate_batch(CPUState *cpu, Options *options) {
+    // Opens the seeds file, and forks a guest for each of its lines
+    FILE *seeds = fopen(options->batch_path, "r");
+    if (seeds == NULL) {
+        fprintf(stderr, "%s", "Seeds file could not be opened.\n");
+        return EXIT_FAILURE;
+    }
+    Batch batch;
+    int loaded = load_batch(seeds, cpu, &batch);
+    fclose(seeds);
+    if (loaded != 0) {
+        fprintf(stderr, "%s", "Batch could not be loaded.\n");
+        return EXIT_FAILURE;
+    }
 
-    // Closes the output file and exits the program if attempt fails
+    // Runs the guests in lockstep, reporting each guest which faulted
+    run_batch(&batch);
+    bool faulted = false;
+    for (int i = 0; i < batch.num_guests; i++) {
+        if (batch.reasons[i] == STOP_MEMORY_FAULT) {
+            fprintf(stderr, "Guest %d: Memory fault at address 0x%lx (PC = 0x%lx).\n",
+                i, batch.guests[i].fault, batch.guests[i].pc);
+            faulted = true;
+        }
+    }
+
+    // Writes the final state of each guest in turn to the output file
+    FILE *out = fopen(options->output_path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "%s", "Output file could not be opened.\n");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < batch.num_guests; i++) {
+        fprintf(out, "Guest %d:\n", i);
+        write_output(&batch.guests[i], out);
+    }
     if (close_file(out) != 0) {
         fprintf(stderr, "%s", "Error occurred while closing output file");
         return EXIT_FAILURE;
     }
 
-    // Frees all dynamically allocated memory associated with the emulator
-    free_emulator(&cpu);
-    
-    return EXIT_SUCCESS;
+    free_batch(&batch);
+    free_emulator(cpu);
+    return faulted ? EXIT_FAILURE : EXIT_SUCCESS;
 }
\ No newline at end of file
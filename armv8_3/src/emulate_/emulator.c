@@ -1,6 +1,10 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <limits.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "emulator.h"
 #include "../common/utilities.h"
@@ -11,57 +15,69 @@
 #include "dp_register.h"
 #include "single_data_transfer.h"
 #include "branch.h"
+#include "decoder.h"
+#include "decode_cache.h"
+#include "micro_op.h"
+#include "idioms.h"
+#include "fusion.h"
+#include "statistics.h"
+#include "watch.h"
+#include "history.h"
+#include "digest.h"
+#include "cache_model.h"
+#include "timing_model.h"
+#include "loops.h"
+#include "coverage.h"
+#include "runtime.h"
 
 /**
- * Declares a type DecodePtr representing a pointer to a decode function
- */ 
-typedef void (*DecodePtr)(uint32_t, Instr *);
+ * The point to which the SIGSEGV handler returns on a guest memory fault, the
+ * CPU state of the running emulator and the guest address of the fault - one
+ * of each per thread, as SIGSEGV is handled on the thread which faulted
+ */
+static _Thread_local sigjmp_buf faultPoint;
+static _Thread_local CPUState *faultCpu;
+static _Thread_local volatile uint64_t faultAddress;
+
+// Values returned to the fault point by a guest memory fault (at its address,
+// or at its offset in a guard area), and by a micro-op which stops the guest
+// (see exit_emulator)
+#define FAULT_JUMP 1
+#define EXIT_JUMP 2
+#define GUARD_JUMP 3
 
 /**
- * Declares a key-value pair with key = instruction type, value = pointer to a
- * decode function
+ * The number of threads running an emulator, which share the SIGSEGV handler
+ * (installed by the first, and the previous handler restored by the last),
+ * the lock which guards it and the previous handler
  */
-typedef struct {
-    uint32_t mask;
-    uint32_t pattern;
-    DecodePtr func_ptr;
-} DecodeEntry;
+static int handlerUsers;
+static pthread_mutex_t handlerLock = PTHREAD_MUTEX_INITIALIZER;
+static struct sigaction previousAction;
 
 /**
- * Defines a table (array of structs) that maps the op0 bit mask and pattern for
- * an instruction type to a pointer to its corresponding decode function
- */
-static DecodeEntry decodeTable[] = {
-    {DP_IMM_MASK, DP_IMM_PATTERN, &decode_dp_imm},
-    {DP_REG_MASK, DP_REG_PATTERN, &decode_dp_reg},
-    {SDT_MASK, SDT_PATTERN, &decode_single_data_transfer},
-    {BRANCH_MASK, BRANCH_PATTERN, &decode_branch},
-};
-
-/*
- * Declares a type ExecutePtr representing a pointer to an execute function
+ * Repeatedly fetches and executes instructions until the halt instruction is
+ * reached, a watchpoint stops execution, the PC leaves guest memory (other
+ * than for the runtime page), or the instruction limit is reached (taking a
+ * snapshot instead if recording)
  */
-typedef void (*ExecutePtr)(Instr *, CPUState *);
+static StopReason run_pipeline(CPUState *);
 
 /**
- * Declares a key-value pair with key = instruction type, value = pointer to an
- * execute function
+ * Handles SIGSEGV: if the fault is in a guard area of guest memory, returns to
+ * the fault point, if it is in a watched or write-protected page (for history
+ * or dirty page tracking), records the access and returns to retry it,
+ * otherwise restores the default action (the fault is a bug in the emulator
+ * itself)
  */
-typedef struct {
-    InstrType type;
-    ExecutePtr func_ptr;
-} ExecuteEntry;
+static void handle_fault(int, siginfo_t *, void *);
 
 /**
- * Defines a table (array of structs) that maps an instruction type to a pointer
- * to its corresponding execute function
+ * Returns the guest address of a memory fault which reached a guard area at a
+ * given offset (see is_guard_address): the offset itself if it is the address,
+ * otherwise the address accessed by the load or store at the PC
  */
-static ExecuteEntry executeTable[] = {
-    {DATA_PROCESSING_IMM, &execute_dp_imm},
-    {DATA_PROCESSING_REG, &execute_dp_reg},
-    {SINGLE_DATA_TRANSFER, &execute_single_data_transfer},
-    {BRANCH, &execute_branch}
-};
+static uint64_t get_guard_fault_address(CPUState *, uint64_t);
 
 /**
  * Fetches and returns the next instruction to be executed, using the address
@@ -70,16 +86,19 @@ static ExecuteEntry executeTable[] = {
 static uint32_t fetch(CPUState *);
 
 /**
- * Decodes a 32-bit instruction into an internal representation
- * Pre: the instruction is valid
+ * Forms a new block starting at a given address: decodes and lowers
+ * instructions into micro-ops in the decode cache until a branch or halt is
+ * reached (or the maximum block length), then looks for known idioms and
+ * fusible pairs in the block
  */
-static void decode(uint32_t, Instr *);
+static void form_block(CPUState *, uint64_t);
 
 /**
- * Executes a decoded instruction using a pointer to its internal representation
- * and updates the state of the CPU accordingly
+ * Sets the registers, PC and PSTATE flags of the CPU state to their initial
+ * values, with no instructions retired, no statistics, watchpoints, history or
+ * digest, and no limit
  */
-static void execute(Instr *, CPUState *);
+static void reset_state(CPUState *);
 
 /**
  * Returns the char representation of a flag - if flag is set, returns specified
@@ -88,12 +107,35 @@ static void execute(Instr *, CPUState *);
 static char show_flag(bool, char);
 
 int initialise_emulator(CPUState *cpu) {
-    // Dynamically allocates memory on the heap and initialises all values to 0
-    cpu->memory = calloc(MEMORY_SIZE, sizeof(uint8_t));
-    // Returns -1 if dynamic memory allocation fails
+    // Allocates guest memory between guard areas and initialises it to 0
+    cpu->memory = allocate_memory(&cpu->memory_fd);
+    // Returns -1 if memory allocation fails
     if (cpu->memory == NULL) {
         return -1;
     }
+    // Allocates an empty decode cache (every micro-op is UOP_DECODE)
+    cpu->cache = allocate_cache();
+    if (cpu->cache == NULL) {
+        free_memory(cpu->memory);
+        close(cpu->memory_fd);
+        return -1;
+    }
+    reset_state(cpu);
+    // Returns 0 if success 
+    return 0;
+}
+
+int reset_emulator(CPUState *cpu) {
+    // The memory of a forked emulator is no longer held by its memory file
+    if (cpu->memory_fd == -1 || clear_memory(cpu->memory_fd) != 0) {
+        return -1;
+    }
+    clear_cache(cpu->cache);
+    reset_state(cpu);
+    return 0;
+}
+
+static void reset_state(CPUState *cpu) {
     // Initialises the values of the general-purpose registers to 0
     for (int i = 0; i < NUM_GENERAL_REGISTERS; i++) {
         (cpu->registers)[i] = 0;
@@ -102,62 +144,303 @@ int initialise_emulator(CPUState *cpu) {
     cpu->zr = 0;
     // Sets program counter = 0
     cpu->pc = 0;
+    // No instructions have been retired, and statistics are not gathered
+    cpu->retired = 0;
+    cpu->stats = NULL;
+    cpu->fault = 0;
+    cpu->watches = NULL;
+    cpu->history = NULL;
+    cpu->limit = NO_LIMIT;
+    cpu->precise = false;
+    cpu->digest = NULL;
+    cpu->caches = NULL;
+    cpu->timing = NULL;
+    cpu->loops = NULL;
+    cpu->accesses = NULL;
+    cpu->coverage = NULL;
+    cpu->live = NULL;
+    cpu->semihost = NULL;
     // Sets processor state condition flags {N, Z, C, V} = {0, 1, 0, 0}
     PState pstate = { .n_flag = 0, .z_flag = 1, .c_flag = 0, .v_flag = 0 };
     cpu->pstate = pstate;
-    // Returns 0 if success 
+}
+
+int fork_emulator(CPUState *cpu, int num_copies, CPUState *copies) {
+    // The memory file only holds the state of the guest until it is forked
+    if (cpu->memory_fd == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_copies; i++) {
+        // Each copy maps the memory file privately, and decodes its own blocks
+        CPUState *copy = &copies[i];
+        *copy = *cpu;
+        copy->memory = copy_memory(cpu->memory_fd);
+        copy->cache = allocate_cache();
+        copy->memory_fd = -1;
+        copy->stats = NULL;
+        copy->watches = NULL;
+        copy->history = NULL;
+        copy->limit = NO_LIMIT;
+        copy->precise = false;
+        copy->digest = NULL;
+        copy->caches = NULL;
+        copy->timing = NULL;
+        copy->loops = NULL;
+        copy->accesses = NULL;
+        copy->coverage = NULL;
+        copy->live = NULL;
+        copy->semihost = NULL;
+        if (copy->memory == NULL || copy->cache == NULL) {
+            if (copy->memory != NULL) {
+                free_memory(copy->memory);
+            }
+            if (copy->cache != NULL) {
+                free_cache(copy->cache);
+            }
+            for (int j = 0; j < i; j++) {
+                free_emulator(&copies[j]);
+            }
+            return -1;
+        }
+    }
+
+    // The forked guest stops writing to the file, which then holds the state
+    // at the fork for as long as any copy maps it
+    if (make_memory_private(cpu->memory, cpu->memory_fd) != 0) {
+        for (int i = 0; i < num_copies; i++) {
+            free_emulator(&copies[i]);
+        }
+        return -1;
+    }
+    close(cpu->memory_fd);
+    cpu->memory_fd = -1;
     return 0;
 }
 
-void run_emulator(CPUState *cpu) {
+StopReason run_emulator(CPUState *cpu) {
+    // Installs the handler which turns accesses to the guard areas around
+    // guest memory into guest memory faults (and records watched accesses)
+    pthread_mutex_lock(&handlerLock);
+    if (handlerUsers++ == 0) {
+        struct sigaction action = { .sa_sigaction = &handle_fault, .sa_flags = SA_SIGINFO };
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previousAction);
+    }
+    pthread_mutex_unlock(&handlerLock);
+    faultCpu = cpu;
+
+    StopReason result;
+    switch (sigsetjmp(faultPoint, 1)) {
+        case 0:
+            result = run_pipeline(cpu);
+            break;
+        case EXIT_JUMP:
+            // The guest exited - the PC is still that of the call
+            result = STOP_EXIT;
+            break;
+        case GUARD_JUMP:
+            // A memory access reached a guard area - the PC is still that of
+            // its instruction, from which an address which did not fit in 32
+            // bits is recomputed (its offset only holds the low bits)
+            cpu->fault = get_guard_fault_address(cpu, faultAddress);
+            result = STOP_MEMORY_FAULT;
+            break;
+        default:
+            // A memory access faulted - the PC is still that of its instruction
+            cpu->fault = faultAddress;
+            result = STOP_MEMORY_FAULT;
+    }
+
+    faultCpu = NULL;
+    pthread_mutex_lock(&handlerLock);
+    if (--handlerUsers == 0) {
+        sigaction(SIGSEGV, &previousAction, NULL);
+    }
+    pthread_mutex_unlock(&handlerLock);
+    return result;
+}
+
+static StopReason run_pipeline(CPUState *cpu) {
+    // The micro-op executed for a call to the runtime page, which has no
+    // instruction words to decode
+    MicroOp call = { .handler = UOP_RUNTIME };
     for(;;) {
+        // Stops (or takes a snapshot, if recording) at the instruction limit
+        if (cpu->retired >= cpu->limit) {
+            if (cpu->history == NULL) {
+                return STOP_LIMIT;
+            }
+            take_snapshot(cpu->history, cpu);
+        }
+
+        // The PC is checked explicitly, as it also indexes the decode cache -
+        // outside guest memory, only the entries of the runtime page execute
+        MicroOp *op = &call;
+        if (cpu->pc < MEMORY_SIZE) {
+            // Fetches the next instruction to be executed
+            uint32_t instr = fetch(cpu);
 
-        // Fetches the next instruction to be executed
-        uint32_t instr = fetch(cpu);
+            // Stops execution pipeline when halt instruction is reached
+            if (instr == HALT_PATTERN) {
+                if (cpu->coverage != NULL) {
+                    MARK_COVERED(cpu->coverage, cpu->pc);
+                }
+                return STOP_HALT;
+            }
+
+            // Forms a new block if the instruction has not been decoded yet, or
+            // if it has been overwritten since it was decoded
+            uint64_t index = cpu->pc / INSTR_BYTES;
+            op = &cpu->cache->ops[index];
+            if (op->handler == UOP_DECODE || cpu->cache->raw[index] != instr) {
+                form_block(cpu, cpu->pc);
+            }
+        } else if (!is_runtime_entry(cpu->pc)) {
+            cpu->fault = cpu->pc;
+            return STOP_MEMORY_FAULT;
+        }
 
-        // Stops execution pipeline when halt instruction is reached
+        // Executes the micro-op (a single instruction, fused pair or idiom),
+        // reporting its accesses to watched memory
+        HandlerId handler = op->handler;
+        uint64_t pc = cpu->pc;
+        int retired = cpu->watches == NULL ? execute_micro_op(op, cpu) : execute_watched(op, cpu);
+        if (cpu->timing != NULL) {
+            model_timing(cpu->timing, op, pc, cpu->pc);
+        }
+        // Only a micro-op which transferred control is profiled, so loops are
+        // cheap enough to profile in every run (a runtime call returning is
+        // not a branch of the guest)
+        if (cpu->loops != NULL && cpu->pc != pc + retired * INSTR_BYTES && handler != UOP_RUNTIME) {
+            profile_branch(cpu->loops, handler, pc, cpu->pc, retired, cpu->retired + retired);
+        }
+        // Marks the words of the instructions retired - a fused pair or idiom
+        // retires each of its words at least once, so its words are the first
+        // of those retired (up to the longest pattern) - a runtime call has none
+        if (cpu->coverage != NULL && handler != UOP_RUNTIME) {
+            for (int i = 0; i < retired && i < MAX_PATTERN_LENGTH; i++) {
+                MARK_COVERED(cpu->coverage, pc + i * INSTR_BYTES);
+            }
+        }
+
+        cpu->retired += retired;
+        if (cpu->stats != NULL) {
+            cpu->stats->dispatches[handler]++;
+            cpu->stats->retired[handler] += retired;
+        }
+
+        if (cpu->watches != NULL && cpu->watches->stopped) {
+            return STOP_WATCHPOINT;
+        }
+    }
+}
+
+static void form_block(CPUState *cpu, uint64_t start) {
+    uint64_t first = start / INSTR_BYTES;
+    MicroOp *block = &cpu->cache->ops[first];
+    int length = 0;
+    // Set if a previously decoded entry is overwritten with a different word
+    bool stale = false;
+
+    for (uint64_t addr = start; length < MAX_BLOCK_LENGTH && addr < MEMORY_SIZE; addr += INSTR_BYTES) {
+        uint32_t instr = read_memory(BIT_MODE_32, cpu->memory, addr);
+        // The halt instruction is never cached - it ends the block
         if (instr == HALT_PATTERN) {
             break;
         }
 
+        MicroOp *op = &block[length];
+        uint32_t *raw = &cpu->cache->raw[first + length];
+        stale = stale || (op->handler != UOP_DECODE && *raw != instr);
+        *raw = instr;
+        length++;
+
+        // Lowers nop (no operation) and semihosting calls directly, as they
+        // have no decoded form
         if (instr == NOP_PATTERN) {
-            // Increments the PC if instruction is nop (no operation) 
-            increment_pc(cpu);
-        } else {
-            // Otherwise, decodes and executes the instruction
-            Instr decoded;
-            decode(instr, &decoded);
-            execute(&decoded, cpu);
+            *op = (MicroOp) { .handler = UOP_NOP };
+            continue;
+        }
+        if (instr == SEMIHOST_PATTERN) {
+            *op = (MicroOp) { .handler = UOP_SEMIHOST };
+            continue;
+        }
+        // An undefined instruction (eg: data following the code) ends the
+        // block, and is executed as a nop if it is ever reached
+        Instr decoded;
+        if (decode(instr, &decoded) != 0) {
+            *op = (MicroOp) { .handler = UOP_NOP };
+            break;
+        }
+        lower_instr(&decoded, addr, op);
+
+        // A branch ends the block
+        if (decoded.type == BRANCH) {
+            break;
         }
     }
-}
 
-static uint32_t fetch(CPUState *cpu) {
-    return read_memory(BIT_MODE_32, cpu->memory, cpu->pc);
+    // Idioms and fused pairs which start just before the block may span into a
+    // stale entry, so they are forgotten (found again if their block re-forms)
+    for (int i = 1; stale && i < MAX_PATTERN_LENGTH && start >= i * INSTR_BYTES; i++) {
+        block[-i].handler = UOP_DECODE;
+    }
+
+    // Idioms and fused pairs are not formed in precise mode (eg: while watching
+    // memory, so that each access is reported against the instruction which
+    // made it)
+    if (!cpu->precise) {
+        recognise_idioms(block, length, start);
+        fuse_pairs(block, length);
+    }
 }
 
-static void decode(uint32_t instr, Instr *decoded) {
-    // Extracts the bits representing the op0 (bits 25-28)
-    uint32_t op0 = extract_bits(instr, OP0_START, OP0_END);
+static void handle_fault(int signal_number, siginfo_t *info, void *context) {
+    uint64_t address;
+    if (faultCpu != NULL && is_guard_address(faultCpu->memory, info->si_addr, &address)) {
+        faultAddress = address;
+        siglongjmp(faultPoint, GUARD_JUMP);
+    }
+    if (faultCpu != NULL && faultCpu->watches != NULL && handle_watch_fault(faultCpu->watches, info->si_addr)) {
+        return;
+    }
+    if (faultCpu != NULL && faultCpu->history != NULL && handle_history_fault(faultCpu->history, info->si_addr)) {
+        return;
+    }
+    if (faultCpu != NULL && faultCpu->digest != NULL && handle_digest_fault(faultCpu->digest, info->si_addr)) {
+        return;
+    }
+    // Returning retries the access, which then terminates the emulator
+    signal(SIGSEGV, SIG_DFL);
+}
 
-    // Uses decodeTable to match instr type with the correct decode function
-    for (int i = 0; i < sizeof(decodeTable) / sizeof(decodeTable[0]); i++) {
-        // If bitwise AND of op0 and mask = pattern, instruction type matches
-        if ((op0 & decodeTable[i].mask) == decodeTable[i].pattern) {
-            // Passes the instruction to its corresponding decode function
-            decodeTable[i].func_ptr(instr, decoded);
-        }
+static uint64_t get_guard_fault_address(CPUState *cpu, uint64_t offset) {
+    // Only an offset with HIGH_OFFSET_BIT set (and no higher bit) has lost the
+    // high bits of its address
+    Instr instr;
+    if (offset < HIGH_OFFSET_BIT || offset >= 2 * HIGH_OFFSET_BIT
+            || decode(read_memory(BIT_MODE_32, cpu->memory, cpu->pc), &instr) != 0
+            || instr.type != SINGLE_DATA_TRANSFER) {
+        return offset;
     }
+    return get_transfer_address(&instr, cpu);
 }
 
-static void execute(Instr *instr, CPUState *cpu) {
-    // Uses executeTable to match instr type with the correct execute function
-    for (int i = 0; i < sizeof(executeTable) / sizeof(executeTable[0]); i++) {
-        if (executeTable[i].type == instr->type) {
-            // Passes the instruction to its corresponding execute function
-            executeTable[i].func_ptr(instr, cpu);
-        }
-    } 
+void exit_emulator(void) {
+    siglongjmp(faultPoint, EXIT_JUMP);
+}
+
+void fault_emulator(uint64_t address) {
+    faultAddress = address;
+    siglongjmp(faultPoint, FAULT_JUMP);
+}
+
+static uint32_t fetch(CPUState *cpu) {
+    if (cpu->caches != NULL) {
+        model_access(cpu->caches, ACCESS_FETCH, cpu->pc, cpu->pc, INSTR_BYTES);
+    }
+    return read_memory(BIT_MODE_32, cpu->memory, cpu->pc);
 }
 
 static char show_flag(bool flag, char symbol) {
@@ -196,5 +479,9 @@ void write_output(CPUState *cpu, FILE *fp) {
 }
 
 void free_emulator(CPUState *cpu) {
-    free(cpu->memory);
+    free_memory(cpu->memory);
+    if (cpu->memory_fd != -1) {
+        close(cpu->memory_fd);
+    }
+    free_cache(cpu->cache);
 }
\ No newline at end of file
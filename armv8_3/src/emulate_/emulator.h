@@ -5,19 +5,80 @@
 
 #include "../common/utilities.h"
 
+/**
+ * Represents the reasons for which the execution pipeline stops
+ */
+typedef enum {
+    STOP_HALT,
+    STOP_MEMORY_FAULT,
+    STOP_WATCHPOINT,
+    STOP_LIMIT,
+    STOP_EXIT,
+} StopReason;
+
 /**
  * Initialises the CPU state:
- * Sets memory locations and general-purpose register values to 0, PC = 0x0,
- * ZR = 0, and PSTATE condition flags {N, Z, C, F} = {0, 1, 0, 0}
+ * Sets memory locations (guarded - see allocate_memory) and general-purpose
+ * register values to 0, PC = 0x0, ZR = 0, and PSTATE condition flags
+ * {N, Z, C, F} = {0, 1, 0, 0}, and allocates an empty decode cache, with no
+ * instructions retired, no statistics, watchpoints, history, digest,
+ * simulated caches, timing model, loop or memory access profile, coverage
+ * bitmap, live counters or semihosting, and no limit
+ * Returns 0 if success and -1 otherwise
  */
 extern int initialise_emulator(CPUState *);
 
+/**
+ * Forks a paused emulator (one which is not running, with no watchpoints or
+ * history armed) into a given number of independent copies, each with its own
+ * CPU state and decode cache. Guest memory is not copied: every copy, and the
+ * forked emulator itself, maps the memory file privately, so pages are shared
+ * until written (copy-on-write)
+ * An emulator can only be forked once, and its copies cannot be forked
+ * Returns 0 if success and -1 otherwise
+ */
+extern int fork_emulator(CPUState *, int, CPUState *);
+
+/**
+ * Resets an emulator which has not been forked to its initial state (as set
+ * by initialise_emulator), clearing its memory and decode cache, so that it
+ * can run another binary without being allocated again
+ * Returns 0 if success and -1 otherwise
+ */
+extern int reset_emulator(CPUState *);
+
 /**
  * Runs the main execution pipeline of the emulator:
  * Until the halt instruction is reached, repeatedly fetches the next
  * instruction from memory, decodes it and executes it, updating the CPU state
+ * Returns the reason it stopped: the halt instruction is reached, the program
+ * accesses memory out of bounds (the PC is left at the faulting instruction,
+ * and the faulting address is stored in the CPU state), an instruction hits
+ * a watchpoint which stops execution (the PC is left after it), the
+ * instruction limit is reached, or the guest exits through a semihosting call
+ * (the PC is left at the call)
+ * Instructions are decoded a block at a time into compact micro-ops in the
+ * decode cache, and
+ * recognised idioms (eg: copy loops) are run as a single host operation and
+ * fused pairs of instructions are run in a single dispatch
+ */
+extern StopReason run_emulator(CPUState *);
+
+/**
+ * Stops the emulator running on this thread from within a micro-op handler,
+ * which run_emulator then returns as STOP_EXIT - the handler must not have
+ * updated the PC
+ * Pre: called while run_emulator is running on this thread
+ */
+extern _Noreturn void exit_emulator(void);
+
+/**
+ * Stops the emulator running on this thread from within a micro-op handler
+ * with a memory fault at a given guest address, which run_emulator then
+ * returns as STOP_MEMORY_FAULT - the handler must not have updated the PC
+ * Pre: called while run_emulator is running on this thread
  */
-extern void run_emulator(CPUState *);
+extern _Noreturn void fault_emulator(uint64_t);
 
 /**
  * Writes the CPU state (general-purpose registers, program counter, PSTATE
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fusion.h"
+#include "micro_op.h"
+#include "decode_cache.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+#include "memory.h"
+#include "dp_immediate.h"
+#include "dp_register.h"
+#include "single_data_transfer.h"
+#include "branch.h"
+
+/**
+ * Declares a type MatchPtr representing a pointer to a function which returns
+ * true if a pair of micro-ops with matching handlers can be fused
+ */
+typedef bool (*MatchPtr)(MicroOp *, MicroOp *);
+
+/**
+ * Declares an entry of the fusion table:
+ * first:   Handler of the first micro-op of the pair
+ * second:  Handler of the second micro-op of the pair
+ * matches: Returns true if the operands allow the pair to be fused
+ * fused:   Handler of the fused pair
+ */
+typedef struct {
+    HandlerId first;
+    HandlerId second;
+    MatchPtr matches;
+    HandlerId fused;
+} FusionEntry;
+
+/**
+ * Returns true for any operands
+ */
+static bool matches_any(MicroOp *, MicroOp *);
+
+/**
+ * Returns true if both micro-ops write to the same register (movz, movk)
+ */
+static bool matches_same_rd(MicroOp *, MicroOp *);
+
+/**
+ * Returns true if ands is tst (discards its result) and b.cond is b.ne
+ */
+static bool matches_tst_b_ne(MicroOp *, MicroOp *);
+
+/**
+ * Returns true if the instruction word at the (updated) PC is still the second
+ * instruction of the pair, ie: the first instruction did not overwrite it
+ */
+static bool second_is_current(MicroOp *, CPUState *);
+
+/**
+ * Defines the static table of fusible pairs
+ */
+#define FUSION_ENTRY(FIRST, first, SECOND, second, match) \
+    {UOP_##FIRST, UOP_##SECOND, &matches_##match, UOP_##FIRST##_##SECOND},
+static FusionEntry fusionTable[] = {
+    FUSED_PAIRS(FUSION_ENTRY)
+};
+
+void fuse_pairs(MicroOp *block, int length) {
+    for (int i = 0; i + 1 < length; i++) {
+        // Fuses the pair with the first entry in the table that matches
+        for (int j = 0; j < sizeof(fusionTable) / sizeof(fusionTable[0]); j++) {
+            FusionEntry *entry = &fusionTable[j];
+            if (block[i].handler == entry->first && block[i + 1].handler == entry->second
+                    && entry->matches(&block[i], &block[i + 1])) {
+                block[i].handler = entry->fused;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Defines the fused pair handlers - the specialised handlers of both micro-ops
+ * are called directly, so the handler id of the first (now the fused pair) and
+ * of the second (which may itself start a fused pair) are not used
+ * The second is not executed if it would retire past the instruction limit
+ */
+#define FUSED_HANDLER(FIRST, first, SECOND, second, match) \
+int execute_##first##_##second(MicroOp *op, CPUState *cpu) { \
+    execute_##first(&op[0], cpu); \
+    if (!second_is_current(op, cpu) || cpu->retired + 1 >= cpu->limit) { \
+        return 1; \
+    } \
+    execute_##second(&op[1], cpu); \
+    return 2; \
+}
+
+FUSED_PAIRS(FUSED_HANDLER)
+
+static bool matches_any(MicroOp *first, MicroOp *second) {
+    return true;
+}
+
+static bool matches_same_rd(MicroOp *first, MicroOp *second) {
+    return first->rd == second->rd;
+}
+
+static bool matches_tst_b_ne(MicroOp *ands, MicroOp *branch) {
+    // tst is an alias of ands with the zero register as destination
+    return ands->rd == ZERO_REG_INDEX && branch->aux == NE;
+}
+
+static bool second_is_current(MicroOp *op, CPUState *cpu) {
+    uint64_t index = &op[1] - cpu->cache->ops;
+    return read_memory(BIT_MODE_32, cpu->memory, cpu->pc) == cpu->cache->raw[index];
+}
\ No newline at end of file
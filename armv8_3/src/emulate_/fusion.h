@@ -0,0 +1,30 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdint.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+/**
+ * Looks for fusible pairs of adjacent micro-ops in a newly formed block and
+ * replaces the handler of the first micro-op of each pair with the handler of
+ * the fused pair (the second micro-op is left as it is)
+ * Pre: the micro-ops of the block are contiguous in the cache
+ */
+extern void fuse_pairs(MicroOp *, int);
+
+/**
+ * Declares the fused pair handlers execute_<first>_<second> - each executes
+ * both micro-ops of a pair in a single step, starting at the micro-op of the
+ * first instruction
+ * Returns the number of instructions retired: 2, or 1 if the second instruction
+ * was overwritten by the first or would retire past the instruction limit (it
+ * is then fetched again as normal)
+ */
+#define FUSED_HANDLER(FIRST, first, SECOND, second, match) \
+    extern int execute_##first##_##second(MicroOp *, CPUState *);
+FUSED_PAIRS(FUSED_HANDLER)
+#undef FUSED_HANDLER
+
+#endif
\ No newline at end of file
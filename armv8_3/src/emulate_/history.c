@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "history.h"
+#include "emulator.h"
+#include "decode_cache.h"
+#include "watch.h"
+#include "../common/utilities.h"
+
+/**
+ * Returns the snapshot with a given number
+ */
+static Snapshot *get_snapshot(History *, uint64_t);
+
+/**
+ * Returns the number of instructions retired at the end of the interval
+ * which starts at a given snapshot
+ */
+static uint64_t get_interval_end(History *, uint64_t);
+
+/**
+ * Returns true if a page was saved in the interval which starts at a given
+ * snapshot (ie: it was written in that interval)
+ */
+static bool is_page_saved(History *, uint64_t, int);
+
+/**
+ * Restores the memory and CPU state of a given snapshot, by copying back the
+ * pages saved in each interval from the current position down to it
+ * Pre: the snapshot is not after the current position
+ */
+static void restore_snapshot(History *, CPUState *, uint64_t);
+
+/**
+ * Restores a given snapshot, then replays until a given number of
+ * instructions have been retired, one instruction per dispatch (with a list of
+ * watchpoints armed, unless NULL)
+ */
+static void replay(History *, CPUState *, uint64_t, uint64_t, WatchList *);
+
+int start_history(History *history, CPUState *cpu, uint64_t interval) {
+    history->page_size = sysconf(_SC_PAGESIZE);
+    if (history->page_size <= 0 || MEMORY_SIZE / history->page_size > MAX_SAVED_PAGES / 2) {
+        return -1;
+    }
+    // Saved pages are only backed once used
+    uint64_t pool_size = (uint64_t) MAX_SAVED_PAGES * history->page_size;
+    history->pages = mmap(NULL, pool_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (history->pages == MAP_FAILED) {
+        history->pages = NULL;
+        return -1;
+    }
+
+    history->interval = interval;
+    history->memory = cpu->memory;
+    history->oldest = 0;
+    history->newest = UINT64_MAX;
+    history->next_slot = 0;
+    cpu->history = history;
+    take_snapshot(history, cpu);
+    return 0;
+}
+
+void take_snapshot(History *history, CPUState *cpu) {
+    // Drops the oldest snapshot (and its saved pages) if the maximum is kept
+    history->newest++;
+    if (history->newest - history->oldest == MAX_SNAPSHOTS) {
+        history->oldest++;
+    }
+
+    Snapshot *snapshot = get_snapshot(history, history->newest);
+    memcpy(snapshot->registers, cpu->registers, sizeof(snapshot->registers));
+    snapshot->pc = cpu->pc;
+    snapshot->pstate = cpu->pstate;
+    snapshot->retired = cpu->retired;
+    snapshot->first_slot = history->next_slot;
+
+    mprotect(history->memory, MEMORY_SIZE, PROT_READ);
+    cpu->limit = cpu->retired + history->interval;
+}
+
+bool handle_history_fault(History *history, void *host) {
+    uint8_t *byte = host;
+    if (history->memory == NULL || byte < history->memory || byte >= history->memory + MEMORY_SIZE) {
+        return false;
+    }
+    int page = (byte - history->memory) / history->page_size;
+
+    // Drops the oldest snapshots until there is a free slot (the newest is
+    // never dropped, as an interval saves each page at most once)
+    while (history->next_slot - get_snapshot(history, history->oldest)->first_slot == MAX_SAVED_PAGES) {
+        history->oldest++;
+    }
+
+    uint64_t slot = history->next_slot % MAX_SAVED_PAGES;
+    uint8_t *start = history->memory + page * history->page_size;
+    memcpy(history->pages + slot * history->page_size, start, history->page_size);
+    history->saved[slot] = page;
+    history->next_slot++;
+
+    mprotect(start, history->page_size, PROT_READ | PROT_WRITE);
+    return true;
+}
+
+void stop_history(History *history, CPUState *cpu) {
+    mprotect(history->memory, MEMORY_SIZE, PROT_READ | PROT_WRITE);
+    history->end = cpu->retired;
+    history->position = history->newest + 1;
+    cpu->history = NULL;
+    cpu->limit = NO_LIMIT;
+}
+
+int reverse_step(History *history, CPUState *cpu, uint64_t steps) {
+    if (steps > history->end - get_snapshot(history, history->oldest)->retired) {
+        return -1;
+    }
+    uint64_t target = history->end - steps;
+
+    // Replays from the newest snapshot at or before the target
+    uint64_t number = history->newest;
+    while (get_snapshot(history, number)->retired > target) {
+        number--;
+    }
+    replay(history, cpu, number, target, NULL);
+    return 0;
+}
+
+int reverse_to_write(History *history, CPUState *cpu, WatchList *watches) {
+    WatchPoint *point = &watches->points[0];
+    int first = point->address / history->page_size;
+    int last = (point->address + point->length - 1) / history->page_size;
+
+    for (uint64_t number = history->newest + 1; number-- > history->oldest;) {
+        // The range can only have been written in an interval which saved
+        // one of its pages
+        bool saved = false;
+        for (int page = first; page <= last; page++) {
+            saved = saved || is_page_saved(history, number, page);
+        }
+        if (!saved) {
+            continue;
+        }
+
+        replay(history, cpu, number, get_interval_end(history, number), watches);
+        if (watches->hit_count > 0) {
+            // Replays again up to and including the last write
+            uint64_t pc = watches->last_pc;
+            replay(history, cpu, number, watches->last_index + 1, NULL);
+            watches->last_pc = pc;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void free_history(History *history) {
+    if (history->pages != NULL) {
+        munmap(history->pages, (uint64_t) MAX_SAVED_PAGES * history->page_size);
+        history->pages = NULL;
+    }
+}
+
+static Snapshot *get_snapshot(History *history, uint64_t number) {
+    return &history->snapshots[number % MAX_SNAPSHOTS];
+}
+
+static uint64_t get_interval_end(History *history, uint64_t number) {
+    return number == history->newest ? history->end : get_snapshot(history, number + 1)->retired;
+}
+
+static bool is_page_saved(History *history, uint64_t number, int page) {
+    uint64_t end = number == history->newest ? history->next_slot : get_snapshot(history, number + 1)->first_slot;
+    for (uint64_t slot = get_snapshot(history, number)->first_slot; slot < end; slot++) {
+        if (history->saved[slot % MAX_SAVED_PAGES] == page) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void restore_snapshot(History *history, CPUState *cpu, uint64_t number) {
+    // Each interval saved its pages as they were at its start, so copying them
+    // back from the newest interval to the oldest restores the snapshot
+    for (uint64_t current = history->position; current-- > number;) {
+        Snapshot *snapshot = get_snapshot(history, current);
+        uint64_t end = current == history->newest ? history->next_slot : get_snapshot(history, current + 1)->first_slot;
+        for (uint64_t slot = snapshot->first_slot; slot < end; slot++) {
+            uint8_t *page = history->memory + history->saved[slot % MAX_SAVED_PAGES] * history->page_size;
+            memcpy(page, history->pages + (slot % MAX_SAVED_PAGES) * history->page_size, history->page_size);
+        }
+    }
+    history->position = number;
+
+    Snapshot *snapshot = get_snapshot(history, number);
+    memcpy(cpu->registers, snapshot->registers, sizeof(cpu->registers));
+    cpu->pc = snapshot->pc;
+    cpu->pstate = snapshot->pstate;
+    cpu->retired = snapshot->retired;
+}
+
+static void replay(History *history, CPUState *cpu, uint64_t number, uint64_t target, WatchList *watches) {
+    restore_snapshot(history, cpu, number);
+
+    // Blocks are formed again without idioms or fused pairs, so that execution
+    // can stop after any instruction
+    memset(cpu->cache, 0, sizeof(DecodeCache));
+    cpu->precise = true;
+    cpu->limit = target;
+    if (watches != NULL && arm_watchpoints(watches, cpu->memory) == 0) {
+        cpu->watches = watches;
+    }
+
+    run_emulator(cpu);
+
+    if (cpu->watches != NULL) {
+        disarm_watchpoints(cpu->watches);
+        cpu->watches = NULL;
+    }
+    cpu->limit = NO_LIMIT;
+    // Memory now holds the state at the end of the interval if it was replayed
+    // in full (the next snapshot, or the end of the history)
+    if (target == get_interval_end(history, number)) {
+        history->position = number + 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "watch.h"
+
+// Maximum number of snapshots kept (the oldest is dropped to make room)
+#define MAX_SNAPSHOTS 64
+// Maximum number of saved pages kept, in units of the smallest host page size
+// (4KB) - enough for every page of guest memory to be written in 4 intervals
+#define MAX_SAVED_PAGES (4 * MEMORY_SIZE / 4096)
+// Number of instructions between snapshots if no interval is given
+#define DEFAULT_SNAPSHOT_INTERVAL 1000000
+
+/**
+ * Represents a snapshot of the CPU state, taken when a given number of
+ * instructions had been retired - memory is not copied, but is restored from
+ * the pages saved since the snapshot (see History)
+ * first_slot: The first slot of the pages saved after the snapshot
+ */
+typedef struct {
+    uint64_t registers[NUM_GENERAL_REGISTERS];
+    uint64_t pc;
+    PState pstate;
+    uint64_t retired;
+    uint64_t first_slot;
+} Snapshot;
+
+/**
+ * Represents the execution history recorded for reverse execution. Each
+ * snapshot write-protects guest memory, so that the first write to each page
+ * after it faults and saves the page as it was at the snapshot:
+ * interval:      Number of instructions between snapshots
+ * snapshots:     The most recent snapshots, indexed by number modulo the max
+ * oldest:        Number of the oldest snapshot kept
+ * newest:        Number of the newest snapshot (the number taken - 1)
+ * memory:        Guest memory (NULL unless recording)
+ * page_size:     Host page size in bytes
+ * pages:         Saved page contents, indexed by slot modulo the max
+ * saved:         Page index of each saved page
+ * next_slot:     Slot of the next page saved
+ * end:           Number of instructions retired when recording stopped
+ * position:      Number of the snapshot whose state memory currently holds
+ *                (newest + 1 if the state at the end)
+ */
+typedef struct History {
+    uint64_t interval;
+    Snapshot snapshots[MAX_SNAPSHOTS];
+    uint64_t oldest;
+    uint64_t newest;
+    uint8_t *memory;
+    long page_size;
+    uint8_t *pages;
+    int saved[MAX_SAVED_PAGES];
+    volatile uint64_t next_slot;
+    uint64_t end;
+    uint64_t position;
+} History;
+
+/**
+ * Starts recording the execution history of the CPU, taking a snapshot every
+ * given number of instructions (the first is taken immediately)
+ * Returns 0 if success and -1 otherwise
+ */
+extern int start_history(History *, CPUState *, uint64_t);
+
+/**
+ * Takes a snapshot of the CPU state, dropping the oldest if the maximum number
+ * is kept, and schedules the next snapshot
+ */
+extern void take_snapshot(History *, CPUState *);
+
+/**
+ * Handles SIGSEGV on a host address: if it lies in write-protected guest
+ * memory, saves its page, unprotects it and returns true (the write is then
+ * retried), otherwise returns false
+ */
+extern bool handle_history_fault(History *, void *);
+
+/**
+ * Stops recording the execution history, leaving guest memory writable
+ */
+extern void stop_history(History *, CPUState *);
+
+/**
+ * Reverses execution by a given number of instructions: restores the nearest
+ * earlier snapshot, then replays forward one instruction at a time
+ * Returns 0 if success and -1 if the history does not reach back that far
+ */
+extern int reverse_step(History *, CPUState *, uint64_t);
+
+/**
+ * Reverses execution to just after the last instruction which wrote a range
+ * of memory (given as a write watchpoint): searches the intervals which saved
+ * its pages from the newest, replaying each with the watchpoint armed
+ * Returns 0 if success (the watchpoint records the PC of the instruction) and
+ * -1 if no instruction in the history wrote the range
+ */
+extern int reverse_to_write(History *, CPUState *, WatchList *);
+
+/**
+ * Frees the saved pages of the history
+ */
+extern void free_history(History *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+#include "idioms.h"
+#include "micro_op.h"
+#include "decode_cache.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+#include "registers.h"
+#include "memory.h"
+#include "single_data_transfer.h"
+#include "dp_immediate.h"
+#include "memory_profile.h"
+#include "live_counters.h"
+
+// Number of instructions in a copy loop: ldr, str, subs, b.ne
+#define COPY_LOOP_LENGTH 4
+
+/**
+ * Returns true if the 4 micro-ops starting at a given address form a copy loop
+ * which branches back to its first instruction:
+ * ldr Rt, [Rs], #k
+ * str Rt, [Rd], #k
+ * subs Rc, Rc, #d
+ * b.ne <first instruction>
+ * where k is the transfer size, and Rt, Rs, Rd, Rc are distinct registers
+ */
+static bool is_copy_loop(MicroOp *, uint64_t);
+
+/**
+ * Executes the first instruction of a copy loop which cannot be accelerated
+ */
+static int execute_first(MicroOp *, CPUState *);
+
+/**
+ * Executes the subs of a copy loop on its own, setting the flags from its
+ * result
+ */
+static int execute_count(MicroOp *, CPUState *);
+
+/**
+ * Returns the size in bytes of a transfer in a given bit mode (4 or 8)
+ */
+static int transfer_bytes(uint8_t);
+
+void recognise_idioms(MicroOp *block, int length, uint64_t start) {
+    // A copy loop ends in a branch, so it can only be found at the block tail
+    if (length >= COPY_LOOP_LENGTH) {
+        int tail = length - COPY_LOOP_LENGTH;
+        if (is_copy_loop(&block[tail], start + tail * INSTR_BYTES)) {
+            block[tail].handler = UOP_COPY_LOOP;
+        }
+    }
+}
+
+int execute_copy_loop(MicroOp *op, CPUState *cpu) {
+    // Checks that the loop body has not been modified since it was recognised
+    uint64_t index = op - cpu->cache->ops;
+    for (int i = 1; i < COPY_LOOP_LENGTH; i++) {
+        uint64_t address = cpu->pc + i * INSTR_BYTES;
+        if (read_memory(BIT_MODE_32, cpu->memory, address) != cpu->cache->raw[index + i]) {
+            return execute_first(op, cpu);
+        }
+    }
+
+    MicroOp *load = &op[0];
+    MicroOp *store = &op[1];
+    MicroOp *subs = &op[2];
+
+    // Only loops which reach a count of exactly 0 are accelerated
+    uint64_t decrement = subs->imm;
+    uint64_t count = read_register(subs->sf, cpu->registers, subs->rd);
+    if (decrement == 0 || count == 0 || count % decrement != 0) {
+        return execute_first(op, cpu);
+    }
+    uint64_t iterations = count / decrement;
+
+    uint8_t sf = load->sf;
+    uint64_t step = transfer_bytes(sf);
+    uint64_t src = read_register(sf, cpu->registers, load->rn);
+    uint64_t dst = read_register(sf, cpu->registers, store->rn);
+
+    // Bounds-checks both buffers against guest memory
+    if (iterations > MEMORY_SIZE / step) {
+        return execute_first(op, cpu);
+    }
+    uint64_t bytes = iterations * step;
+    if (src > MEMORY_SIZE - bytes || dst > MEMORY_SIZE - bytes) {
+        return execute_first(op, cpu);
+    }
+
+    // A forward word-by-word copy only behaves like memmove if the destination
+    // does not overlap the source from above
+    if (dst > src && dst < src + bytes) {
+        return execute_first(op, cpu);
+    }
+
+    // The copy must not overwrite the loop itself
+    uint64_t loop_end = cpu->pc + COPY_LOOP_LENGTH * INSTR_BYTES;
+    if (dst < loop_end && cpu->pc < dst + bytes) {
+        return execute_first(op, cpu);
+    }
+
+    // Runs only the iterations which fit before the instruction limit, so that
+    // execution stops exactly at it (the loop then continues from its start)
+    uint64_t budget = (cpu->limit - cpu->retired) / COPY_LOOP_LENGTH;
+    if (budget == 0) {
+        return execute_first(op, cpu);
+    }
+    bool partial = iterations > budget;
+    if (partial) {
+        iterations = budget;
+        bytes = iterations * step;
+    }
+
+    // Rt holds the last value loaded (read before the copy - the source word is
+    // never overwritten by an earlier iteration when the copy is allowed)
+    uint64_t last = read_memory(sf, cpu->memory, src + bytes - step);
+
+    // Profiles each load and store of the loop, as if it ran
+    if (cpu->accesses != NULL) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            profile_access(cpu->accesses, false, src + i * step, step);
+            profile_access(cpu->accesses, true, dst + i * step, step);
+        }
+    }
+    if (cpu->live != NULL) {
+        cpu->live->loads += iterations;
+        cpu->live->stores += iterations;
+    }
+
+    memmove(cpu->memory + dst, cpu->memory + src, bytes);
+
+    // Sets the registers to their values after the final iteration
+    write_register(sf, cpu->registers, load->rd, last);
+    write_register(sf, cpu->registers, load->rn, src + bytes);
+    write_register(sf, cpu->registers, store->rn, dst + bytes);
+
+    // The subs of a partial run leaves a count which is not 0, so the b.ne
+    // branches back to the start of the loop
+    if (partial) {
+        uint64_t start = cpu->pc;
+        write_register(subs->sf, cpu->registers, subs->rd, count - (iterations - 1) * decrement);
+        execute_count(subs, cpu);
+        cpu->pc = start;
+        return iterations * COPY_LOOP_LENGTH;
+    }
+    write_register(subs->sf, cpu->registers, subs->rd, 0);
+
+    // The final subs computes d - d = 0: sets Z and C (no borrow), clears N, V
+    PState pstate = { .n_flag = 0, .z_flag = 1, .c_flag = 1, .v_flag = 0 };
+    cpu->pstate = pstate;
+
+    // Falls through past the b.ne
+    cpu->pc = loop_end;
+    return iterations * COPY_LOOP_LENGTH;
+}
+
+static bool is_copy_loop(MicroOp *ops, uint64_t start) {
+    // ldr Rt, [Rs], #k followed by str Rt, [Rd], #k in the same bit mode
+    MicroOp *load = &ops[0];
+    MicroOp *store = &ops[1];
+    if (load->handler != UOP_LDR_POST_32 + load->sf
+            || store->handler != UOP_STR_POST_32 + store->sf || load->imm != transfer_bytes(load->sf) || load->sf != store->sf
+            || load->imm != store->imm || load->rd != store->rd) {
+        return false;
+    }
+
+    // subs Rc, Rc, #d
+    MicroOp *subs = &ops[2];
+    if (subs->handler != UOP_SUBS_IMM_32 + subs->sf || subs->rd != subs->rn) {
+        return false;
+    }
+
+    // b.ne <start>
+    MicroOp *branch = &ops[3];
+    if (branch->handler != UOP_B_COND || branch->aux != NE || (int64_t) branch->imm != start) {
+        return false;
+    }
+
+    // Rt, Rs, Rd and Rc must be distinct general-purpose registers
+    uint8_t regs[] = {load->rd, load->rn, store->rn, subs->rd};
+    int num_regs = sizeof(regs) / sizeof(regs[0]);
+    for (int i = 0; i < num_regs; i++) {
+        if (regs[i] == ZERO_REG_INDEX) {
+            return false;
+        }
+        for (int j = i + 1; j < num_regs; j++) {
+            if (regs[i] == regs[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int execute_first(MicroOp *op, CPUState *cpu) {
+    return op->sf == BIT_MODE_32 ? execute_ldr_post_32(op, cpu) : execute_ldr_post_64(op, cpu);
+}
+
+static int execute_count(MicroOp *subs, CPUState *cpu) {
+    return subs->sf == BIT_MODE_32 ? execute_subs_imm_32(subs, cpu) : execute_subs_imm_64(subs, cpu);
+}
+
+static int transfer_bytes(uint8_t sf) {
+    return (sf == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64) / CHAR_BIT;
+}
\ No newline at end of file
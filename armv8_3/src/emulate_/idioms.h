@@ -0,0 +1,28 @@
+#ifndef IDIOMS_H
+#define IDIOMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+/**
+ * Looks for known idioms in a newly formed block of micro-ops and replaces the
+ * handler of the micro-op at which each recognised idiom starts
+ * Pre: the micro-ops of the block are contiguous in the cache, and have not
+ * been fused yet
+ */
+extern void recognise_idioms(MicroOp *, int, uint64_t);
+
+/**
+ * Executes a copy loop (ldr/str with post-index, subs, b.ne) with a single
+ * bounds-checked host memmove, leaving registers, flags, memory and PC exactly
+ * as if the loop had been interpreted - only as many iterations as fit before
+ * the instruction limit are run, leaving the PC at the start of the loop
+ * If the loop cannot be accelerated, executes only its first instruction (ldr)
+ * Returns the number of instructions retired
+ */
+extern int execute_copy_loop(MicroOp *, CPUState *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "live_counters.h"
+#include "emulator.h"
+#include "memory.h"
+#include "../common/utilities.h"
+#include "../common/live_stats.h"
+
+// Number of nanoseconds in a second
+#define NANOSECONDS 1000000000
+
+/**
+ * Returns the current time (CLOCK_MONOTONIC) in nanoseconds
+ */
+static uint64_t get_live_time(void);
+
+/**
+ * Publishes the counters of a guest in a given state to the page, measuring
+ * the rate over a window which restarts every second
+ */
+static void publish_live_counters(CPUState *, LiveState);
+
+int start_live_counters(LiveCounters *live, char *name, int memory_fd) {
+    // The object is named /NAME, so NAME must be non-empty and have no '/'
+    if (*name == '\0' || strchr(name, '/') != NULL || strlen(name) + 1 >= NAME_MAX) {
+        return -1;
+    }
+    *live = (LiveCounters) { .loads = 0, .stores = 0 };
+    snprintf(live->name, NAME_MAX, "/%s", name);
+
+    int fd = shm_open(live->name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    void *page = MAP_FAILED;
+    if (ftruncate(fd, LIVE_STATS_SIZE) == 0) {
+        page = mmap(NULL, LIVE_STATS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (page == MAP_FAILED) {
+        shm_unlink(live->name);
+        return -1;
+    }
+
+    // The object is initialised to 0, so the sequence number starts even
+    live->page = page;
+    memcpy(live->page->magic, LIVE_STATS_MAGIC, LIVE_STATS_MAGIC_LENGTH);
+    live->page->version = LIVE_STATS_VERSION;
+    live->page->pid = getpid();
+    live->page->started = get_live_time();
+    if (get_memory_path(memory_fd, live->page->memory, LIVE_PATH_LENGTH) != 0) {
+        live->page->memory[0] = '\0';
+    }
+    live->page->size = MEMORY_SIZE;
+    live->window_time = live->page->started;
+    return 0;
+}
+
+StopReason run_live(CPUState *cpu) {
+    publish_live_counters(cpu, LIVE_RUNNING);
+    StopReason reason;
+    do {
+        cpu->limit = cpu->retired + LIVE_INTERVAL;
+        reason = run_emulator(cpu);
+        if (reason == STOP_LIMIT) {
+            publish_live_counters(cpu, LIVE_RUNNING);
+        }
+    } while (reason == STOP_LIMIT);
+    cpu->limit = NO_LIMIT;
+
+    publish_live_counters(cpu, reason == STOP_HALT ? LIVE_HALTED
+        : reason == STOP_MEMORY_FAULT ? LIVE_FAULTED
+        : reason == STOP_EXIT ? LIVE_EXITED : LIVE_STOPPED);
+    return reason;
+}
+
+void stop_live_counters(LiveCounters *live) {
+    shm_unlink(live->name);
+    munmap(live->page, LIVE_STATS_SIZE);
+}
+
+static uint64_t get_live_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * NANOSECONDS + now.tv_nsec;
+}
+
+static void publish_live_counters(CPUState *cpu, LiveState state) {
+    LiveCounters *live = cpu->live;
+    LiveStats *page = live->page;
+    uint64_t now = get_live_time();
+
+    // The rate is measured since the guest started until a whole second has
+    // passed, then over the last whole window
+    uint64_t rate = page->rate;
+    uint64_t elapsed = now - live->window_time;
+    if (elapsed >= NANOSECONDS || live->window_time == page->started) {
+        rate = elapsed == 0 ? 0 : (uint64_t) ((double) (cpu->retired - live->window_retired) * NANOSECONDS / elapsed);
+    }
+    if (elapsed >= NANOSECONDS) {
+        live->window_time = now;
+        live->window_retired = cpu->retired;
+    }
+
+    // Marks the record as being written (odd), writes it, then marks it as
+    // written (even) - a reader which saw either mark around its copy retries
+    uint64_t sequence = atomic_load_explicit(&page->sequence, memory_order_relaxed);
+    atomic_store_explicit(&page->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    page->state = state;
+    page->retired = cpu->retired;
+    page->pc = cpu->pc;
+    page->loads = live->loads;
+    page->stores = live->stores;
+    page->rate = rate;
+    page->updated = now;
+    atomic_store_explicit(&page->sequence, sequence + 2, memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef LIVE_COUNTERS_H
+#define LIVE_COUNTERS_H
+
+#include <stdint.h>
+#include <limits.h>
+
+#include "emulator.h"
+#include "../common/utilities.h"
+#include "../common/live_stats.h"
+
+/**
+ * Represents the live counters of the emulator, and the page to which they
+ * are published (see live_stats.h):
+ * loads:          Number of loads from guest memory
+ * stores:         Number of stores to guest memory
+ * page:           Shared mapping of the published page
+ * name:           Name of the shared memory object (with a leading '/')
+ * window_time:    Time at which the window of the rate started
+ * window_retired: Number of instructions retired when the window started
+ */
+typedef struct LiveCounters {
+    uint64_t loads;
+    uint64_t stores;
+    LiveStats *page;
+    char name[NAME_MAX];
+    uint64_t window_time;
+    uint64_t window_retired;
+} LiveCounters;
+
+/**
+ * Creates the shared memory object of a given name (/dev/shm/NAME) and
+ * publishes the counters of a guest which has not started yet to it, with the
+ * path of the memory file of its guest memory (given by its file descriptor)
+ * Returns 0 if success and -1 if the name is invalid or the object cannot be
+ * created
+ */
+extern int start_live_counters(LiveCounters *, char *, int);
+
+/**
+ * Runs the main execution pipeline of an emulator whose live counters are
+ * published, LIVE_INTERVAL instructions at a time, publishing them after each
+ * slice and when the guest stops
+ * Returns the reason it stopped (see run_emulator) - the instruction limit is
+ * not reached
+ */
+extern StopReason run_live(CPUState *);
+
+/**
+ * Removes the shared memory object of the live counters (a process which has
+ * it mapped still sees their final values)
+ */
+extern void stop_live_counters(LiveCounters *);
+
+#endif
\ No newline at end of file
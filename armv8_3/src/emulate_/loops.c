@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "loops.h"
+#include "micro_op.h"
+#include "symbols.h"
+#include "../common/utilities.h"
+
+// Initial number of loops which fit in the array of loops
+#define INITIAL_LOOPS 16
+
+/**
+ * Leaves every running loop, innermost first, which a taken branch from a
+ * given address to a given target leaves (either lies outside the loop)
+ * Returns true if the branch is the backward branch of the innermost loop
+ * still running
+ */
+static bool leave_loops(LoopProfile *, uint64_t, uint64_t);
+
+/**
+ * Ends a visit of a loop, counting its iterations
+ */
+static void end_visit(LoopProfile *, int, uint64_t);
+
+/**
+ * Returns the index of the loop with a given header and backward branch,
+ * adding it if it has not been found yet
+ * Returns -1 if the array of loops cannot be grown
+ */
+static int find_loop(LoopProfile *, uint64_t, uint64_t);
+
+/**
+ * Returns the estimated number of instructions retired by a loop: its
+ * iterations times its mean measured iteration length
+ */
+static double get_loop_instructions(const Loop *);
+
+/**
+ * Compares two loops for qsort: more instructions retired first, then the
+ * lower header address
+ */
+static int compare_loops(const void *, const void *);
+
+void start_loop_profile(LoopProfile *profile, SymbolMap *symbols) {
+    *profile = (LoopProfile) { .symbols = symbols };
+}
+
+void profile_branch(LoopProfile *profile, HandlerId handler, uint64_t pc, uint64_t next_pc,
+        int retired, uint64_t total) {
+    // An idiom which ran its whole loop falls through past its backward
+    // branch, having retired the loop body once per iteration
+    if (handler >= UOP_COPY_LOOP && next_pc > pc) {
+        uint64_t latch = next_pc - INSTR_BYTES;
+        uint64_t length = (next_pc - pc) / INSTR_BYTES;
+        leave_loops(profile, latch, pc);
+        int index = find_loop(profile, pc, latch);
+        if (index != -1) {
+            profile->loops[index].measured += retired - length;
+            profile->loops[index].measured_iterations += retired / length - 1;
+            end_visit(profile, index, retired / length);
+        }
+        profile->last_target = next_pc;
+        return;
+    }
+
+    // The branch is the last instruction of a fused pair
+    uint64_t branch = pc + (retired - 1) * INSTR_BYTES;
+    if (leave_loops(profile, branch, next_pc)) {
+        // Counts an iteration of the innermost loop, measured from the last
+        LoopVisit *visit = &profile->visits[profile->depth - 1];
+        visit->backedges++;
+        profile->loops[visit->loop].measured += total - visit->last;
+        profile->loops[visit->loop].measured_iterations++;
+        visit->last = total;
+    } else if (next_pc <= branch && profile->depth < MAX_LOOP_DEPTH) {
+        // Enters a loop - its first iteration is measured only if it ran
+        // straight from its header (no branch was taken since entering it)
+        int index = find_loop(profile, next_pc, branch);
+        if (index != -1) {
+            profile->visits[profile->depth++] = (LoopVisit) {
+                .loop = index, .backedges = 1, .last = total,
+            };
+            if (profile->last_target <= next_pc) {
+                profile->loops[index].measured += (branch - next_pc) / INSTR_BYTES + 1;
+                profile->loops[index].measured_iterations++;
+            }
+        }
+    }
+    profile->last_target = next_pc;
+}
+
+void write_loop_report(LoopProfile *profile, uint64_t retired, FILE *fp) {
+    while (profile->depth > 0) {
+        LoopVisit *visit = &profile->visits[--profile->depth];
+        end_visit(profile, visit->loop, visit->backedges + 1);
+    }
+    qsort(profile->loops, profile->num_loops, sizeof(Loop), &compare_loops);
+
+    fprintf(fp, "Loops: %d found\n", profile->num_loops);
+    for (int i = 0; i < profile->num_loops; i++) {
+        Loop *loop = &profile->loops[i];
+        double instructions = get_loop_instructions(loop);
+        fprintf(fp, "  0x%08lx", loop->header);
+        if (profile->symbols != NULL && find_symbol(profile->symbols, loop->header) != -1) {
+            fprintf(fp, "%s", " ");
+            write_symbolic(profile->symbols, loop->header, fp);
+        }
+        fprintf(fp, " (backward branch at 0x%08lx): %.2f%% of instructions\n", loop->latch,
+            retired == 0 ? 0.0 : 100.0 * instructions / retired);
+        fprintf(fp, "    %lu visits, %lu iterations (%lu min, %.2f mean, %lu max per visit)\n",
+            loop->visits, loop->iterations, loop->min_trips,
+            (double) loop->iterations / loop->visits, loop->max_trips);
+        if (loop->measured_iterations > 0) {
+            fprintf(fp, "    %.2f instructions per iteration\n",
+                (double) loop->measured / loop->measured_iterations);
+        }
+
+        // Writes the non-empty buckets of the trip count distribution
+        fprintf(fp, "%s", "    Trip counts:");
+        for (int bucket = 0; bucket < NUM_TRIP_BUCKETS; bucket++) {
+            if (loop->trips[bucket] == 0) {
+                continue;
+            }
+            uint64_t low = ((uint64_t) 1 << bucket) + 1;
+            uint64_t high = (uint64_t) 1 << bucket << 1;
+            if (low == high) {
+                fprintf(fp, " %lu: %lu", low, loop->trips[bucket]);
+            } else {
+                fprintf(fp, " %lu-%lu: %lu", low, high, loop->trips[bucket]);
+            }
+        }
+        fprintf(fp, "%s", "\n");
+    }
+}
+
+void stop_loop_profile(LoopProfile *profile) {
+    free(profile->loops);
+}
+
+static bool leave_loops(LoopProfile *profile, uint64_t branch, uint64_t target) {
+    while (profile->depth > 0) {
+        LoopVisit *visit = &profile->visits[profile->depth - 1];
+        Loop *loop = &profile->loops[visit->loop];
+        if (branch == loop->latch && target == loop->header) {
+            return true;
+        }
+        if (branch >= loop->header && branch <= loop->latch
+                && target >= loop->header && target <= loop->latch) {
+            return false;
+        }
+        end_visit(profile, visit->loop, visit->backedges + 1);
+        profile->depth--;
+    }
+    return false;
+}
+
+static void end_visit(LoopProfile *profile, int index, uint64_t trips) {
+    Loop *loop = &profile->loops[index];
+    if (loop->visits == 0 || trips < loop->min_trips) {
+        loop->min_trips = trips;
+    }
+    if (trips > loop->max_trips) {
+        loop->max_trips = trips;
+    }
+    loop->visits++;
+    loop->iterations += trips;
+
+    // Bucket b holds 2^b + 1 to 2^(b + 1) iterations (a visit seen has at
+    // least 2, having taken the backward branch)
+    int bucket = 0;
+    while ((trips - 1) >> (bucket + 1) != 0) {
+        bucket++;
+    }
+    loop->trips[bucket]++;
+}
+
+static int find_loop(LoopProfile *profile, uint64_t header, uint64_t latch) {
+    for (int i = 0; i < profile->num_loops; i++) {
+        if (profile->loops[i].header == header && profile->loops[i].latch == latch) {
+            return i;
+        }
+    }
+    if (profile->num_loops == profile->capacity) {
+        int capacity = profile->capacity == 0 ? INITIAL_LOOPS : 2 * profile->capacity;
+        Loop *loops = realloc(profile->loops, capacity * sizeof(Loop));
+        if (loops == NULL) {
+            return -1;
+        }
+        profile->loops = loops;
+        profile->capacity = capacity;
+    }
+    profile->loops[profile->num_loops] = (Loop) { .header = header, .latch = latch };
+    return profile->num_loops++;
+}
+
+static double get_loop_instructions(const Loop *loop) {
+    if (loop->measured_iterations == 0) {
+        return 0.0;
+    }
+    return (double) loop->measured / loop->measured_iterations * loop->iterations;
+}
+
+static int compare_loops(const void *first, const void *second) {
+    const Loop *loop = first;
+    const Loop *other = second;
+    double instructions = get_loop_instructions(loop);
+    double other_instructions = get_loop_instructions(other);
+    if (instructions != other_instructions) {
+        return instructions > other_instructions ? -1 : 1;
+    }
+    return loop->header < other->header ? -1 : loop->header > other->header;
+}
\ No newline at end of file
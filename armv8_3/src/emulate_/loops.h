@@ -0,0 +1,107 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "micro_op.h"
+#include "symbols.h"
+
+// Maximum depth of nested loops tracked at once (deeper loops are not counted)
+#define MAX_LOOP_DEPTH 64
+// Number of buckets of the trip count distribution: bucket b counts visits of
+// 2^b + 1 to 2^(b + 1) iterations
+#define NUM_TRIP_BUCKETS 64
+
+/**
+ * Represents a loop found from its backward taken branch, and its counters:
+ * header:              Address of the first instruction of the loop (the
+ *                      branch target)
+ * latch:               Address of the backward branch
+ * visits:              Number of times the loop was entered and left
+ * iterations:          Number of iterations of every visit
+ * min_trips:           Fewest iterations of a visit
+ * max_trips:           Most iterations of a visit
+ * trips:               Number of visits in each bucket of iteration counts
+ * measured:            Instructions retired by the iterations whose length was
+ *                      measured (including any inner loops)
+ * measured_iterations: Number of iterations whose length was measured
+ */
+typedef struct {
+    uint64_t header;
+    uint64_t latch;
+    uint64_t visits;
+    uint64_t iterations;
+    uint64_t min_trips;
+    uint64_t max_trips;
+    uint64_t trips[NUM_TRIP_BUCKETS];
+    uint64_t measured;
+    uint64_t measured_iterations;
+} Loop;
+
+/**
+ * Represents a visit of a loop which is running:
+ * loop:      Index of the loop
+ * backedges: Number of times its backward branch was taken so far
+ * last:      Number of instructions retired when it was last taken
+ */
+typedef struct {
+    int loop;
+    uint64_t backedges;
+    uint64_t last;
+} LoopVisit;
+
+/**
+ * Represents the profile of the loops of a program, which every taken branch is
+ * passed through:
+ * loops:       Every loop found so far
+ * num_loops:   Number of loops found
+ * capacity:    Number of loops which fit in the array of loops
+ * visits:      Visits of the running loops, innermost last
+ * depth:       Number of running loops
+ * last_target: Target of the last taken branch (execution has run straight
+ *              from there since)
+ * symbols:     Symbol map by which loops are reported (NULL if none)
+ */
+typedef struct LoopProfile {
+    Loop *loops;
+    int num_loops;
+    int capacity;
+    LoopVisit visits[MAX_LOOP_DEPTH];
+    int depth;
+    uint64_t last_target;
+    SymbolMap *symbols;
+} LoopProfile;
+
+/**
+ * Starts profiling the loops of a program, with a symbol map (or NULL)
+ */
+extern void start_loop_profile(LoopProfile *, SymbolMap *);
+
+/**
+ * Passes a micro-op which transferred control (its PC afterwards is not that of
+ * the next instruction), executed at a given PC, leaving the PC at a given
+ * address and retiring a number of instructions, and the total number of
+ * instructions retired, through the profile:
+ * A backward branch taken again within a visit counts an iteration of its
+ * loop, any other backward branch enters a loop, and a branch out of a running
+ * loop leaves it. An idiom which runs a whole loop counts a visit of it
+ * Visits of a single iteration (which never take the backward branch) are not
+ * seen
+ */
+extern void profile_branch(LoopProfile *, HandlerId, uint64_t, uint64_t, int, uint64_t);
+
+/**
+ * Writes each loop (by share of the instructions retired, largest first), its
+ * trip count distribution and its instructions per iteration to a file
+ * stream, given the total number of instructions retired - the loops which
+ * are still running are left first
+ */
+extern void write_loop_report(LoopProfile *, uint64_t, FILE *);
+
+/**
+ * Stops profiling the loops of a program, freeing them
+ */
+extern void stop_loop_profile(LoopProfile *);
+
+#endif
\ No newline at end of file
@@ -1,18 +1,116 @@
+// memfd_create is a GNU extension
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "memory.h"
 #include "../common/utilities.h"
 
+// Size of the whole reserved region: guard area, guest memory, guard area
+#define REGION_SIZE (GUARD_BELOW_SIZE + MEMORY_SIZE + GUARD_ABOVE_SIZE)
+
+/**
+ * Reserves a region with guard areas and maps a memory file over its guest
+ * memory, either shared (writes go to the file) or private (copy-on-write)
+ * Returns a pointer to guest memory, or NULL if mapping fails
+ */
+static uint8_t *map_memory(int, int);
+
+/**
+ * Returns the offset from guest memory at which an address is accessed (see
+ * HIGH_OFFSET_BIT)
+ */
+static inline uint64_t get_offset(uint64_t);
+
+uint8_t *allocate_memory(int *fd) {
+    // Creates the memory file (initialised to 0)
+    *fd = memfd_create("guest-memory", MFD_CLOEXEC);
+    if (*fd == -1) {
+        return NULL;
+    }
+    uint8_t *memory = NULL;
+    if (ftruncate(*fd, MEMORY_SIZE) == 0) {
+        memory = map_memory(*fd, MAP_SHARED);
+    }
+    if (memory == NULL) {
+        close(*fd);
+        *fd = -1;
+    }
+    return memory;
+}
+
+int get_memory_path(int fd, char *path, size_t size) {
+    if (fd == -1) {
+        return -1;
+    }
+    int length = snprintf(path, size, "/proc/%d/fd/%d", (int) getpid(), fd);
+    return length < 0 || length >= size ? -1 : 0;
+}
+
+uint8_t *copy_memory(int fd) {
+    return map_memory(fd, MAP_PRIVATE);
+}
+
+int make_memory_private(uint8_t *memory, int fd) {
+    // Replaces the shared mapping in place - its pages hold the same contents
+    uint8_t *private = mmap(memory, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    return private == MAP_FAILED ? -1 : 0;
+}
+
+int clear_memory(int fd) {
+    // Truncating the file discards its pages, which read as 0 once it is
+    // extended again
+    return ftruncate(fd, 0) == 0 && ftruncate(fd, MEMORY_SIZE) == 0 ? 0 : -1;
+}
+
+static uint8_t *map_memory(int fd, int sharing) {
+    // Reserves the whole region as inaccessible, without committing any pages
+    uint8_t *region = mmap(NULL, REGION_SIZE, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+    // Maps the memory file over guest memory, making it accessible
+    uint8_t *memory = region + GUARD_BELOW_SIZE;
+    if (mmap(memory, MEMORY_SIZE, PROT_READ | PROT_WRITE, sharing | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(region, REGION_SIZE);
+        return NULL;
+    }
+    return memory;
+}
+
+bool is_guard_address(uint8_t *memory, void *host, uint64_t *address) {
+    uint8_t *byte = host;
+    uint8_t *region = memory - GUARD_BELOW_SIZE;
+    if (byte < region || byte >= region + REGION_SIZE) {
+        return false;
+    }
+    // Addresses below guest memory wrap around to the top of the address space
+    *address = (uint64_t) (byte - memory);
+    return byte < memory || byte >= memory + MEMORY_SIZE;
+}
+
+void free_memory(uint8_t *memory) {
+    munmap(memory - GUARD_BELOW_SIZE, REGION_SIZE);
+}
+
 uint64_t read_memory(BitMode mode, uint8_t *memory, uint64_t address) {
     // Number of bytes to read: 4 bytes in 32-bit mode, 8 bytes in 64-bit mode
     int bytes = (mode == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64) / CHAR_BIT;
 
+    uint64_t offset = get_offset(address);
+
     uint64_t value = 0;
     // Reads memory one byte at a time
     for (int i = 0; i < bytes; i++) {
         // Since memory is little-endian, shifts each byte i by 8 * i bits
-        value |= ((uint64_t) memory[address + i]) << (i * CHAR_BIT);
+        value |= ((uint64_t) memory[offset + i]) << (i * CHAR_BIT);
     }
 
     return value;
@@ -24,11 +122,18 @@ void write_memory(BitMode mode, uint8_t *memory, uint64_t address, uint64_t valu
     
     // Creates a mask that isolates the least-significant byte
     uint64_t byte_mask = get_bit_mask(0, CHAR_BIT - 1);
+    uint64_t offset = get_offset(address);
     // Writes to memory one byte at a time
     for (int i = 0; i < bytes; i++) {
         // Writes least-significant byte to lowest address (since little-endian)
-        memory[address + i] = value & byte_mask;
+        memory[offset + i] = value & byte_mask;
         // Shifts value to the right by one byte
         value >>= CHAR_BIT;
     }
+}
+
+static inline uint64_t get_offset(uint64_t address) {
+    // Branch-free: a set high bit moves the address to the top of the guard
+    // area, instead of onto guest memory at its low 32 bits
+    return (uint32_t) address | (uint64_t) (address > UINT32_MAX) << 32;
 }
\ No newline at end of file
@@ -2,20 +2,97 @@
 #define MEMORY_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #include "../common/utilities.h"
 
+/**
+ * Defines the bit set in the offset at which read_memory and write_memory
+ * access an address which does not fit in 32 bits: the offset is the low 32
+ * bits of the address, with this bit set if any higher bit is, so that no
+ * address outside guest memory lands in it
+ */
+#define HIGH_OFFSET_BIT ((uint64_t) 1 << 32)
+
+/**
+ * Defines the size in bytes of the inaccessible guard areas below and above
+ * guest memory - the area above covers every offset which read_memory and
+ * write_memory can access (below 2 * HIGH_OFFSET_BIT), plus up to 8 bytes
+ */
+#define GUARD_BELOW_SIZE 65536
+#define GUARD_ABOVE_SIZE (2 * HIGH_OFFSET_BIT + 65536)
+
+/**
+ * Allocates guest memory (MEMORY_SIZE bytes, all 0) inside a region of the
+ * host address space which is reserved together with the guard areas around
+ * it, so that an out-of-bounds guest access raises SIGSEGV instead of reading
+ * or writing host memory - without any check on each access
+ * Guest memory is a shared mapping of an in-memory file (memfd), whose file
+ * descriptor is set, so that it can later be copied without copying its pages
+ * Returns a pointer to guest memory, or NULL if allocation fails
+ */
+extern uint8_t *allocate_memory(int *);
+
+/**
+ * Writes the path through which another process can open the memory file of
+ * guest memory (/proc/<pid>/fd/<fd>), and map it read-only to see guest memory
+ * live, to a buffer of a given size
+ * Returns 0 if success and -1 if guest memory is no longer shared with its
+ * memory file (eg: once forked) or the path does not fit
+ */
+extern int get_memory_path(int, char *, size_t);
+
+/**
+ * Allocates a copy of the guest memory held in a memory file, as a private
+ * mapping of the file: pages are shared with every other copy until written
+ * (copy-on-write)
+ * Returns a pointer to the copy, or NULL if allocation fails
+ */
+extern uint8_t *copy_memory(int);
+
+/**
+ * Makes guest memory a private mapping of its memory file, so that writes to
+ * it are no longer seen by copies of the file (its contents are unchanged)
+ * Returns 0 if success and -1 otherwise
+ */
+extern int make_memory_private(uint8_t *, int);
+
+/**
+ * Clears the guest memory held in a memory file (shared with the file) to 0,
+ * releasing its pages
+ * Returns 0 if success and -1 otherwise
+ */
+extern int clear_memory(int);
+
+/**
+ * Returns true if a host address lies in a guard area of guest memory, and
+ * sets the offset from guest memory which it corresponds to - the guest
+ * address itself if below HIGH_OFFSET_BIT, otherwise only its low 32 bits
+ * with HIGH_OFFSET_BIT set
+ */
+extern bool is_guard_address(uint8_t *, void *, uint64_t *);
+
+/**
+ * Frees guest memory, together with its guard areas
+ */
+extern void free_memory(uint8_t *);
+
 /**
  * Reads a value stored at an address in little-endian memory, either in 32-bit
  * or 64-bit mode
- * Pre: Memory address is in valid range
+ * The address is masked to its offset (see HIGH_OFFSET_BIT) without any check,
+ * so that an access outside guest memory, or which runs past its end, faults
+ * in the guard area above it (see allocate_memory)
  */
 extern uint64_t read_memory(BitMode, uint8_t *, uint64_t);
 
 /**
  * Writes a value to an address in little-endian memory, either in 32-bit or
  * 64-bit mode
- * Pre: Memory address is in valid range
+ * The address is masked to its offset (see HIGH_OFFSET_BIT) without any check,
+ * so that an access outside guest memory, or which runs past its end, faults
+ * in the guard area above it (see allocate_memory)
  */
 extern void write_memory(BitMode, uint8_t *, uint64_t, uint64_t);
 
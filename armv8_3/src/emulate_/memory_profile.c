@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "memory_profile.h"
+#include "symbols.h"
+#include "../common/utilities.h"
+
+// Number of hottest lines reported
+#define NUM_HOT_LINES 10
+// Number of pages shown in each row of the heatmap (128KB)
+#define HEATMAP_ROW_PAGES 32
+// Shades of the heatmap, from no accesses to the most accesses of any page
+#define HEATMAP_SHADES " .:-=+*#%@"
+#define NUM_HEATMAP_SHADES 10
+
+/**
+ * Returns the number of reads (or writes, if set) of a page
+ */
+static uint64_t get_page_count(MemoryProfile *, bool, int);
+
+/**
+ * Returns the number of bits needed to represent a count (0 for 0)
+ */
+static int get_bit_length(uint64_t);
+
+/**
+ * Writes a row of the heatmap of the reads (or writes, if set) of the pages
+ * from a given page, shaded by the bit length of each count relative to the
+ * most of any page
+ */
+static void write_heatmap_row(MemoryProfile *, bool, int, uint64_t, FILE *);
+
+MemoryProfile *start_memory_profile(SymbolMap *symbols) {
+    MemoryProfile *profile = calloc(1, sizeof(MemoryProfile));
+    if (profile != NULL) {
+        profile->symbols = symbols;
+    }
+    return profile;
+}
+
+void profile_access(MemoryProfile *profile, bool write, uint64_t address, int bytes) {
+    if (address > MEMORY_SIZE - bytes) {
+        return;
+    }
+    uint64_t *counts = write ? profile->writes : profile->reads;
+    for (uint64_t line = address / PROFILE_LINE_BYTES; line <= (address + bytes - 1) / PROFILE_LINE_BYTES; line++) {
+        counts[line]++;
+    }
+}
+
+void write_memory_histogram(MemoryProfile *profile, FILE *fp) {
+    fprintf(fp, "memprofile %d %d\n", PROFILE_LINE_BYTES, PROFILE_PAGE_BYTES);
+    for (int line = 0; line < NUM_PROFILE_LINES; line++) {
+        if (profile->reads[line] + profile->writes[line] > 0) {
+            fprintf(fp, "line 0x%08x %lu %lu\n", line * PROFILE_LINE_BYTES,
+                profile->reads[line], profile->writes[line]);
+        }
+    }
+    for (int page = 0; page < NUM_PROFILE_PAGES; page++) {
+        uint64_t reads = get_page_count(profile, false, page);
+        uint64_t writes = get_page_count(profile, true, page);
+        if (reads + writes > 0) {
+            fprintf(fp, "page 0x%08x %lu %lu\n", page * PROFILE_PAGE_BYTES, reads, writes);
+        }
+    }
+}
+
+void write_memory_heatmap(MemoryProfile *profile, FILE *fp) {
+    // Counts the working set, and the most reads and writes of any page
+    int lines = 0;
+    int pages = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t max_reads = 0;
+    uint64_t max_writes = 0;
+    for (int line = 0; line < NUM_PROFILE_LINES; line++) {
+        lines += profile->reads[line] + profile->writes[line] > 0;
+        reads += profile->reads[line];
+        writes += profile->writes[line];
+    }
+    for (int page = 0; page < NUM_PROFILE_PAGES; page++) {
+        uint64_t page_reads = get_page_count(profile, false, page);
+        uint64_t page_writes = get_page_count(profile, true, page);
+        pages += page_reads + page_writes > 0;
+        max_reads = page_reads > max_reads ? page_reads : max_reads;
+        max_writes = page_writes > max_writes ? page_writes : max_writes;
+    }
+    fprintf(fp, "Memory accesses: %lu line reads, %lu line writes\n", reads, writes);
+    fprintf(fp, "Working set: %d lines (%d bytes), %d pages (%d bytes)\n",
+        lines, lines * PROFILE_LINE_BYTES, pages, pages * PROFILE_PAGE_BYTES);
+
+    // Writes the hottest lines, by reads and writes, each chosen in turn
+    bool chosen[NUM_PROFILE_LINES] = {false};
+    fprintf(fp, "%s", "Hottest lines:\n");
+    for (int i = 0; i < NUM_HOT_LINES && i < lines; i++) {
+        int hottest = -1;
+        for (int line = 0; line < NUM_PROFILE_LINES; line++) {
+            uint64_t accesses = profile->reads[line] + profile->writes[line];
+            if (!chosen[line] && accesses > 0 && (hottest == -1
+                    || accesses > profile->reads[hottest] + profile->writes[hottest])) {
+                hottest = line;
+            }
+        }
+        chosen[hottest] = true;
+        fprintf(fp, "  0x%08x %12lu reads %12lu writes", hottest * PROFILE_LINE_BYTES,
+            profile->reads[hottest], profile->writes[hottest]);
+        // Names the line by the last label within it, if any
+        uint64_t address = (uint64_t) hottest * PROFILE_LINE_BYTES;
+        int symbol = profile->symbols == NULL ? -1
+            : find_symbol(profile->symbols, address + PROFILE_LINE_BYTES - 1);
+        if (symbol != -1 && profile->symbols->symbols[symbol].address >= address) {
+            fprintf(fp, "  %s", profile->symbols->symbols[symbol].name);
+        }
+        fprintf(fp, "%s", "\n");
+    }
+
+    // Writes the heatmap, a row per address range and a shade per page
+    fprintf(fp, "Heatmap (%d bytes per column, shades '%s' up to %lu reads, %lu writes per page):\n",
+        PROFILE_PAGE_BYTES, HEATMAP_SHADES, max_reads, max_writes);
+    fprintf(fp, "  %-10s %-*s  %s\n", "Address", HEATMAP_ROW_PAGES + 2, "Reads", "Writes");
+    for (int page = 0; page < NUM_PROFILE_PAGES; page += HEATMAP_ROW_PAGES) {
+        fprintf(fp, "  0x%08x ", page * PROFILE_PAGE_BYTES);
+        write_heatmap_row(profile, false, page, max_reads, fp);
+        fprintf(fp, "%s", "  ");
+        write_heatmap_row(profile, true, page, max_writes, fp);
+        fprintf(fp, "%s", "\n");
+    }
+}
+
+void stop_memory_profile(MemoryProfile *profile) {
+    free(profile);
+}
+
+static uint64_t get_page_count(MemoryProfile *profile, bool write, int page) {
+    uint64_t *counts = write ? profile->writes : profile->reads;
+    int lines_per_page = PROFILE_PAGE_BYTES / PROFILE_LINE_BYTES;
+    uint64_t count = 0;
+    for (int line = page * lines_per_page; line < (page + 1) * lines_per_page; line++) {
+        count += counts[line];
+    }
+    return count;
+}
+
+static int get_bit_length(uint64_t count) {
+    int length = 0;
+    while (count != 0) {
+        count >>= 1;
+        length++;
+    }
+    return length;
+}
+
+static void write_heatmap_row(MemoryProfile *profile, bool write, int first, uint64_t max, FILE *fp) {
+    int max_length = get_bit_length(max);
+    fprintf(fp, "%s", "|");
+    for (int page = first; page < first + HEATMAP_ROW_PAGES; page++) {
+        int length = get_bit_length(get_page_count(profile, write, page));
+        // Any access is at least the lightest shade, the most the darkest
+        int shade = 0;
+        if (length > 0) {
+            shade = max_length == 1 ? NUM_HEATMAP_SHADES - 1
+                : 1 + (length - 1) * (NUM_HEATMAP_SHADES - 2) / (max_length - 1);
+        }
+        fprintf(fp, "%c", HEATMAP_SHADES[shade]);
+    }
+    fprintf(fp, "%s", "|");
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef MEMORY_PROFILE_H
+#define MEMORY_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "symbols.h"
+
+// Sizes of the cache lines and pages by which accesses are counted
+#define PROFILE_LINE_BYTES 64
+#define PROFILE_PAGE_BYTES 4096
+#define NUM_PROFILE_LINES (MEMORY_SIZE / PROFILE_LINE_BYTES)
+#define NUM_PROFILE_PAGES (MEMORY_SIZE / PROFILE_PAGE_BYTES)
+
+/**
+ * Represents the profile of the data accesses of the guest to its memory:
+ * reads:   Number of loads from each cache line
+ * writes:  Number of stores to each cache line
+ * symbols: Symbol map by which the hottest lines are reported (NULL if none)
+ */
+typedef struct MemoryProfile {
+    uint64_t reads[NUM_PROFILE_LINES];
+    uint64_t writes[NUM_PROFILE_LINES];
+    SymbolMap *symbols;
+} MemoryProfile;
+
+/**
+ * Allocates an empty memory profile, with a symbol map (or NULL)
+ * Returns a pointer to it, or NULL if allocation fails
+ */
+extern MemoryProfile *start_memory_profile(SymbolMap *);
+
+/**
+ * Counts a load (or a store, if set) of a number of bytes at a guest address,
+ * once in each cache line it spans - accesses out of bounds are not counted
+ */
+extern void profile_access(MemoryProfile *, bool, uint64_t, int);
+
+/**
+ * Writes the histogram of the accesses to a file stream: a header line, then
+ * a line per cache line and per page which was accessed:
+ * line <address> <reads> <writes>
+ * page <address> <reads> <writes>
+ * (addresses in hexadecimal, counts in decimal, each in address order)
+ */
+extern void write_memory_histogram(MemoryProfile *, FILE *);
+
+/**
+ * Writes a summary of the accesses to a file stream: the working set (lines
+ * and pages accessed), the hottest lines, and a heatmap of the reads and of
+ * the writes of each page by address range (a hot line is named by the
+ * last label within it, if any)
+ */
+extern void write_memory_heatmap(MemoryProfile *, FILE *);
+
+/**
+ * Stops profiling memory accesses, freeing the profile
+ */
+extern void stop_memory_profile(MemoryProfile *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "micro_op.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+#include "dp_immediate.h"
+#include "dp_register.h"
+#include "single_data_transfer.h"
+#include "branch.h"
+#include "fusion.h"
+#include "idioms.h"
+#include "semihost.h"
+#include "runtime.h"
+
+/**
+ * Declares a type LowerPtr representing a pointer to a lower function
+ */
+typedef void (*LowerPtr)(Instr *, uint64_t, MicroOp *);
+
+/**
+ * Declares a key-value pair with key = instruction type, value = pointer to a
+ * lower function
+ */
+typedef struct {
+    InstrType type;
+    LowerPtr func_ptr;
+} LowerEntry;
+
+/**
+ * Defines a table (array of structs) that maps an instruction type to a pointer
+ * to its corresponding lower function
+ */
+static LowerEntry lowerTable[] = {
+    {DATA_PROCESSING_IMM, &lower_dp_imm},
+    {DATA_PROCESSING_REG, &lower_dp_reg},
+    {SINGLE_DATA_TRANSFER, &lower_single_data_transfer},
+    {BRANCH, &lower_branch},
+};
+
+/**
+ * Declares an entry of the handler table:
+ * name:     Human-readable name of the operation, shown in statistics
+ * func_ptr: Executes the micro-op
+ */
+typedef struct {
+    const char *name;
+    HandlerPtr func_ptr;
+} HandlerEntry;
+
+/**
+ * Handles a micro-op which has not been filled in by block formation
+ * Pre: never reached - the execution pipeline forms the block first
+ */
+static int execute_decode(MicroOp *, CPUState *);
+
+/**
+ * Executes a nop (no operation) micro-op - increments the PC
+ */
+static int execute_nop(MicroOp *, CPUState *);
+
+/**
+ * Defines the static table of micro-op handlers, indexed by HandlerId
+ */
+#define HANDLER(W, NAME, name) [UOP_##NAME##_##W] = {#name "/" #W, &execute_##name##_##W},
+#define FUSED_HANDLER(FIRST, first, SECOND, second, match) \
+    [UOP_##FIRST##_##SECOND] = {#first " + " #second, &execute_##first##_##second},
+static HandlerEntry handlerTable[] = {
+    [UOP_DECODE] = {"decode", &execute_decode},
+    [UOP_NOP] = {"nop", &execute_nop},
+    [UOP_SEMIHOST] = {"semihost", &execute_semihost},
+    [UOP_RUNTIME] = {"runtime", &execute_runtime_call},
+    SPECIALISED_HANDLERS
+    [UOP_B] = {"b", &execute_b},
+    [UOP_BR] = {"br", &execute_br},
+    [UOP_B_COND] = {"b.cond", &execute_b_cond},
+    FUSED_PAIRS(FUSED_HANDLER)
+    [UOP_COPY_LOOP] = {"copy loop", &execute_copy_loop},
+};
+#undef HANDLER
+#undef FUSED_HANDLER
+
+_Static_assert(sizeof(handlerTable) / sizeof(handlerTable[0]) == NUM_HANDLERS,
+    "every handler id must have an entry in the handler table");
+
+void lower_instr(Instr *instr, uint64_t address, MicroOp *op) {
+    // Clears every field, so unused fields of the micro-op are 0
+    *op = (MicroOp) {0};
+    // Uses lowerTable to match instr type with the correct lower function
+    for (int i = 0; i < sizeof(lowerTable) / sizeof(lowerTable[0]); i++) {
+        if (lowerTable[i].type == instr->type) {
+            // Passes the instruction to its corresponding lower function
+            lowerTable[i].func_ptr(instr, address, op);
+        }
+    }
+}
+
+int execute_micro_op(MicroOp *op, CPUState *cpu) {
+    return handlerTable[op->handler].func_ptr(op, cpu);
+}
+
+const char *get_handler_name(HandlerId handler) {
+    return handlerTable[handler].name;
+}
+
+static int execute_decode(MicroOp *op, CPUState *cpu) {
+    assert(0);
+    return 0;
+}
+
+static int execute_nop(MicroOp *op, CPUState *cpu) {
+    increment_pc(cpu);
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#ifndef MICRO_OP_H
+#define MICRO_OP_H
+
+#include <stdint.h>
+
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+
+/**
+ * X-macro lists of the operations which have specialised handlers. Each list
+ * expands X once per operation, in the order of the encoding fields which
+ * select it, so that the decoder can compute the handler id arithmetically
+ */
+
+// X(NAME, name, operator, flags): add, adds, sub, subs (opc order)
+#define ARITHMETIC_OPS(X) \
+    X(ADD, add, +, NO_FLAGS) \
+    X(ADDS, adds, +, SET_FLAGS_ADD) \
+    X(SUB, sub, -, NO_FLAGS) \
+    X(SUBS, subs, -, SET_FLAGS_SUB)
+
+// X(NAME, name, opc): movn, movz, movk
+#define WIDE_MOVE_OPS(X) \
+    X(MOVN, movn, MOVN_OPC) \
+    X(MOVZ, movz, MOVZ_OPC) \
+    X(MOVK, movk, MOVK_OPC)
+
+// X(NAME, name, operator, negate, set_flags): and, bic, ..., bics (opc, N order)
+#define LOGICAL_OPS(X) \
+    X(AND, and, &, 0, 0) \
+    X(BIC, bic, &, 1, 0) \
+    X(ORR, orr, |, 0, 0) \
+    X(ORN, orn, |, 1, 0) \
+    X(EOR, eor, ^, 0, 0) \
+    X(EON, eon, ^, 1, 0) \
+    X(ANDS, ands, &, 0, 1) \
+    X(BICS, bics, &, 1, 1)
+
+// X(NAME, name, operator): madd, msub (x order)
+#define MULTIPLY_OPS(X) \
+    X(MADD, madd, +) \
+    X(MSUB, msub, -)
+
+// X(NAME, name, L, mode): loads then stores (addressing mode order)
+#define TRANSFER_OPS(X) \
+    X(LDR_UNSIGNED, ldr_unsigned, LOAD_L, UNSIGNED_OFFSET) \
+    X(LDR_REGISTER, ldr_register, LOAD_L, REGISTER_OFFSET) \
+    X(LDR_PRE, ldr_pre, LOAD_L, PRE_INDEX) \
+    X(LDR_POST, ldr_post, LOAD_L, POST_INDEX) \
+    X(STR_UNSIGNED, str_unsigned, !LOAD_L, UNSIGNED_OFFSET) \
+    X(STR_REGISTER, str_register, !LOAD_L, REGISTER_OFFSET) \
+    X(STR_PRE, str_pre, !LOAD_L, PRE_INDEX) \
+    X(STR_POST, str_post, !LOAD_L, POST_INDEX)
+
+// X(FIRST, first, SECOND, second, match): pairs of adjacent instructions which
+// are fused into a single handler, if their operands match (see fusion.c)
+#define FUSED_PAIRS(X) \
+    X(SUBS_IMM_32, subs_imm_32, B_COND, b_cond, any) \
+    X(SUBS_IMM_64, subs_imm_64, B_COND, b_cond, any) \
+    X(SUBS_LSL_32, subs_lsl_32, B_COND, b_cond, any) \
+    X(SUBS_LSL_64, subs_lsl_64, B_COND, b_cond, any) \
+    X(MOVZ_32, movz_32, MOVK_32, movk_32, same_rd) \
+    X(MOVZ_64, movz_64, MOVK_64, movk_64, same_rd) \
+    X(LDR_POST_32, ldr_post_32, SUBS_IMM_32, subs_imm_32, any) \
+    X(LDR_POST_32, ldr_post_32, SUBS_IMM_64, subs_imm_64, any) \
+    X(LDR_POST_64, ldr_post_64, SUBS_IMM_32, subs_imm_32, any) \
+    X(LDR_POST_64, ldr_post_64, SUBS_IMM_64, subs_imm_64, any) \
+    X(STR_POST_32, str_post_32, SUBS_IMM_32, subs_imm_32, any) \
+    X(STR_POST_32, str_post_32, SUBS_IMM_64, subs_imm_64, any) \
+    X(STR_POST_64, str_post_64, SUBS_IMM_32, subs_imm_32, any) \
+    X(STR_POST_64, str_post_64, SUBS_IMM_64, subs_imm_64, any) \
+    X(ANDS_LSL_32, ands_lsl_32, B_COND, b_cond, tst_b_ne) \
+    X(ANDS_LSL_64, ands_lsl_64, B_COND, b_cond, tst_b_ne)
+
+/**
+ * Expand X once per bit width (32 then 64, ie: in sf order) and once per shift
+ * type (in shift order - ror is only valid for logical operations)
+ */
+#define FOR_EACH_WIDTH(X, ...) X(32, __VA_ARGS__) X(64, __VA_ARGS__)
+#define FOR_EACH_ARITHMETIC_SHIFT(X, ...) \
+    X(LSL, lsl, __VA_ARGS__) \
+    X(LSR, lsr, __VA_ARGS__) \
+    X(ASR, asr, __VA_ARGS__)
+#define FOR_EACH_LOGICAL_SHIFT(X, ...) \
+    FOR_EACH_ARITHMETIC_SHIFT(X, __VA_ARGS__) \
+    X(ROR, ror, __VA_ARGS__)
+
+#define NUM_WIDTHS 2
+#define NUM_ARITHMETIC_SHIFTS 3
+#define NUM_LOGICAL_SHIFTS 4
+
+/**
+ * Expand HANDLER(W, NAME, name) for every specialised handler of each class -
+ * HANDLER is defined by the user of the list (eg: to declare each handler
+ * execute_<name>_<W> or to list each handler id UOP_<NAME>_<W>)
+ */
+#define ARITHMETIC_IMM_HANDLERS(NAME, name, operator, flags) \
+    FOR_EACH_WIDTH(HANDLER, NAME##_IMM, name##_imm)
+#define WIDE_MOVE_HANDLERS(NAME, name, opc) \
+    FOR_EACH_WIDTH(HANDLER, NAME, name)
+#define SHIFT_HANDLERS(SHIFT, shift, NAME, name) \
+    FOR_EACH_WIDTH(HANDLER, NAME##_##SHIFT, name##_##shift)
+#define ARITHMETIC_REG_HANDLERS(NAME, name, operator, flags) \
+    FOR_EACH_ARITHMETIC_SHIFT(SHIFT_HANDLERS, NAME, name)
+#define LOGICAL_REG_HANDLERS(NAME, name, operator, negate, set_flags) \
+    FOR_EACH_LOGICAL_SHIFT(SHIFT_HANDLERS, NAME, name)
+#define MULTIPLY_HANDLERS(NAME, name, operator) \
+    FOR_EACH_WIDTH(HANDLER, NAME, name)
+#define TRANSFER_HANDLERS(NAME, name, L, mode) \
+    FOR_EACH_WIDTH(HANDLER, NAME, name)
+
+#define SPECIALISED_HANDLERS \
+    ARITHMETIC_OPS(ARITHMETIC_IMM_HANDLERS) \
+    WIDE_MOVE_OPS(WIDE_MOVE_HANDLERS) \
+    ARITHMETIC_OPS(ARITHMETIC_REG_HANDLERS) \
+    LOGICAL_OPS(LOGICAL_REG_HANDLERS) \
+    MULTIPLY_OPS(MULTIPLY_HANDLERS) \
+    TRANSFER_OPS(TRANSFER_HANDLERS) \
+    FOR_EACH_WIDTH(HANDLER, LDR_LITERAL, ldr_literal)
+
+/**
+ * Represents the id of the handler which executes a micro-op. Each operation
+ * has one handler per bit width (and shift type), eg: UOP_ADD_IMM_32,
+ * UOP_SUBS_LSL_64, UOP_LDR_POST_32, generated from the lists above
+ */
+#define HANDLER(W, NAME, name) UOP_##NAME##_##W,
+#define FUSED_ID(FIRST, first, SECOND, second, match) UOP_##FIRST##_##SECOND,
+typedef enum {
+    // Special
+    UOP_DECODE,           // Not decoded yet - the block must be formed first
+    UOP_NOP,
+    UOP_SEMIHOST,         // Semihosting call (hlt #0xf000) - see semihost.h
+    UOP_RUNTIME,          // Call to the runtime page - see runtime.h
+    // Specialised: imm = pre-shifted imm12/imm16 (aux = shift for wide moves),
+    // scaled imm12 or sign-extended simm9, or the absolute literal address
+    // aux = shift amount (arithmetic/logical), ra (multiply); rm = xm
+    SPECIALISED_HANDLERS
+    // Branch: imm = absolute target, aux = cond (conditional), rn = xn (register)
+    UOP_B,
+    UOP_BR,
+    UOP_B_COND,
+    // Fused pairs (the first micro-op keeps its fields, the second is op[1])
+    FUSED_PAIRS(FUSED_ID)
+    // Idioms (the first micro-op keeps its fields, the rest follow it)
+    UOP_COPY_LOOP,
+    NUM_HANDLERS,
+} HandlerId;
+#undef HANDLER
+#undef FUSED_ID
+
+_Static_assert(NUM_HANDLERS <= 256, "handler ids must fit in 8 bits");
+
+/**
+ * Represents a decoded instruction as a packed 8-byte micro-op:
+ * handler: Id of the handler which executes the micro-op
+ * sf:      Size flag (sf = 0: 32 bits, sf = 1: 64 bits)
+ * rd:      Destination or target register (rd, rt)
+ * rn:      1st operand or base register (rn, xn)
+ * rm:      2nd operand or offset register (rm, xm)
+ * aux:     Small operand, depending on the handler (shift, ra, cond)
+ * imm:     Immediate, pre-shifted or pre-sign-extended (or absolute address)
+ */
+typedef struct {
+    unsigned int handler : 8;
+    unsigned int sf : 1;
+    unsigned int rd : 5;
+    unsigned int rn : 5;
+    unsigned int rm : 5;
+    unsigned int aux : 8;
+    int32_t imm;
+} MicroOp;
+
+_Static_assert(sizeof(MicroOp) == 8, "micro-ops must be packed into 8 bytes");
+
+/**
+ * Declares a type HandlerPtr representing a pointer to a micro-op handler,
+ * which executes the micro-op, updates the CPU state accordingly and returns
+ * the number of instructions retired
+ */
+typedef int (*HandlerPtr)(MicroOp *, CPUState *);
+
+/**
+ * Lowers a decoded instruction at a given address into a micro-op
+ */
+extern void lower_instr(Instr *, uint64_t, MicroOp *);
+
+/**
+ * Executes a micro-op using the handler given by its handler id and returns
+ * the number of instructions retired
+ */
+extern int execute_micro_op(MicroOp *, CPUState *);
+
+/**
+ * Returns a human-readable name for a handler id
+ */
+extern const char *get_handler_name(HandlerId);
+
+#endif
\ No newline at end of file
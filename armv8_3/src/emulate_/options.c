@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+
+#include "options.h"
+#include "watch.h"
+#include "history.h"
+
+// Expected positional arguments: paths to input .bin file & output .out file
+// (which may be omitted if a digest is expected)
+#define NUM_POSITIONAL_ARGUMENTS 2
+
+/**
+ * Represents the identifiers of the long-only options
+ */
+enum {
+    STATS_OPTION = 256,
+    WATCH_OPTION,
+    WATCH_STOP_OPTION,
+    REVERSE_STEP_OPTION,
+    REVERSE_TO_WRITE_OPTION,
+    SNAPSHOT_INTERVAL_OPTION,
+    DIGEST_OPTION,
+    EXPECT_DIGEST_OPTION,
+    DECODE_CACHE_OPTION,
+    BATCH_OPTION,
+    SYMBOLS_OPTION,
+    CACHE_SIM_OPTION,
+    CACHE_OPTION,
+    MEMORY_LATENCY_OPTION,
+    TIMING_OPTION,
+    PIPELINE_OPTION,
+    PREDICTOR_OPTION,
+    LOOPS_OPTION,
+    MEMPROFILE_OPTION,
+    COVERAGE_OPTION,
+    LCOV_OPTION,
+    LIVE_OPTION,
+    EXPOSE_MEMORY_OPTION,
+    SEMIHOST_OPTION,
+};
+
+/**
+ * Parses a positive count (decimal, or hexadecimal with a 0x prefix)
+ * Returns 0 if success and -1 if the count is invalid
+ */
+static int parse_count(char *, uint64_t *);
+
+/**
+ * Defines the long options accepted by the emulator
+ */
+static struct option longOptions[] = {
+    {"stats", no_argument, NULL, STATS_OPTION},
+    {"watch", required_argument, NULL, WATCH_OPTION},
+    {"watch-stop", no_argument, NULL, WATCH_STOP_OPTION},
+    {"reverse-step", required_argument, NULL, REVERSE_STEP_OPTION},
+    {"reverse-to-write", required_argument, NULL, REVERSE_TO_WRITE_OPTION},
+    {"snapshot-interval", required_argument, NULL, SNAPSHOT_INTERVAL_OPTION},
+    {"digest", no_argument, NULL, DIGEST_OPTION},
+    {"expect-digest", required_argument, NULL, EXPECT_DIGEST_OPTION},
+    {"decode-cache", required_argument, NULL, DECODE_CACHE_OPTION},
+    {"batch", required_argument, NULL, BATCH_OPTION},
+    {"symbols", required_argument, NULL, SYMBOLS_OPTION},
+    {"cache-sim", no_argument, NULL, CACHE_SIM_OPTION},
+    {"cache", required_argument, NULL, CACHE_OPTION},
+    {"memory-latency", required_argument, NULL, MEMORY_LATENCY_OPTION},
+    {"timing", no_argument, NULL, TIMING_OPTION},
+    {"pipeline", required_argument, NULL, PIPELINE_OPTION},
+    {"predictor", required_argument, NULL, PREDICTOR_OPTION},
+    {"loops", no_argument, NULL, LOOPS_OPTION},
+    {"memprofile", required_argument, NULL, MEMPROFILE_OPTION},
+    {"coverage", required_argument, NULL, COVERAGE_OPTION},
+    {"lcov", required_argument, NULL, LCOV_OPTION},
+    {"live", required_argument, NULL, LIVE_OPTION},
+    {"expose-memory", no_argument, NULL, EXPOSE_MEMORY_OPTION},
+    {"semihost", no_argument, NULL, SEMIHOST_OPTION},
+    {NULL, 0, NULL, 0},
+};
+
+int parse_options(int argc, char **argv, Options *options) {
+    // Sets the default options
+    options->input_path = NULL;
+    options->output_path = NULL;
+    options->stats = false;
+    options->watches.num_points = 0;
+    options->watches.stop = false;
+    options->watches.memory = NULL;
+    options->watches.quiet = false;
+    options->reverse = REVERSE_NONE;
+    options->interval = DEFAULT_SNAPSHOT_INTERVAL;
+    options->digest = false;
+    options->expect = false;
+    options->cache_dir = NULL;
+    options->batch_path = NULL;
+    options->symbols = NULL;
+    options->cache_sim = false;
+    get_default_caches(options->caches);
+    options->mem_latency = DEFAULT_MEMORY_LATENCY;
+    options->timing = false;
+    get_default_pipeline(&options->pipeline);
+    options->loops = false;
+    options->memprofile = NULL;
+    options->coverage = NULL;
+    options->lcov = NULL;
+    options->live = NULL;
+    options->expose = false;
+    options->semihost = false;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (option) {
+            case STATS_OPTION:
+                options->stats = true;
+                break;
+            case WATCH_OPTION:
+                if (options->watches.num_points == MAX_WATCHPOINTS
+                        || parse_watchpoint(optarg, &options->watches.points[options->watches.num_points++]) != 0) {
+                    fprintf(stderr, "Invalid watchpoint: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case WATCH_STOP_OPTION:
+                options->watches.stop = true;
+                break;
+            case REVERSE_STEP_OPTION:
+                if (parse_count(optarg, &options->steps) != 0) {
+                    return -1;
+                }
+                options->reverse = REVERSE_STEP;
+                break;
+            case REVERSE_TO_WRITE_OPTION:
+                // The last write is found with a quiet write watchpoint
+                if (parse_watchpoint(optarg, &options->written.points[0]) != 0
+                        || options->written.points[0].type != WATCH_WRITE) {
+                    fprintf(stderr, "Invalid memory range: %s\n", optarg);
+                    return -1;
+                }
+                options->written.num_points = 1;
+                options->written.stop = false;
+                options->written.quiet = true;
+                options->written.memory = NULL;
+                options->reverse = REVERSE_TO_WRITE;
+                break;
+            case SNAPSHOT_INTERVAL_OPTION:
+                if (parse_count(optarg, &options->interval) != 0) {
+                    return -1;
+                }
+                break;
+            case DIGEST_OPTION:
+                options->digest = true;
+                break;
+            case EXPECT_DIGEST_OPTION:
+                if (parse_digest(optarg, &options->expected) != 0) {
+                    fprintf(stderr, "Invalid digest: %s\n", optarg);
+                    return -1;
+                }
+                options->expect = true;
+                break;
+            case DECODE_CACHE_OPTION:
+                options->cache_dir = optarg;
+                break;
+            case BATCH_OPTION:
+                options->batch_path = optarg;
+                break;
+            case SYMBOLS_OPTION:
+                options->symbols = optarg;
+                break;
+            case CACHE_SIM_OPTION:
+                options->cache_sim = true;
+                break;
+            case CACHE_OPTION:
+                if (parse_cache_config(optarg, options->caches) != 0) {
+                    fprintf(stderr, "Invalid cache configuration: %s\n", optarg);
+                    return -1;
+                }
+                options->cache_sim = true;
+                break;
+            case MEMORY_LATENCY_OPTION:
+                if (parse_count(optarg, &options->mem_latency) != 0) {
+                    return -1;
+                }
+                break;
+            case TIMING_OPTION:
+                options->timing = true;
+                break;
+            case PIPELINE_OPTION:
+                if (parse_pipeline_config(optarg, &options->pipeline) != 0) {
+                    fprintf(stderr, "Invalid pipeline configuration: %s\n", optarg);
+                    return -1;
+                }
+                options->timing = true;
+                break;
+            case PREDICTOR_OPTION:
+                if (parse_predictor(optarg, &options->pipeline) != 0) {
+                    fprintf(stderr, "Invalid branch predictor: %s\n", optarg);
+                    return -1;
+                }
+                options->timing = true;
+                break;
+            case LOOPS_OPTION:
+                options->loops = true;
+                break;
+            case MEMPROFILE_OPTION:
+                options->memprofile = optarg;
+                break;
+            case COVERAGE_OPTION:
+                options->coverage = optarg;
+                break;
+            case LCOV_OPTION:
+                options->lcov = optarg;
+                break;
+            case LIVE_OPTION:
+                options->live = optarg;
+                break;
+            case EXPOSE_MEMORY_OPTION:
+                options->expose = true;
+                break;
+            case SEMIHOST_OPTION:
+                options->semihost = true;
+                break;
+            default:
+                // Unknown option or missing option argument
+                return -1;
+        }
+    }
+
+    // Returns -1 if a batch is combined with an option which runs a single guest
+    if (options->batch_path != NULL && (options->stats || options->watches.num_points > 0
+            || options->reverse != REVERSE_NONE || options->digest || options->expect
+            || options->cache_dir != NULL || options->cache_sim || options->timing
+            || options->loops || options->memprofile != NULL || options->coverage != NULL
+            || options->lcov != NULL || options->live != NULL || options->expose
+            || options->semihost)) {
+        fprintf(stderr, "%s", "--batch cannot be combined with other options.\n");
+        return -1;
+    }
+
+    // Returns -1 if live counters are combined with reverse execution, as both
+    // stop the guest at an instruction limit
+    if (options->live != NULL && options->reverse != REVERSE_NONE) {
+        fprintf(stderr, "%s", "--live cannot be combined with reverse execution.\n");
+        return -1;
+    }
+
+    // Returns -1 if semihosting is combined with reverse execution, as replay
+    // cannot repeat the console input or output of a call
+    if (options->semihost && options->reverse != REVERSE_NONE) {
+        fprintf(stderr, "%s", "--semihost cannot be combined with reverse execution.\n");
+        return -1;
+    }
+
+    // Returns -1 if source lines are to be covered without a symbol map
+    if (options->lcov != NULL && options->symbols == NULL) {
+        fprintf(stderr, "%s", "--lcov needs the symbol map of the binary (--symbols).\n");
+        return -1;
+    }
+
+    // Returns -1 if the positional argument count is invalid
+    int num_positional = argc - optind;
+    if (num_positional != NUM_POSITIONAL_ARGUMENTS
+            && !(options->expect && num_positional == NUM_POSITIONAL_ARGUMENTS - 1)) {
+        return -1;
+    }
+    options->input_path = argv[optind];
+    options->output_path = num_positional == NUM_POSITIONAL_ARGUMENTS ? argv[optind + 1] : NULL;
+    return 0;
+}
+
+static int parse_count(char *string, uint64_t *count) {
+    char *end;
+    *count = strtoull(string, &end, 0);
+    return end == string || *end != '\0' || *count == 0 ? -1 : 0;
+}
+
+void print_usage(void) {
+    fprintf(stderr, "%s",
+        "Usage: ./emulate [options] <input_path> <output_path>\n"
+        "       ./emulate [options] --expect-digest DIGEST <input_path> [<output_path>]\n"
+        "Options:\n"
+        "  --stats                 Write fusion and idiom statistics to stderr on halt\n"
+        "  --watch ADDR[:LEN][:r|w]\n"
+        "                          Log reads (r) or writes (w, the default) of LEN\n"
+        "                          bytes (default 4) of memory at ADDR to stderr\n"
+        "  --watch-stop            Stop after the first instruction which hits a\n"
+        "                          watchpoint\n"
+        "  --reverse-step N        After the program stops, reverse execution by N\n"
+        "                          instructions\n"
+        "  --reverse-to-write ADDR[:LEN]\n"
+        "                          After the program stops, reverse execution to just\n"
+        "                          after the last write to LEN bytes (default 4) at ADDR\n"
+        "  --snapshot-interval N   Instructions between snapshots kept for reverse\n"
+        "                          execution (default 1000000)\n"
+        "  --digest                Write the digest of the final state to stderr\n"
+        "  --expect-digest DIGEST  Check the digest of the final state (32 hex digits),\n"
+        "                          failing if it differs\n"
+        "  --decode-cache DIR      Reuse the blocks decoded by earlier runs of the same\n"
+        "                          binary, kept in a cache file in DIR\n"
+        "  --batch SEEDS           Run one guest per line of SEEDS in lockstep, each\n"
+        "                          line setting registers (xN=VALUE) or memory words\n"
+        "                          (ADDR=WORD) before the guest starts\n"
+        "  --symbols MAP           Report addresses by label, from the symbol map\n"
+        "                          written by ./assemble --map\n"
+        "  --cache-sim             Simulate L1I, L1D and L2 caches, writing their hits,\n"
+        "                          misses and stall cycles (per label) to stderr on halt\n"
+        "  --cache LEVEL:SIZE:WAYS:LINE[:POLICY[:LATENCY]]\n"
+        "                          Configure a simulated cache (implies --cache-sim):\n"
+        "                          LEVEL is l1i, l1d or l2, POLICY lru, fifo or random\n"
+        "                          (eg: l1d:16k:2:32:fifo)\n"
+        "  --memory-latency N      Stall cycles of a simulated access served by memory\n"
+        "                          (default 100)\n"
+        "  --timing                Model the cycles taken by an in-order pipeline,\n"
+        "                          writing them (per basic block) to stderr on halt\n"
+        "  --pipeline LOAD:MULTIPLY:PENALTY\n"
+        "                          Set the load and multiply latencies and the branch\n"
+        "                          misprediction penalty in cycles (implies --timing,\n"
+        "                          default 3:3:8)\n"
+        "  --predictor NAME[:BITS] Predict branches with static, bimodal or gshare,\n"
+        "                          with 2^BITS counters (implies --timing, default\n"
+        "                          bimodal:10)\n");
+    // Profiling options are written separately, to keep each string within
+    // the length ISO C requires compilers to support
+    fprintf(stderr, "%s",
+        "  --loops                 Find loops from their backward branches, writing\n"
+        "                          their trip counts, instructions per iteration and\n"
+        "                          share of instructions to stderr on halt\n"
+        "  --memprofile FILE       Count the loads and stores of each cache line and\n"
+        "                          page, writing their histogram to FILE and the\n"
+        "                          working set and a heatmap to stderr on halt\n"
+        "  --coverage FILE         Write the bitmap of the instruction words executed\n"
+        "                          (bit i for the word at 4 * i) to FILE on halt\n"
+        "  --lcov FILE             Write the coverage of each source line to FILE on\n"
+        "                          halt as an lcov tracefile (needs --symbols, from a\n"
+        "                          map with source lines)\n"
+        "  --live NAME             Publish instructions retired, PC, MIPS, loads and\n"
+        "                          stores to /dev/shm/NAME while running (read them\n"
+        "                          with ./emustat NAME)\n"
+        "  --expose-memory         Write the path of the memory file of guest memory\n"
+        "                          to stderr, for another process to map read-only\n"
+        "                          and see guest memory live\n"
+        "  --semihost              Execute semihosting calls (hlt #0xf000, x0 = call):\n"
+        "                          1 putchar, 2 write, 3 read and 4 exit, buffering\n"
+        "                          console output on the host (not with reverse\n"
+        "                          execution)\n");
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "watch.h"
+#include "digest.h"
+#include "cache_model.h"
+#include "timing_model.h"
+
+/**
+ * Represents the ways in which execution is reversed after the program stops
+ */
+typedef enum {
+    REVERSE_NONE,
+    REVERSE_STEP,
+    REVERSE_TO_WRITE,
+} ReverseMode;
+
+/**
+ * Represents the command-line options of the emulator:
+ * input_path:  Path to the input .bin file
+ * output_path: Path to the output .out file (NULL if not written)
+ * stats:       If set, writes execution statistics to stderr on halt
+ * watches:     Watchpoints on guest memory, and whether a hit stops execution
+ * reverse:     How execution is reversed after the program stops
+ * steps:       Number of instructions to reverse by (REVERSE_STEP)
+ * written:     Memory whose last write to reverse to (REVERSE_TO_WRITE)
+ * interval:    Number of instructions between snapshots of the history
+ * digest:      If set, writes the digest of the final state to stderr
+ * expect:      If set, checks the digest of the final state against expected
+ * expected:    Expected digest of the final state
+ * cache_dir:   Directory of the cache files of decoded images (NULL if none)
+ * batch_path:  Path to a seeds file, to run a batch of guests in lockstep
+ *              (NULL if the binary runs once)
+ * symbols:     Path to the symbol map of the binary (NULL if none)
+ * cache_sim:   If set, simulates caches and writes their report to stderr on
+ *              halt
+ * caches:      Configuration of each simulated cache level
+ * mem_latency: Stall cycles of a simulated access served by memory
+ * timing:      If set, models the timing of an in-order pipeline and writes
+ *              its report to stderr on halt
+ * pipeline:    Configuration of the modelled pipeline and branch predictor
+ * loops:       If set, profiles loops and writes their report to stderr on
+ *              halt
+ * memprofile:  Path to which the histogram of memory accesses is written
+ *              (NULL if they are not profiled)
+ * coverage:    Path to which the bitmap of the instruction words executed is
+ *              written (NULL if not written)
+ * lcov:        Path to which the coverage of the source lines is written as an
+ *              lcov tracefile (NULL if not written)
+ * live:        Name of the shared memory object to which live counters are
+ *              published (NULL if not published)
+ * expose:      If set, writes the path of the memory file of guest memory to
+ *              stderr before running
+ * semihost:    If set, executes semihosting calls (otherwise they are nops)
+ */
+typedef struct {
+    char *input_path;
+    char *output_path;
+    bool stats;
+    WatchList watches;
+    ReverseMode reverse;
+    uint64_t steps;
+    WatchList written;
+    uint64_t interval;
+    bool digest;
+    bool expect;
+    Digest expected;
+    char *cache_dir;
+    char *batch_path;
+    char *symbols;
+    bool cache_sim;
+    CacheConfig caches[NUM_CACHE_LEVELS];
+    uint64_t mem_latency;
+    bool timing;
+    PipelineConfig pipeline;
+    bool loops;
+    char *memprofile;
+    char *coverage;
+    char *lcov;
+    char *live;
+    bool expose;
+    bool semihost;
+} Options;
+
+/**
+ * Parses the command-line arguments into emulator options
+ * Returns 0 if success and -1 if the arguments are invalid
+ */
+extern int parse_options(int, char **, Options *);
+
+/**
+ * Writes the usage message of the emulator to stderr
+ */
+extern void print_usage(void);
+
+#endif
\ No newline at end of file
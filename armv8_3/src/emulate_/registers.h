@@ -17,4 +17,18 @@ extern uint64_t read_register(BitMode, uint64_t *, uint32_t);
  */
 extern void write_register(BitMode, uint64_t *, uint32_t, uint64_t);
 
+/**
+ * Read and write a register in W-bit mode (W = 32 or 64), specialised on W at
+ * compile time - 32-bit reads and writes truncate by conversion to uint32_t
+ * Pre: Register index is in valid range (0 to 31)
+ */
+#define READ_REGISTER(W, registers, index) \
+    ((index) == ZERO_REG_INDEX ? ZERO_REG_VAL : (UINT_TYPE(W)) (registers)[index])
+#define WRITE_REGISTER(W, registers, index, value) \
+    do { \
+        if ((index) != ZERO_REG_INDEX) { \
+            (registers)[index] = (UINT_TYPE(W)) (value); \
+        } \
+    } while (0)
+
 #endif
\ No newline at end of file
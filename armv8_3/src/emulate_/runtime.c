@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "runtime.h"
+#include "micro_op.h"
+#include "emulator.h"
+#include "registers.h"
+#include "memory_profile.h"
+#include "live_counters.h"
+#include "watch.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+
+// Number of bytes processed per instruction retired by a routine
+#define RUNTIME_WORD_BYTES 8
+// Number of bytes compared at once by memcmp before its first difference is
+// looked for byte by byte
+#define COMPARE_CHUNK_BYTES 4096
+
+/**
+ * Faults at the first byte of a range of guest memory, given by its address
+ * and length, which lies outside guest memory (if any)
+ */
+static void check_range(uint64_t, uint64_t);
+
+/**
+ * Counts the loads (or stores, if set) of a range of guest memory, given by
+ * its address and length, as those of a word-at-a-time routine, in the memory
+ * profile and live counters (if any), and records it against the watchpoints
+ * Returns the number of words in the range
+ */
+static uint64_t count_words(CPUState *, bool, uint64_t, uint64_t);
+
+/**
+ * Returns the number of bytes of two ranges of guest memory, given by their
+ * addresses and length, which are compared up to and including the first
+ * difference (the length if they are equal)
+ */
+static uint64_t get_compared_length(uint8_t *, uint64_t, uint64_t, uint64_t);
+
+bool is_runtime_entry(uint64_t address) {
+    return address >= RUNTIME_PAGE && address < RUNTIME_PAGE + NUM_RUNTIME_CALLS * INSTR_BYTES
+        && address % INSTR_BYTES == 0;
+}
+
+int execute_runtime_call(MicroOp *op, CPUState *cpu) {
+    uint64_t first = read_register(BIT_MODE_64, cpu->registers, 0);
+    uint64_t second = read_register(BIT_MODE_64, cpu->registers, 1);
+    uint64_t length = read_register(BIT_MODE_64, cpu->registers, 2);
+    uint64_t result = first;
+    uint64_t words = 0;
+    switch ((cpu->pc - RUNTIME_PAGE) / INSTR_BYTES) {
+        case RUNTIME_MEMCPY:
+            check_range(second, length);
+            check_range(first, length);
+            count_words(cpu, false, second, length);
+            words = count_words(cpu, true, first, length);
+            memmove(cpu->memory + first, cpu->memory + second, length);
+            break;
+        case RUNTIME_MEMSET:
+            check_range(first, length);
+            words = count_words(cpu, true, first, length);
+            memset(cpu->memory + first, (uint8_t) second, length);
+            break;
+        case RUNTIME_MEMCMP: {
+            check_range(first, length);
+            check_range(second, length);
+            uint64_t compared = get_compared_length(cpu->memory, first, second, length);
+            count_words(cpu, false, first, compared);
+            words = count_words(cpu, false, second, compared);
+            // The difference of the first differing bytes, sign-extended
+            result = compared == 0 ? 0
+                : (int64_t) cpu->memory[first + compared - 1] - cpu->memory[second + compared - 1];
+            break;
+        }
+        case RUNTIME_STRLEN: {
+            // The string must be terminated within guest memory
+            check_range(first, 1);
+            uint8_t *end = memchr(cpu->memory + first, '\0', MEMORY_SIZE - first);
+            if (end == NULL) {
+                fault_emulator(MEMORY_SIZE);
+            }
+            result = end - (cpu->memory + first);
+            words = count_words(cpu, false, first, result + 1);
+            break;
+        }
+    }
+    write_register(BIT_MODE_64, cpu->registers, 0, result);
+    cpu->pc = read_register(BIT_MODE_64, cpu->registers, RUNTIME_LINK_REGISTER);
+    return 1 + words;
+}
+
+static void check_range(uint64_t address, uint64_t length) {
+    if (address >= MEMORY_SIZE && length > 0) {
+        fault_emulator(address);
+    }
+    if (length > MEMORY_SIZE - address) {
+        fault_emulator(MEMORY_SIZE);
+    }
+}
+
+static uint64_t count_words(CPUState *cpu, bool write, uint64_t address, uint64_t length) {
+    uint64_t words = (length + RUNTIME_WORD_BYTES - 1) / RUNTIME_WORD_BYTES;
+    if (cpu->accesses != NULL) {
+        for (uint64_t offset = 0; offset < length; offset += RUNTIME_WORD_BYTES) {
+            int bytes = length - offset < RUNTIME_WORD_BYTES ? length - offset : RUNTIME_WORD_BYTES;
+            profile_access(cpu->accesses, write, address + offset, bytes);
+        }
+    }
+    if (cpu->watches != NULL) {
+        record_range(cpu->watches, write ? WATCH_WRITE : WATCH_READ, address, length);
+    }
+    if (cpu->live != NULL) {
+        if (write) {
+            cpu->live->stores += words;
+        } else {
+            cpu->live->loads += words;
+        }
+    }
+    return words;
+}
+
+static uint64_t get_compared_length(uint8_t *memory, uint64_t first, uint64_t second, uint64_t length) {
+    // Compares whole chunks with the host memcmp, then finds the difference
+    // within the first chunk which differs
+    uint64_t offset = 0;
+    while (offset < length) {
+        uint64_t chunk = length - offset < COMPARE_CHUNK_BYTES ? length - offset : COMPARE_CHUNK_BYTES;
+        if (memcmp(memory + first + offset, memory + second + offset, chunk) != 0) {
+            while (memory[first + offset] == memory[second + offset]) {
+                offset++;
+            }
+            return offset + 1;
+        }
+        offset += chunk;
+    }
+    return length;
+}
\ No newline at end of file
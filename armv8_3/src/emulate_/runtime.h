@@ -0,0 +1,66 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+/**
+ * Defines the runtime calling convention, through which guest code asks the
+ * emulator to run a bulk memory routine on guest memory with a host routine:
+ * The guest sets x30 to its return address and the arguments in x0-x2, then
+ * branches (br) to the entry of the routine in the runtime page, which lies
+ * outside guest memory (eg: movz x16, #0xff, lsl #16; movk x16, #0x8;
+ * br x16 calls memcmp). The routine returns its result in x0 and branches to
+ * x30, leaving every other register and the flags unchanged:
+ * RUNTIME_MEMCPY (0xff0000): Copies x2 bytes from x1 to x0 (the ranges may
+ *                            overlap, as for memmove), returns x0
+ * RUNTIME_MEMSET (0xff0004): Sets x2 bytes at x0 to the low byte of x1,
+ *                            returns x0
+ * RUNTIME_MEMCMP (0xff0008): Compares x2 bytes at x0 and x1, returns the
+ *                            difference of the first differing bytes (as
+ *                            unsigned bytes), or 0 if they are all equal
+ * RUNTIME_STRLEN (0xff000c): Returns the length of the null-terminated string
+ *                            at x0
+ * Every byte a routine accesses must lie within guest memory, otherwise the
+ * call is a memory fault at the first byte outside it (with the PC left at
+ * the entry) and memory is left unchanged. A branch to any other address of
+ * the runtime page is a memory fault, as is any branch outside guest memory
+ * A call retires 1 instruction (the return), plus 1 for every 8 bytes (or
+ * part of them) it processes: x2 bytes for memcpy and memset, the bytes
+ * compared up to and including the first difference for memcmp, and the
+ * string with its terminator for strlen
+ * A call is a single micro-op, so execution cannot stop within it (eg: at an
+ * instruction limit, or a watchpoint hit by one of its accesses)
+ */
+typedef enum {
+    RUNTIME_MEMCPY,
+    RUNTIME_MEMSET,
+    RUNTIME_MEMCMP,
+    RUNTIME_STRLEN,
+    NUM_RUNTIME_CALLS,
+} RuntimeCall;
+
+// Address of the runtime page, whose entries are an instruction word apart
+#define RUNTIME_PAGE 0xff0000
+// Register holding the return address of a call (the link register)
+#define RUNTIME_LINK_REGISTER 30
+
+_Static_assert(RUNTIME_PAGE >= MEMORY_SIZE, "the runtime page must lie outside guest memory");
+
+/**
+ * Returns true if an address is the entry of a routine in the runtime page
+ */
+extern bool is_runtime_entry(uint64_t);
+
+/**
+ * Executes the routine whose entry is at the PC (see above), then returns to
+ * the link register - faults if it would access memory outside guest memory
+ * Pre: the PC is the entry of a routine (is_runtime_entry)
+ * Returns the number of instructions retired
+ */
+extern int execute_runtime_call(MicroOp *, CPUState *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "scheduler.h"
+#include "emulator.h"
+#include "../common/utilities.h"
+
+// Initial number of guests the queue can hold
+#define INITIAL_QUEUE_CAPACITY 64
+// Number of nanoseconds in a second
+#define NANOSECONDS 1000000000
+
+/**
+ * Runs a scheduler thread: repeatedly takes the next ready guest and runs it
+ * for a quantum, until the scheduler stops
+ */
+static void *run_thread(void *);
+
+/**
+ * Returns true if a guest should run before another: it has higher priority,
+ * or equal priority and an earlier deadline, or was queued first
+ */
+static bool runs_before(Guest *, Guest *);
+
+/**
+ * Adds a guest to the queue (which must be locked and have room for it - a
+ * guest which was running has its place kept)
+ */
+static void push_guest(Scheduler *, Guest *);
+
+/**
+ * Removes and returns the next guest to run from a non-empty queue (which
+ * must be locked)
+ */
+static Guest *pop_guest(Scheduler *);
+
+int start_scheduler(Scheduler *scheduler, int num_threads, uint64_t quantum) {
+    scheduler->quantum = quantum;
+    scheduler->num_threads = 0;
+    scheduler->num_queued = 0;
+    scheduler->num_running = 0;
+    scheduler->capacity = INITIAL_QUEUE_CAPACITY;
+    scheduler->tickets = 0;
+    scheduler->stopping = false;
+    scheduler->queue = malloc(scheduler->capacity * sizeof(Guest *));
+    scheduler->threads = malloc(num_threads * sizeof(pthread_t));
+    if (scheduler->queue == NULL || scheduler->threads == NULL) {
+        free(scheduler->queue);
+        free(scheduler->threads);
+        return -1;
+    }
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->ready, NULL);
+
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&scheduler->threads[i], NULL, &run_thread, scheduler) != 0) {
+            stop_scheduler(scheduler);
+            return -1;
+        }
+        scheduler->num_threads++;
+    }
+    return 0;
+}
+
+int submit_guest(Scheduler *scheduler, Guest *guest) {
+    pthread_mutex_lock(&scheduler->lock);
+    // Doubles the capacity of the queue when it is full, counting the places
+    // kept for running guests
+    if (scheduler->num_queued + scheduler->num_running == scheduler->capacity) {
+        Guest **queue = realloc(scheduler->queue, 2 * scheduler->capacity * sizeof(Guest *));
+        if (queue == NULL) {
+            pthread_mutex_unlock(&scheduler->lock);
+            return -1;
+        }
+        scheduler->queue = queue;
+        scheduler->capacity *= 2;
+    }
+    push_guest(scheduler, guest);
+    pthread_cond_signal(&scheduler->ready);
+    pthread_mutex_unlock(&scheduler->lock);
+    return 0;
+}
+
+void stop_scheduler(Scheduler *scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->stopping = true;
+    pthread_cond_broadcast(&scheduler->ready);
+    pthread_mutex_unlock(&scheduler->lock);
+
+    for (int i = 0; i < scheduler->num_threads; i++) {
+        pthread_join(scheduler->threads[i], NULL);
+    }
+    pthread_cond_destroy(&scheduler->ready);
+    pthread_mutex_destroy(&scheduler->lock);
+    free(scheduler->threads);
+    free(scheduler->queue);
+}
+
+uint64_t get_scheduler_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * NANOSECONDS + now.tv_nsec;
+}
+
+static void *run_thread(void *argument) {
+    Scheduler *scheduler = argument;
+    pthread_mutex_lock(&scheduler->lock);
+    for (;;) {
+        while (scheduler->num_queued == 0 && !scheduler->stopping) {
+            pthread_cond_wait(&scheduler->ready, &scheduler->lock);
+        }
+        if (scheduler->stopping) {
+            break;
+        }
+        Guest *guest = pop_guest(scheduler);
+        scheduler->num_running++;
+        pthread_mutex_unlock(&scheduler->lock);
+
+        // Runs the guest for a quantum, or up to its own limit if sooner
+        CPUState *cpu = guest->cpu;
+        uint64_t remaining = guest->limit > cpu->retired ? guest->limit - cpu->retired : 0;
+        cpu->limit = cpu->retired + (remaining < scheduler->quantum ? remaining : scheduler->quantum);
+        StopReason reason = run_emulator(cpu);
+        cpu->limit = guest->limit;
+
+        // A guest which was preempted (rather than reaching its own limit) is
+        // queued again behind the guests of equal priority and deadline, in
+        // the place kept for it while it ran
+        pthread_mutex_lock(&scheduler->lock);
+        scheduler->num_running--;
+        if (reason == STOP_LIMIT && cpu->retired < guest->limit) {
+            push_guest(scheduler, guest);
+            continue;
+        }
+        pthread_mutex_unlock(&scheduler->lock);
+        guest->reason = reason;
+        guest->finished(guest);
+        pthread_mutex_lock(&scheduler->lock);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+    return NULL;
+}
+
+static bool runs_before(Guest *guest, Guest *other) {
+    if (guest->priority != other->priority) {
+        return guest->priority > other->priority;
+    }
+    if (guest->deadline != other->deadline) {
+        return guest->deadline < other->deadline;
+    }
+    return guest->ticket < other->ticket;
+}
+
+static void push_guest(Scheduler *scheduler, Guest *guest) {
+    guest->ticket = scheduler->tickets++;
+    // Sifts the guest up from the end of the heap
+    int i = scheduler->num_queued++;
+    while (i > 0 && runs_before(guest, scheduler->queue[(i - 1) / 2])) {
+        scheduler->queue[i] = scheduler->queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    scheduler->queue[i] = guest;
+}
+
+static Guest *pop_guest(Scheduler *scheduler) {
+    Guest *next = scheduler->queue[0];
+    // Sifts the last guest down from the root of the heap
+    Guest *last = scheduler->queue[--scheduler->num_queued];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= scheduler->num_queued) {
+            break;
+        }
+        if (child + 1 < scheduler->num_queued
+                && runs_before(scheduler->queue[child + 1], scheduler->queue[child])) {
+            child++;
+        }
+        if (!runs_before(scheduler->queue[child], last)) {
+            break;
+        }
+        scheduler->queue[i] = scheduler->queue[child];
+        i = child;
+    }
+    scheduler->queue[i] = last;
+    return next;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../common/utilities.h"
+#include "emulator.h"
+
+// Default number of instructions which a guest runs before it is preempted
+#define DEFAULT_QUANTUM 100000
+// Deadline of a guest which has none
+#define NO_DEADLINE UINT64_MAX
+
+/**
+ * Represents a guest run by the scheduler:
+ * cpu:      CPU state of the guest (loaded, and not run by anything else)
+ * priority: Priority of the guest - a guest runs before any of lower priority
+ * deadline: Time (CLOCK_MONOTONIC, in nanoseconds) by which the guest should
+ *           finish (NO_DEADLINE if none) - of guests of equal priority, the
+ *           one with the earliest deadline runs first
+ * limit:    Total number of instructions retired at which the guest stops
+ *           (NO_LIMIT if none)
+ * finished: Called (on a scheduler thread) once the guest stops, with the
+ *           reason set
+ * context:  Pointer passed to finished with the guest
+ * reason:   Reason the guest stopped
+ * ticket:   Order in which the guest was last queued (guests of equal
+ *           priority and deadline take turns)
+ */
+typedef struct Guest {
+    CPUState *cpu;
+    int priority;
+    uint64_t deadline;
+    uint64_t limit;
+    void (*finished)(struct Guest *);
+    void *context;
+    StopReason reason;
+    uint64_t ticket;
+} Guest;
+
+/**
+ * Represents a preemptive scheduler, which time-slices guests across a fixed
+ * set of host threads:
+ * quantum:     Number of instructions a guest runs before it is preempted
+ * num_threads: Number of host threads
+ * threads:     Host threads, each running one guest at a time
+ * lock:        Guards the queue and stopping
+ * ready:       Signalled when a guest is queued, or the scheduler stops
+ * queue:       Ready guests, as a binary heap with the next guest to run first
+ * num_queued:  Number of guests in the queue
+ * num_running: Number of guests taken from the queue to run for a quantum,
+ *              each of which keeps a place in the queue to be queued again
+ * capacity:    Number of guests the queue can hold before it grows (at least
+ *              the number queued and running)
+ * tickets:     Number of tickets issued (see Guest)
+ * stopping:    Set once the scheduler is stopped
+ */
+typedef struct {
+    uint64_t quantum;
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Guest **queue;
+    int num_queued;
+    int num_running;
+    int capacity;
+    uint64_t tickets;
+    bool stopping;
+} Scheduler;
+
+/**
+ * Starts a scheduler with a given number of host threads and quantum
+ * Returns 0 if success and -1 otherwise
+ */
+extern int start_scheduler(Scheduler *, int, uint64_t);
+
+/**
+ * Queues a guest to run until it stops: the next ready guest is run for a
+ * quantum at a time on a free thread (resuming where it was preempted) and
+ * queued again, until it halts, faults or reaches its limit
+ * Returns 0 if success and -1 if the guest could not be queued
+ */
+extern int submit_guest(Scheduler *, Guest *);
+
+/**
+ * Stops a scheduler once each thread has finished its current quantum, and
+ * frees it - guests still queued are not finished
+ */
+extern void stop_scheduler(Scheduler *);
+
+/**
+ * Returns the current time (CLOCK_MONOTONIC) in nanoseconds, against which
+ * deadlines are set
+ */
+extern uint64_t get_scheduler_time(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "seed.h"
+#include "memory.h"
+#include "../common/utilities.h"
+
+// Delimiters between the assignments of a seed
+#define SEED_DELIMITERS " \t\r\n"
+
+/**
+ * Parses a number (decimal, or hexadecimal with a 0x prefix) which makes up a
+ * whole string
+ * Returns 0 if success and -1 if the number is invalid
+ */
+static int parse_number(char *, uint64_t *);
+
+int apply_seed(CPUState *cpu, char *line, bool *written) {
+    for (char *token = strtok(line, SEED_DELIMITERS); token != NULL;
+            token = strtok(NULL, SEED_DELIMITERS)) {
+        char *value = strchr(token, '=');
+        if (value == NULL) {
+            return -1;
+        }
+        *value++ = '\0';
+        uint64_t number;
+        if (parse_number(value, &number) != 0) {
+            return -1;
+        }
+
+        if (token[0] == 'x') {
+            // xN=VALUE sets a general-purpose register
+            char *end;
+            uint64_t index = strtoull(token + 1, &end, 10);
+            if (end == token + 1 || *end != '\0' || index >= NUM_GENERAL_REGISTERS) {
+                return -1;
+            }
+            cpu->registers[index] = number;
+        } else {
+            // ADDR=WORD writes a word of memory
+            uint64_t address;
+            if (parse_number(token, &address) != 0 || address > MEMORY_SIZE - INSTR_BYTES
+                    || number > UINT32_MAX) {
+                return -1;
+            }
+            write_memory(BIT_MODE_32, cpu->memory, address, number);
+            // An unaligned word spans 2 words of memory
+            if (written != NULL) {
+                written[address / INSTR_BYTES] = true;
+                written[(address + INSTR_BYTES - 1) / INSTR_BYTES] = true;
+            }
+        }
+    }
+    return 0;
+}
+
+static int parse_number(char *string, uint64_t *number) {
+    char *end;
+    *number = strtoull(string, &end, 0);
+    return end == string || *end != '\0' ? -1 : 0;
+}
\ No newline at end of file
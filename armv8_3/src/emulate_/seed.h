@@ -0,0 +1,20 @@
+#ifndef SEED_H
+#define SEED_H
+
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+
+/**
+ * Applies a seed to the initial state of a loaded emulator: a line of
+ * whitespace-separated assignments, where xN=VALUE sets general-purpose
+ * register N and ADDR=WORD writes a 32-bit word to memory (an empty line
+ * leaves the state unchanged)
+ * If given, the flag of each word written is set in an array with one flag per
+ * word of memory
+ * The line is modified (split into its assignments)
+ * Returns 0 if success and -1 if the seed is invalid
+ */
+extern int apply_seed(CPUState *, char *, bool *);
+
+#endif
\ No newline at end of file
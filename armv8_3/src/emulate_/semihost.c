@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "semihost.h"
+#include "micro_op.h"
+#include "emulator.h"
+#include "registers.h"
+#include "../common/utilities.h"
+
+// Host file descriptors of the guest streams, which the guest names the same
+#define STDIN_FD 0
+#define STDOUT_FD 1
+#define STDERR_FD 2
+// Result of a call which failed
+#define SEMIHOST_FAILURE UINT64_MAX
+
+/**
+ * Starts a buffered stream on a host file descriptor
+ */
+static void start_stream(SemihostStream *, int);
+
+/**
+ * Appends bytes to a buffered output stream, writing the buffer first if they
+ * do not fit (and the bytes directly if they do not fit in an empty buffer),
+ * and then if a line is complete on a terminal
+ * Returns 0 if success and -1 if the stream could not be written
+ */
+static int write_stream(SemihostStream *, const uint8_t *, size_t);
+
+/**
+ * Writes the buffered bytes of an output stream to its file descriptor
+ * Returns 0 if success and -1 if they could not all be written
+ */
+static int flush_stream(SemihostStream *);
+
+/**
+ * Writes bytes to a file descriptor, retrying until they are all written
+ * Returns 0 if success and -1 otherwise
+ */
+static int write_all(int, const uint8_t *, size_t);
+
+/**
+ * Reads up to a number of bytes from a buffered input stream, refilling its
+ * buffer with a single read if it is empty (after flushing the output, so a
+ * prompt is seen before input is awaited)
+ * Returns the number of bytes read (0 at the end of the input), or -1 if the
+ * stream could not be read
+ */
+static int64_t read_stream(Semihost *, uint8_t *, size_t);
+
+/**
+ * Returns true if a range of guest memory, given by its address and length,
+ * lies within guest memory
+ */
+static bool in_bounds(uint64_t, uint64_t);
+
+void start_semihost(Semihost *semihost) {
+    start_stream(&semihost->in, STDIN_FD);
+    start_stream(&semihost->out, STDOUT_FD);
+    start_stream(&semihost->err, STDERR_FD);
+    semihost->status = 0;
+}
+
+int execute_semihost(MicroOp *op, CPUState *cpu) {
+    Semihost *semihost = cpu->semihost;
+    if (semihost == NULL) {
+        increment_pc(cpu);
+        return 1;
+    }
+
+    uint64_t call = read_register(BIT_MODE_64, cpu->registers, 0);
+    uint64_t fd = read_register(BIT_MODE_64, cpu->registers, 1);
+    uint64_t address = read_register(BIT_MODE_64, cpu->registers, 2);
+    uint64_t length = read_register(BIT_MODE_64, cpu->registers, 3);
+    uint64_t result = SEMIHOST_FAILURE;
+    switch (call) {
+        case SEMIHOST_PUTCHAR: {
+            // The character is passed in x1
+            uint8_t byte = fd;
+            result = write_stream(&semihost->out, &byte, 1) == 0 ? 0 : SEMIHOST_FAILURE;
+            break;
+        }
+        case SEMIHOST_WRITE: {
+            SemihostStream *stream = fd == STDOUT_FD ? &semihost->out
+                : fd == STDERR_FD ? &semihost->err : NULL;
+            if (stream != NULL && in_bounds(address, length)
+                    && write_stream(stream, cpu->memory + address, length) == 0) {
+                result = length;
+            }
+            break;
+        }
+        case SEMIHOST_READ:
+            if (fd == STDIN_FD && in_bounds(address, length)) {
+                int64_t read = read_stream(semihost, cpu->memory + address, length);
+                result = read < 0 ? SEMIHOST_FAILURE : read;
+            }
+            break;
+        case SEMIHOST_EXIT:
+            // The PC is left at the call, as it is at the halt instruction
+            semihost->status = fd;
+            exit_emulator();
+    }
+    write_register(BIT_MODE_64, cpu->registers, 0, result);
+    increment_pc(cpu);
+    return 1;
+}
+
+int flush_semihost(Semihost *semihost) {
+    int out = flush_stream(&semihost->out);
+    int err = flush_stream(&semihost->err);
+    return out == 0 && err == 0 ? 0 : -1;
+}
+
+static void start_stream(SemihostStream *stream, int fd) {
+    stream->fd = fd;
+    stream->start = 0;
+    stream->length = 0;
+    stream->terminal = isatty(fd);
+}
+
+static int write_stream(SemihostStream *stream, const uint8_t *bytes, size_t length) {
+    if (stream->length + length > SEMIHOST_BUFFER_SIZE) {
+        if (flush_stream(stream) != 0) {
+            return -1;
+        }
+        if (length > SEMIHOST_BUFFER_SIZE) {
+            return write_all(stream->fd, bytes, length);
+        }
+    }
+    memcpy(stream->data + stream->length, bytes, length);
+    stream->length += length;
+    if (stream->terminal && memchr(bytes, '\n', length) != NULL) {
+        return flush_stream(stream);
+    }
+    return 0;
+}
+
+static int flush_stream(SemihostStream *stream) {
+    int result = write_all(stream->fd, stream->data, stream->length);
+    stream->length = 0;
+    return result;
+}
+
+static int write_all(int fd, const uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written <= 0) {
+            return -1;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return 0;
+}
+
+static int64_t read_stream(Semihost *semihost, uint8_t *bytes, size_t length) {
+    SemihostStream *stream = &semihost->in;
+    if (stream->start == stream->length) {
+        if (flush_semihost(semihost) != 0) {
+            return -1;
+        }
+        ssize_t read_length = read(stream->fd, stream->data, SEMIHOST_BUFFER_SIZE);
+        if (read_length < 0) {
+            return -1;
+        }
+        stream->start = 0;
+        stream->length = read_length;
+    }
+    size_t available = stream->length - stream->start;
+    size_t copied = length < available ? length : available;
+    memcpy(bytes, stream->data + stream->start, copied);
+    stream->start += copied;
+    return copied;
+}
+
+static bool in_bounds(uint64_t address, uint64_t length) {
+    return address <= MEMORY_SIZE && length <= MEMORY_SIZE - address;
+}
\ No newline at end of file
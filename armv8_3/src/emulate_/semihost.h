@@ -0,0 +1,91 @@
+#ifndef SEMIHOST_H
+#define SEMIHOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+/**
+ * Defines the semihosting interface, through which a guest run with
+ * --semihost asks the emulator for console I/O:
+ * The guest executes hlt #0xf000 (SEMIHOST_PATTERN) with the number of the
+ * call in x0 and its arguments in x1-x3, and the call returns its result in
+ * x0 (-1 for failure) and retires as a single instruction:
+ * SEMIHOST_PUTCHAR: Writes the low byte of x1 to stdout, returns 0
+ * SEMIHOST_WRITE:   Writes x3 bytes of memory at x2 to file descriptor x1
+ *                   (1: stdout, 2: stderr), returns the number written
+ * SEMIHOST_READ:    Reads up to x3 bytes from file descriptor x1 (0: stdin)
+ *                   to memory at x2, returns the number read (0 at the end of
+ *                   the input)
+ * SEMIHOST_EXIT:    Stops the guest (the PC is left at the call), and the
+ *                   emulator exits with the low byte of x1 as its status
+ * Output is held in buffers which are written in batches - when full, at the
+ * end of a line if the output is a terminal, before reading input, and when
+ * the guest stops - so a guest costs no host system call per character
+ * Without --semihost, a call is executed as a nop, like any undefined
+ * instruction. --semihost cannot be combined with reverse execution, whose
+ * replay could not repeat the calls
+ */
+typedef enum {
+    SEMIHOST_PUTCHAR = 1,
+    SEMIHOST_WRITE,
+    SEMIHOST_READ,
+    SEMIHOST_EXIT,
+} SemihostCall;
+
+// Size in bytes of each buffer of the semihosting streams
+#define SEMIHOST_BUFFER_SIZE 65536
+
+/**
+ * Represents a buffered stream of the semihosting interface:
+ * fd:       Host file descriptor of the stream
+ * data:     Buffered bytes (not yet written, or read but not yet consumed)
+ * start:    Offset of the first unconsumed byte of an input stream
+ * length:   Offset of the end of the buffered bytes
+ * terminal: If set, the stream is a terminal, so output is flushed at the
+ *           end of each line
+ */
+typedef struct {
+    int fd;
+    uint8_t data[SEMIHOST_BUFFER_SIZE];
+    size_t start;
+    size_t length;
+    bool terminal;
+} SemihostStream;
+
+/**
+ * Represents the state of the semihosting interface:
+ * in:     Guest stdin
+ * out:    Guest stdout
+ * err:    Guest stderr
+ * status: Exit status given by the guest (0 unless it exited)
+ */
+typedef struct Semihost {
+    SemihostStream in;
+    SemihostStream out;
+    SemihostStream err;
+    uint8_t status;
+} Semihost;
+
+/**
+ * Starts the semihosting interface, on the host stdin, stdout and stderr
+ */
+extern void start_semihost(Semihost *);
+
+/**
+ * Executes a semihosting call (see above), or a nop if semihosting is not
+ * enabled
+ * Returns the number of instructions retired
+ */
+extern int execute_semihost(MicroOp *, CPUState *);
+
+/**
+ * Writes the buffered output of the semihosting interface
+ * Returns 0 if success and -1 if any of it could not be written
+ */
+extern int flush_semihost(Semihost *);
+
+#endif
\ No newline at end of file
@@ -3,17 +3,31 @@
 
 #include "../common/utilities.h"
 #include "../common/instructions.h"
+#include "micro_op.h"
 
 /**
- * Decodes a 32-bit single data transfer instruction into an internal
- * representation
+ * Lowers a decoded single data transfer instruction at a given address into a
+ * micro-op with the handler specialised for its load/store type, addressing
+ * mode and bit width
  */
-extern void decode_single_data_transfer(uint32_t, Instr *);
+extern void lower_single_data_transfer(Instr *, uint64_t, MicroOp *);
 
 /**
- * Executes a decoded single data transfer instruction using a pointer to its
- * internal representation and updates the CPU state accordingly
+ * Returns the full guest address accessed by a decoded single data transfer
+ * instruction at the PC, from the registers before it executes (eg: to report
+ * an address of a memory fault which reached a guard area without its high
+ * bits - see HIGH_OFFSET_BIT)
  */
-extern void execute_single_data_transfer(Instr *, CPUState *);
+extern uint64_t get_transfer_address(Instr *, CPUState *);
+
+/**
+ * Declares the specialised SDT handlers execute_ldr_unsigned_32, ...,
+ * execute_str_post_64 and Load Literal handlers execute_ldr_literal_32 and
+ * execute_ldr_literal_64
+ */
+#define HANDLER(W, NAME, name) extern int execute_##name##_##W(MicroOp *, CPUState *);
+TRANSFER_OPS(TRANSFER_HANDLERS)
+FOR_EACH_WIDTH(HANDLER, LDR_LITERAL, ldr_literal)
+#undef HANDLER
 
 #endif
\ No newline at end of file
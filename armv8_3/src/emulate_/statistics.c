@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "statistics.h"
+#include "micro_op.h"
+
+void write_statistics(Statistics *stats, uint64_t retired, FILE *fp) {
+    uint64_t dispatches = 0;
+    for (int i = 0; i < NUM_HANDLERS; i++) {
+        dispatches += stats->dispatches[i];
+    }
+    fprintf(fp, "Instructions retired : %lu\n", retired);
+    fprintf(fp, "Dispatches           : %lu\n", dispatches);
+
+    // Writes the number of times each fused pair fired (retired both halves) -
+    // the fused pairs are the handlers between the branches and the idioms
+    fprintf(fp, "Fused pairs:\n");
+    for (int i = UOP_B_COND + 1; i < UOP_COPY_LOOP; i++) {
+        fprintf(fp, "  %-26s: %lu\n", get_handler_name(i),
+            stats->retired[i] - stats->dispatches[i]);
+    }
+
+    // Writes the number of times each idiom was dispatched and the instructions
+    // it retired
+    fprintf(fp, "Idioms:\n");
+    for (int i = UOP_COPY_LOOP; i < NUM_HANDLERS; i++) {
+        fprintf(fp, "  %-26s: %lu (%lu instructions)\n", get_handler_name(i),
+            stats->dispatches[i], stats->retired[i]);
+    }
+
+    // Writes the number of calls to the runtime page and the instructions
+    // they retired
+    fprintf(fp, "Runtime calls        : %lu (%lu instructions)\n",
+        stats->dispatches[UOP_RUNTIME], stats->retired[UOP_RUNTIME]);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "micro_op.h"
+
+/**
+ * Represents the execution statistics gathered in statistics mode:
+ * dispatches: Number of times the execution pipeline dispatched a micro-op,
+ *             per handler (a single instruction, fused pair or idiom)
+ * retired:    Number of instructions retired, per handler
+ */
+typedef struct Statistics {
+    uint64_t dispatches[NUM_HANDLERS];
+    uint64_t retired[NUM_HANDLERS];
+} Statistics;
+
+/**
+ * Writes execution statistics and the number of instructions retired to a
+ * file stream specified by a pointer
+ */
+extern void write_statistics(Statistics *, uint64_t, FILE *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "symbols.h"
+
+// Initial number of labels (and of source lines) a symbol map can hold
+#define INITIAL_SYMBOLS_CAPACITY 16
+// Delimiters between the fields of a record
+#define RECORD_DELIMITERS " \t\r\n"
+// Type of the record which holds the source path (the rest of its line)
+#define SOURCE_RECORD "source "
+
+/**
+ * Adds a label with a given address and name to a symbol map, given the
+ * number of labels it can hold, which is doubled when it is full
+ * Returns 0 if success and -1 if the map cannot be grown
+ */
+static int add_symbol(SymbolMap *, int *, uint64_t, char *);
+
+/**
+ * Adds the source line of the instruction at a given address to a symbol map,
+ * given the number of source lines it can hold, which is doubled when it is
+ * full
+ * Returns 0 if success and -1 if the map cannot be grown
+ */
+static int add_line(SymbolMap *, int *, uint64_t, int);
+
+/**
+ * Compares 2 labels by address, then by name (for qsort)
+ */
+static int compare_symbols(const void *, const void *);
+
+/**
+ * Compares 2 source lines by address (for qsort)
+ */
+static int compare_lines(const void *, const void *);
+
+int load_symbols(FILE *fp, SymbolMap *map) {
+    *map = (SymbolMap) { .symbols = NULL, .num_symbols = 0, .source = NULL, .lines = NULL, .num_lines = 0 };
+    int symbols_capacity = 0;
+    int lines_capacity = 0;
+
+    char *line = NULL;
+    size_t size = 0;
+    int result = 0;
+    while (result == 0 && getline(&line, &size, fp) != -1) {
+        // The path of a source record (source <path>) may contain spaces
+        if (strncmp(line, SOURCE_RECORD, strlen(SOURCE_RECORD)) == 0) {
+            char *path = line + strlen(SOURCE_RECORD);
+            path[strcspn(path, "\r\n")] = '\0';
+            free(map->source);
+            if ((map->source = malloc(strlen(path) + 1)) == NULL) {
+                result = -1;
+                break;
+            }
+            strcpy(map->source, path);
+            continue;
+        }
+
+        // Otherwise only label records (label <address> <name>) and line
+        // records (line <address> <source line>) are loaded
+        char *type = strtok(line, RECORD_DELIMITERS);
+        if (type == NULL || (strcmp(type, "label") != 0 && strcmp(type, "line") != 0)) {
+            continue;
+        }
+        char *address = strtok(NULL, RECORD_DELIMITERS);
+        char *field = strtok(NULL, RECORD_DELIMITERS);
+        char *end = NULL;
+        uint64_t value = address == NULL ? 0 : strtoull(address, &end, 0);
+        if (address == NULL || end == address || *end != '\0' || field == NULL) {
+            result = -1;
+            break;
+        }
+
+        if (strcmp(type, "label") == 0) {
+            result = add_symbol(map, &symbols_capacity, value, field);
+        } else {
+            long number = strtol(field, &end, 10);
+            if (end == field || *end != '\0' || number < 1 || number > INT32_MAX) {
+                result = -1;
+                break;
+            }
+            result = add_line(map, &lines_capacity, value, (int) number);
+        }
+    }
+    free(line);
+
+    if (result != 0) {
+        free_symbols(map);
+        return -1;
+    }
+    qsort(map->symbols, map->num_symbols, sizeof(Symbol), &compare_symbols);
+    qsort(map->lines, map->num_lines, sizeof(SourceLine), &compare_lines);
+    return 0;
+}
+
+int find_symbol(SymbolMap *map, uint64_t address) {
+    // Binary search for the last label at or below the address
+    int low = 0;
+    int high = map->num_symbols;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (map->symbols[middle].address <= address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low - 1;
+}
+
+void write_symbolic(SymbolMap *map, uint64_t address, FILE *fp) {
+    int index = map == NULL ? -1 : find_symbol(map, address);
+    if (index == -1) {
+        fprintf(fp, "0x%08lx", address);
+    } else if (map->symbols[index].address == address) {
+        fprintf(fp, "%s", map->symbols[index].name);
+    } else {
+        fprintf(fp, "%s+0x%lx", map->symbols[index].name, address - map->symbols[index].address);
+    }
+}
+
+void free_symbols(SymbolMap *map) {
+    for (int i = 0; i < map->num_symbols; i++) {
+        free(map->symbols[i].name);
+    }
+    free(map->symbols);
+    free(map->source);
+    free(map->lines);
+    *map = (SymbolMap) { .symbols = NULL, .num_symbols = 0, .source = NULL, .lines = NULL, .num_lines = 0 };
+}
+
+static int add_symbol(SymbolMap *map, int *capacity, uint64_t address, char *name) {
+    if (map->num_symbols == *capacity) {
+        int new_capacity = *capacity == 0 ? INITIAL_SYMBOLS_CAPACITY : 2 * *capacity;
+        Symbol *symbols = realloc(map->symbols, new_capacity * sizeof(Symbol));
+        if (symbols == NULL) {
+            return -1;
+        }
+        map->symbols = symbols;
+        *capacity = new_capacity;
+    }
+    char *copy = malloc(strlen(name) + 1);
+    if (copy == NULL) {
+        return -1;
+    }
+    strcpy(copy, name);
+    map->symbols[map->num_symbols++] = (Symbol) { .address = address, .name = copy };
+    return 0;
+}
+
+static int add_line(SymbolMap *map, int *capacity, uint64_t address, int line) {
+    if (map->num_lines == *capacity) {
+        int new_capacity = *capacity == 0 ? INITIAL_SYMBOLS_CAPACITY : 2 * *capacity;
+        SourceLine *lines = realloc(map->lines, new_capacity * sizeof(SourceLine));
+        if (lines == NULL) {
+            return -1;
+        }
+        map->lines = lines;
+        *capacity = new_capacity;
+    }
+    map->lines[map->num_lines++] = (SourceLine) { .address = address, .line = line };
+    return 0;
+}
+
+static int compare_symbols(const void *first, const void *second) {
+    const Symbol *symbol = first;
+    const Symbol *other = second;
+    if (symbol->address != other->address) {
+        return symbol->address < other->address ? -1 : 1;
+    }
+    return strcmp(symbol->name, other->name);
+}
+
+static int compare_lines(const void *first, const void *second) {
+    const SourceLine *line = first;
+    const SourceLine *other = second;
+    return line->address < other->address ? -1 : line->address > other->address;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Represents a label of the binary: its address and name
+ */
+typedef struct {
+    uint64_t address;
+    char *name;
+} Symbol;
+
+/**
+ * Represents the source line an instruction of the binary was assembled from:
+ * its address and line number
+ */
+typedef struct {
+    uint64_t address;
+    int line;
+} SourceLine;
+
+/**
+ * Represents the symbol map of a binary (written by the assembler with
+ * --map):
+ * symbols:     Its labels, sorted by address
+ * num_symbols: Number of labels
+ * source:      Path to the assembly source of the binary (NULL if not
+ *              recorded)
+ * lines:       Source line of each instruction, sorted by address
+ * num_lines:   Number of source lines
+ */
+typedef struct {
+    Symbol *symbols;
+    int num_symbols;
+    char *source;
+    SourceLine *lines;
+    int num_lines;
+} SymbolMap;
+
+/**
+ * Loads the labels, the source path and the source lines of a symbol map from
+ * a file stream, ignoring records of any other type
+ * Returns 0 if success and -1 if the map is invalid
+ */
+extern int load_symbols(FILE *, SymbolMap *);
+
+/**
+ * Returns the index of the nearest label at or below an address, or -1 if
+ * there is none
+ */
+extern int find_symbol(SymbolMap *, uint64_t);
+
+/**
+ * Writes an address to a file stream as the nearest label at or below it,
+ * with the offset from that label if any (eg: loop+0x8), or as a hexadecimal
+ * address if there is no such label
+ */
+extern void write_symbolic(SymbolMap *, uint64_t, FILE *);
+
+/**
+ * Frees the labels, the source path and the source lines of a symbol map
+ */
+extern void free_symbols(SymbolMap *);
+
+#endif
\ No newline at end of file
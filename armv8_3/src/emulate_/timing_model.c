@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "timing_model.h"
+#include "cache_model.h"
+#include "symbols.h"
+#include "micro_op.h"
+#include "../common/instructions.h"
+
+// Delimiter between the fields of a pipeline or predictor configuration
+#define CONFIG_DELIMITER ":"
+// Number of fields in a pipeline configuration, and at most in a predictor
+#define NUM_PIPELINE_FIELDS 3
+#define NUM_PREDICTOR_FIELDS 2
+// Maximum length of a configuration (which is split in a copy, so the option
+// argument can still be reported if it is invalid)
+#define MAX_CONFIG_LENGTH 64
+// Bounds of the log2 size of the predictor tables
+#define MIN_TABLE_BITS 1
+#define MAX_TABLE_BITS 24
+// Initial number of entries in the hash table of basic blocks (a power of 2)
+#define INITIAL_BLOCKS 256
+// A 2-bit counter predicts taken from this value upwards, up to its maximum
+#define COUNTER_TAKEN 2
+#define COUNTER_MAX 3
+// Multiplier of the hash of a block's start address (Fibonacci hashing)
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15
+
+/**
+ * Represents the class of an instruction, which sets the latency of its result
+ * and how it is predicted
+ */
+typedef enum {
+    TIMING_ALU,
+    TIMING_MULTIPLY,
+    TIMING_LOAD,
+    TIMING_STORE,
+    TIMING_BRANCH,
+    TIMING_BRANCH_REGISTER,
+    TIMING_BRANCH_CONDITIONAL,
+} TimingClass;
+
+/**
+ * Represents the registers which an instruction reads and writes
+ */
+#define READS_RD (1 << 0)
+#define READS_RN (1 << 1)
+#define READS_RM (1 << 2)
+#define READS_RA (1 << 3)
+#define WRITES_RD (1 << 4)
+#define WRITES_RN (1 << 5)
+
+/**
+ * Declares an entry of the timing table:
+ * type:      Class of the instruction
+ * registers: Registers it reads and writes (READS_* and WRITES_* bits)
+ */
+typedef struct {
+    TimingClass type;
+    int registers;
+} TimingEntry;
+
+/**
+ * Defines the static table of the timing of each handler, indexed by HandlerId
+ * (fused pairs and idioms are never formed in precise mode, so are left as
+ * ALU instructions which read and write no registers)
+ */
+#define TIMING(W, NAME, type, registers) [UOP_##NAME##_##W] = {type, registers},
+#define ARITHMETIC_IMM_TIMING(NAME, name, operator, flags) \
+    FOR_EACH_WIDTH(TIMING, NAME##_IMM, TIMING_ALU, READS_RN | WRITES_RD)
+#define WIDE_MOVE_TIMING(NAME, name, opc) \
+    FOR_EACH_WIDTH(TIMING, NAME, TIMING_ALU, (opc == MOVK_OPC ? READS_RD : 0) | WRITES_RD)
+#define SHIFT_TIMING(SHIFT, shift, NAME) \
+    FOR_EACH_WIDTH(TIMING, NAME##_##SHIFT, TIMING_ALU, READS_RN | READS_RM | WRITES_RD)
+#define ARITHMETIC_REG_TIMING(NAME, name, operator, flags) \
+    FOR_EACH_ARITHMETIC_SHIFT(SHIFT_TIMING, NAME)
+#define LOGICAL_REG_TIMING(NAME, name, operator, negate, set_flags) \
+    FOR_EACH_LOGICAL_SHIFT(SHIFT_TIMING, NAME)
+#define MULTIPLY_TIMING(NAME, name, operator) \
+    FOR_EACH_WIDTH(TIMING, NAME, TIMING_MULTIPLY, READS_RN | READS_RM | READS_RA | WRITES_RD)
+#define TRANSFER_TIMING(NAME, name, L, mode) \
+    FOR_EACH_WIDTH(TIMING, NAME, (L) ? TIMING_LOAD : TIMING_STORE, \
+        READS_RN | ((L) ? WRITES_RD : READS_RD) | (mode == REGISTER_OFFSET ? READS_RM : 0) \
+        | (mode == PRE_INDEX || mode == POST_INDEX ? WRITES_RN : 0))
+static const TimingEntry timingTable[NUM_HANDLERS] = {
+    ARITHMETIC_OPS(ARITHMETIC_IMM_TIMING)
+    WIDE_MOVE_OPS(WIDE_MOVE_TIMING)
+    ARITHMETIC_OPS(ARITHMETIC_REG_TIMING)
+    LOGICAL_OPS(LOGICAL_REG_TIMING)
+    MULTIPLY_OPS(MULTIPLY_TIMING)
+    TRANSFER_OPS(TRANSFER_TIMING)
+    FOR_EACH_WIDTH(TIMING, LDR_LITERAL, TIMING_LOAD, WRITES_RD)
+    [UOP_SEMIHOST] = {TIMING_ALU, WRITES_RD},
+    // A runtime call is modelled as its return, which writes x0
+    [UOP_RUNTIME] = {TIMING_BRANCH_REGISTER, WRITES_RD},
+    [UOP_B] = {TIMING_BRANCH, 0},
+    [UOP_BR] = {TIMING_BRANCH_REGISTER, READS_RN},
+    [UOP_B_COND] = {TIMING_BRANCH_CONDITIONAL, 0},
+};
+#undef TIMING
+#undef ARITHMETIC_IMM_TIMING
+#undef WIDE_MOVE_TIMING
+#undef SHIFT_TIMING
+#undef ARITHMETIC_REG_TIMING
+#undef LOGICAL_REG_TIMING
+#undef MULTIPLY_TIMING
+#undef TRANSFER_TIMING
+
+/**
+ * Declares a type PredictPtr representing a pointer to a predictor, which
+ * returns whether the conditional branch at a given PC to a given target is
+ * predicted to be taken
+ */
+typedef bool (*PredictPtr)(TimingModel *, uint64_t, uint64_t);
+
+/**
+ * Declares an entry of the predictor table:
+ * name:     Name of the predictor, as configured and reported
+ * func_ptr: Predicts the direction of a conditional branch
+ */
+typedef struct {
+    const char *name;
+    PredictPtr func_ptr;
+} PredictorEntry;
+
+/**
+ * Predicts that a conditional branch is taken if it branches backwards (a
+ * loop), and not taken otherwise
+ */
+static bool predict_static(TimingModel *, uint64_t, uint64_t);
+
+/**
+ * Predicts the direction of a conditional branch from its counter in the
+ * predictor table (see get_counter_index)
+ */
+static bool predict_counter(TimingModel *, uint64_t, uint64_t);
+
+/**
+ * Defines the static table of branch predictors, indexed by PredictorType
+ */
+static const PredictorEntry predictorTable[] = {
+    [PREDICT_STATIC] = {"static", &predict_static},
+    [PREDICT_BIMODAL] = {"bimodal", &predict_counter},
+    [PREDICT_GSHARE] = {"gshare", &predict_counter},
+};
+
+_Static_assert(sizeof(predictorTable) / sizeof(predictorTable[0]) == NUM_PREDICTORS,
+    "every predictor must have an entry in the predictor table");
+
+/**
+ * Returns the index of the counter of a conditional branch at a given PC in
+ * the predictor table (gshare mixes in the global history)
+ */
+static uint64_t get_counter_index(TimingModel *, uint64_t);
+
+/**
+ * Trains the predictor with the direction of the conditional branch at a
+ * given PC
+ */
+static void train_predictor(TimingModel *, uint64_t, bool);
+
+/**
+ * Returns the index of the basic block starting at a given address in the hash
+ * table, adding it (and growing the table) if it has not been entered yet
+ * Returns -1 if the table cannot be grown
+ */
+static int find_block(TimingModel *, uint64_t);
+
+/**
+ * Returns the slot of the hash table of a given capacity in which the basic
+ * block starting at a given address is, or would be, stored
+ */
+static int get_block_slot(BlockTiming *, int, uint64_t);
+
+/**
+ * Adds the timing of a basic block to the timing of another
+ */
+static void add_timing(BlockTiming *, BlockTiming *);
+
+/**
+ * Compares the timing of two basic blocks for qsort: more cycles first, then
+ * the lower start address
+ */
+static int compare_blocks(const void *, const void *);
+
+/**
+ * Writes the timing of a basic block to a file stream
+ */
+static void write_block(BlockTiming *, FILE *);
+
+void get_default_pipeline(PipelineConfig *config) {
+    *config = (PipelineConfig) {
+        .load_latency = 3,
+        .multiply_latency = 3,
+        .penalty = 8,
+        .predictor = PREDICT_BIMODAL,
+        .table_bits = 10,
+    };
+}
+
+int parse_pipeline_config(char *string, PipelineConfig *config) {
+    uint64_t *fields[NUM_PIPELINE_FIELDS] = {
+        &config->load_latency, &config->multiply_latency, &config->penalty,
+    };
+    uint64_t values[NUM_PIPELINE_FIELDS];
+    char copy[MAX_CONFIG_LENGTH + 1];
+    if (strlen(string) > MAX_CONFIG_LENGTH) {
+        return -1;
+    }
+    strcpy(copy, string);
+    int num_fields = 0;
+    for (char *field = strtok(copy, CONFIG_DELIMITER); field != NULL;
+            field = strtok(NULL, CONFIG_DELIMITER)) {
+        char *end;
+        if (num_fields == NUM_PIPELINE_FIELDS) {
+            return -1;
+        }
+        values[num_fields] = strtoull(field, &end, 10);
+        // Results take at least the cycle in which they are computed
+        if (end == field || *end != '\0' || (num_fields < 2 && values[num_fields] == 0)) {
+            return -1;
+        }
+        num_fields++;
+    }
+    if (num_fields != NUM_PIPELINE_FIELDS) {
+        return -1;
+    }
+    for (int i = 0; i < NUM_PIPELINE_FIELDS; i++) {
+        *fields[i] = values[i];
+    }
+    return 0;
+}
+
+int parse_predictor(char *string, PipelineConfig *config) {
+    char *fields[NUM_PREDICTOR_FIELDS];
+    char copy[MAX_CONFIG_LENGTH + 1];
+    if (strlen(string) > MAX_CONFIG_LENGTH) {
+        return -1;
+    }
+    strcpy(copy, string);
+    int num_fields = 0;
+    for (char *field = strtok(copy, CONFIG_DELIMITER); field != NULL;
+            field = strtok(NULL, CONFIG_DELIMITER)) {
+        if (num_fields == NUM_PREDICTOR_FIELDS) {
+            return -1;
+        }
+        fields[num_fields++] = field;
+    }
+    if (num_fields == 0) {
+        return -1;
+    }
+
+    int predictor = 0;
+    while (predictor < NUM_PREDICTORS && strcmp(fields[0], predictorTable[predictor].name) != 0) {
+        predictor++;
+    }
+    if (predictor == NUM_PREDICTORS) {
+        return -1;
+    }
+    int bits = config->table_bits;
+    if (num_fields > 1) {
+        char *end;
+        bits = strtol(fields[1], &end, 10);
+        if (end == fields[1] || *end != '\0' || bits < MIN_TABLE_BITS || bits > MAX_TABLE_BITS) {
+            return -1;
+        }
+    }
+    config->predictor = predictor;
+    config->table_bits = bits;
+    return 0;
+}
+
+int start_timing_model(TimingModel *model, PipelineConfig *config, struct CacheModel *caches,
+        SymbolMap *symbols) {
+    *model = (TimingModel) {
+        .config = *config,
+        .capacity = INITIAL_BLOCKS,
+        .block = -1,
+        .caches = caches,
+        .symbols = symbols,
+    };
+    // Weakly not taken, so a branch taken once is not yet predicted taken
+    uint64_t entries = (uint64_t) 1 << config->table_bits;
+    model->counters = malloc(entries);
+    model->targets = calloc(entries, sizeof(uint64_t));
+    model->blocks = calloc(INITIAL_BLOCKS, sizeof(BlockTiming));
+    if (model->counters == NULL || model->targets == NULL || model->blocks == NULL) {
+        stop_timing_model(model);
+        return -1;
+    }
+    memset(model->counters, COUNTER_TAKEN - 1, entries);
+    return 0;
+}
+
+void model_timing(TimingModel *model, MicroOp *op, uint64_t pc, uint64_t next_pc) {
+    // Enters a new basic block after a branch (or at the first instruction)
+    if (model->block == -1) {
+        model->block = find_block(model, pc);
+        if (model->block == -1) {
+            return;
+        }
+        model->blocks[model->block].runs++;
+    }
+    BlockTiming *block = &model->blocks[model->block];
+    const TimingEntry *entry = &timingTable[op->handler];
+    uint64_t start = model->cycle;
+
+    // Issues in the cycle after the last instruction, unless a register it
+    // reads is not ready yet (the zero register is always ready)
+    int reads[] = {
+        entry->registers & READS_RD ? op->rd : ZERO_REG_INDEX,
+        entry->registers & READS_RN ? op->rn : ZERO_REG_INDEX,
+        entry->registers & READS_RM ? op->rm : ZERO_REG_INDEX,
+        entry->registers & READS_RA ? op->aux : ZERO_REG_INDEX,
+    };
+    uint64_t issue = model->cycle + 1;
+    bool load_stall = false;
+    for (int i = 0; i < sizeof(reads) / sizeof(reads[0]); i++) {
+        if (reads[i] != ZERO_REG_INDEX && model->ready[reads[i]] > issue) {
+            issue = model->ready[reads[i]];
+            load_stall = model->loaded[reads[i]];
+        }
+    }
+    uint64_t stalls = issue - (model->cycle + 1);
+    block->load_stalls += load_stall ? stalls : 0;
+    block->multiply_stalls += load_stall ? 0 : stalls;
+    model->cycle = issue;
+
+    // Marks the registers it writes ready once its result is computed (the
+    // written-back base of a load or store is computed by the ALU)
+    if (entry->registers & WRITES_RN && op->rn != ZERO_REG_INDEX) {
+        model->ready[op->rn] = issue + 1;
+        model->loaded[op->rn] = false;
+    }
+    if (entry->registers & WRITES_RD && op->rd != ZERO_REG_INDEX) {
+        uint64_t latency = 1;
+        if (entry->type == TIMING_LOAD) {
+            latency = model->config.load_latency;
+        } else if (entry->type == TIMING_MULTIPLY) {
+            latency = model->config.multiply_latency;
+        }
+        model->ready[op->rd] = issue + latency;
+        model->loaded[op->rd] = entry->type == TIMING_LOAD;
+    }
+
+    // Predicts the direction of a conditional branch, and the target of br
+    // (b is always predicted, as its target is known when it is fetched)
+    bool mispredicted = false;
+    if (entry->type == TIMING_BRANCH_CONDITIONAL) {
+        bool taken = next_pc != pc + INSTR_BYTES;
+        mispredicted = predictorTable[model->config.predictor].func_ptr(model, pc, op->imm) != taken;
+        train_predictor(model, pc, taken);
+    } else if (entry->type == TIMING_BRANCH_REGISTER) {
+        uint64_t *target = &model->targets[(pc / INSTR_BYTES) & (((uint64_t) 1 << model->config.table_bits) - 1)];
+        mispredicted = *target != next_pc;
+        *target = next_pc;
+    }
+    if (entry->type == TIMING_BRANCH_CONDITIONAL || entry->type == TIMING_BRANCH_REGISTER) {
+        model->branches++;
+        model->mispredicts += mispredicted;
+        block->mispredicts += mispredicted;
+        model->cycle += mispredicted ? model->config.penalty : 0;
+    }
+
+    // Stalls the pipeline for the cache misses of its fetch and data access
+    if (model->caches != NULL) {
+        uint64_t cache_stalls = model->caches->total.stalls - model->cache_stalls;
+        model->cache_stalls = model->caches->total.stalls;
+        block->cache_stalls += cache_stalls;
+        model->cycle += cache_stalls;
+    }
+
+    block->end = pc;
+    block->instructions++;
+    block->cycles += model->cycle - start;
+    if (entry->type == TIMING_BRANCH || entry->type == TIMING_BRANCH_REGISTER
+            || entry->type == TIMING_BRANCH_CONDITIONAL) {
+        model->block = -1;
+    }
+}
+
+void write_timing_report(TimingModel *model, FILE *fp) {
+    // Gathers the basic blocks which were entered, hottest first
+    BlockTiming *blocks = malloc((model->num_blocks + 1) * sizeof(BlockTiming));
+    if (blocks == NULL) {
+        return;
+    }
+    int num_blocks = 0;
+    BlockTiming total = {0};
+    for (int i = 0; i < model->capacity; i++) {
+        if (model->blocks[i].runs > 0) {
+            blocks[num_blocks++] = model->blocks[i];
+            add_timing(&total, &model->blocks[i]);
+        }
+    }
+    qsort(blocks, num_blocks, sizeof(BlockTiming), &compare_blocks);
+
+    fprintf(fp, "Pipeline: %lu-cycle loads, %lu-cycle multiplies, %lu-cycle misprediction penalty, ",
+        model->config.load_latency, model->config.multiply_latency, model->config.penalty);
+    fprintf(fp, "%s", predictorTable[model->config.predictor].name);
+    if (model->config.predictor != PREDICT_STATIC) {
+        fprintf(fp, ":%d", model->config.table_bits);
+    }
+    fprintf(fp, "%s", " predictor\n");
+    fprintf(fp, "Estimated cycles: %lu (%lu instructions, CPI %.2f)\n", total.cycles,
+        total.instructions,
+        total.instructions == 0 ? 0.0 : (double) total.cycles / total.instructions);
+    fprintf(fp, "Branches: %lu predicted, %lu mispredicted (%.2f%%)\n", model->branches, model->mispredicts,
+        model->branches == 0 ? 0.0 : 100.0 * model->mispredicts / model->branches);
+    fprintf(fp, "%12s %10s %12s %6s %10s %10s %11s %10s  %s\n", "Cycles", "Runs", "Instrs", "CPI",
+        "Load-use", "Multiply", "Mispredicts", "Cache", "Block");
+    for (int i = 0; i < num_blocks; i++) {
+        write_block(&blocks[i], fp);
+        write_symbolic(model->symbols, blocks[i].start, fp);
+        fprintf(fp, "%s", "..");
+        write_symbolic(model->symbols, blocks[i].end, fp);
+        fprintf(fp, "%s", "\n");
+    }
+    write_block(&total, fp);
+    fprintf(fp, "%s", "(total)\n");
+    free(blocks);
+}
+
+void stop_timing_model(TimingModel *model) {
+    free(model->counters);
+    free(model->targets);
+    free(model->blocks);
+}
+
+static bool predict_static(TimingModel *model, uint64_t pc, uint64_t target) {
+    return target <= pc;
+}
+
+static bool predict_counter(TimingModel *model, uint64_t pc, uint64_t target) {
+    return model->counters[get_counter_index(model, pc)] >= COUNTER_TAKEN;
+}
+
+static uint64_t get_counter_index(TimingModel *model, uint64_t pc) {
+    uint64_t index = pc / INSTR_BYTES;
+    if (model->config.predictor == PREDICT_GSHARE) {
+        index ^= model->history;
+    }
+    return index & (((uint64_t) 1 << model->config.table_bits) - 1);
+}
+
+static void train_predictor(TimingModel *model, uint64_t pc, bool taken) {
+    uint8_t *counter = &model->counters[get_counter_index(model, pc)];
+    if (taken && *counter < COUNTER_MAX) {
+        (*counter)++;
+    } else if (!taken && *counter > 0) {
+        (*counter)--;
+    }
+    model->history = (model->history << 1 | taken) & (((uint64_t) 1 << model->config.table_bits) - 1);
+}
+
+static int find_block(TimingModel *model, uint64_t start) {
+    int slot = get_block_slot(model->blocks, model->capacity, start);
+    if (model->blocks[slot].runs > 0) {
+        return slot;
+    }
+
+    // Keeps the table at most half full, rehashing every block into a table of
+    // twice the capacity
+    if (2 * (model->num_blocks + 1) > model->capacity) {
+        int capacity = 2 * model->capacity;
+        BlockTiming *blocks = calloc(capacity, sizeof(BlockTiming));
+        if (blocks == NULL) {
+            return -1;
+        }
+        for (int i = 0; i < model->capacity; i++) {
+            if (model->blocks[i].runs > 0) {
+                blocks[get_block_slot(blocks, capacity, model->blocks[i].start)] = model->blocks[i];
+            }
+        }
+        free(model->blocks);
+        model->blocks = blocks;
+        model->capacity = capacity;
+        slot = get_block_slot(blocks, capacity, start);
+    }
+    model->blocks[slot] = (BlockTiming) { .start = start, .end = start };
+    model->num_blocks++;
+    return slot;
+}
+
+static int get_block_slot(BlockTiming *blocks, int capacity, uint64_t start) {
+    // Linear probing from the hashed slot, until the block or an unused entry
+    int slot = (start * HASH_MULTIPLIER >> 32) & (capacity - 1);
+    while (blocks[slot].runs > 0 && blocks[slot].start != start) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+static void add_timing(BlockTiming *total, BlockTiming *block) {
+    total->runs += block->runs;
+    total->instructions += block->instructions;
+    total->cycles += block->cycles;
+    total->load_stalls += block->load_stalls;
+    total->multiply_stalls += block->multiply_stalls;
+    total->mispredicts += block->mispredicts;
+    total->cache_stalls += block->cache_stalls;
+}
+
+static int compare_blocks(const void *first, const void *second) {
+    const BlockTiming *block = first;
+    const BlockTiming *other = second;
+    if (block->cycles != other->cycles) {
+        return block->cycles > other->cycles ? -1 : 1;
+    }
+    return block->start < other->start ? -1 : block->start > other->start;
+}
+
+static void write_block(BlockTiming *block, FILE *fp) {
+    fprintf(fp, "%12lu %10lu %12lu %6.2f %10lu %10lu %11lu %10lu  ", block->cycles, block->runs,
+        block->instructions, block->instructions == 0 ? 0.0 : (double) block->cycles / block->instructions,
+        block->load_stalls, block->multiply_stalls, block->mispredicts, block->cache_stalls);
+}
\ No newline at end of file
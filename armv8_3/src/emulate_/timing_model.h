@@ -0,0 +1,161 @@
+#ifndef TIMING_MODEL_H
+#define TIMING_MODEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+#include "symbols.h"
+
+/**
+ * Represents the predictors which guess the direction of conditional branches
+ * static:  Backward branches are taken, forward branches are not
+ * bimodal: A 2-bit saturating counter per branch address
+ * gshare:  A 2-bit saturating counter per branch address XOR the global
+ *          history of branch directions
+ */
+typedef enum {
+    PREDICT_STATIC,
+    PREDICT_BIMODAL,
+    PREDICT_GSHARE,
+    NUM_PREDICTORS,
+} PredictorType;
+
+/**
+ * Represents the configuration of the modelled in-order pipeline:
+ * load_latency:     Cycles from the issue of a load until its value can be
+ *                   used (a dependent instruction issued sooner stalls)
+ * multiply_latency: Cycles from the issue of madd/msub until its result can be
+ *                   used
+ * penalty:          Cycles lost when a branch is mispredicted (the depth of
+ *                   the front end which is flushed)
+ * predictor:        Predictor of conditional branch directions
+ * table_bits:       Log2 of the number of entries in the predictor's counter
+ *                   table, and in the target buffer which predicts br
+ */
+typedef struct {
+    uint64_t load_latency;
+    uint64_t multiply_latency;
+    uint64_t penalty;
+    PredictorType predictor;
+    int table_bits;
+} PipelineConfig;
+
+/**
+ * Represents the timing of a basic block (a run of instructions entered at its
+ * first instruction, and ended by a branch):
+ * start:             Address of its first instruction
+ * end:               Address of its last instruction executed
+ * runs:              Number of times it was entered (0 if the entry is unused)
+ * instructions:      Number of instructions it retired
+ * cycles:            Estimated cycles it took
+ * load_stalls:       Cycles stalled waiting for a loaded value
+ * multiply_stalls:   Cycles stalled waiting for a multiply result
+ * mispredicts:       Number of its branches which were mispredicted
+ * cache_stalls:      Cycles stalled on simulated cache misses
+ */
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t runs;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t load_stalls;
+    uint64_t multiply_stalls;
+    uint64_t mispredicts;
+    uint64_t cache_stalls;
+} BlockTiming;
+
+/**
+ * Represents the timing model of a single-issue in-order pipeline, which every
+ * executed instruction is passed through:
+ * config:       Configuration
+ * cycle:        Cycle at which the last instruction issued
+ * ready:        Cycle at which the value of each register can be used
+ * loaded:       Set for each register whose value was last written by a load
+ *               (otherwise by a multiply, if it was ready late)
+ * counters:     2-bit saturating counters of the predictor
+ * history:      Global history of conditional branch directions (gshare)
+ * targets:      Last target of each br, indexed by its address
+ * blocks:       Hash table of the timing of each basic block, by its start
+ * capacity:     Number of entries in the hash table (a power of 2)
+ * num_blocks:   Number of basic blocks entered
+ * block:        Index of the basic block being executed, or -1 if the next
+ *               instruction starts a new block
+ * caches:       Simulated cache hierarchy, whose stalls are added to the
+ *               pipeline (NULL if none)
+ * cache_stalls: Stall cycles of the cache hierarchy counted so far
+ * symbols:      Symbol map by which basic blocks are reported (NULL if none)
+ * branches:     Number of conditional branches and br executed
+ * mispredicts:  Number of those which were mispredicted
+ */
+typedef struct TimingModel {
+    PipelineConfig config;
+    uint64_t cycle;
+    uint64_t ready[NUM_GENERAL_REGISTERS];
+    bool loaded[NUM_GENERAL_REGISTERS];
+    uint8_t *counters;
+    uint64_t history;
+    uint64_t *targets;
+    BlockTiming *blocks;
+    int capacity;
+    int num_blocks;
+    int block;
+    struct CacheModel *caches;
+    uint64_t cache_stalls;
+    SymbolMap *symbols;
+    uint64_t branches;
+    uint64_t mispredicts;
+} TimingModel;
+
+/**
+ * Sets the default configuration of the pipeline, modelled on a short
+ * in-order core: 3-cycle loads and multiplies, an 8-cycle misprediction
+ * penalty and a bimodal predictor with 1024 counters
+ */
+extern void get_default_pipeline(PipelineConfig *);
+
+/**
+ * Parses the latencies of the pipeline, LOAD:MULTIPLY:PENALTY (eg: 2:4:12),
+ * into its configuration
+ * Returns 0 if success and -1 if the latencies are invalid
+ */
+extern int parse_pipeline_config(char *, PipelineConfig *);
+
+/**
+ * Parses the branch predictor of the pipeline, NAME[:BITS] (eg: gshare:12),
+ * into its configuration - NAME is static, bimodal or gshare
+ * Returns 0 if success and -1 if the predictor is invalid
+ */
+extern int parse_predictor(char *, PipelineConfig *);
+
+/**
+ * Starts modelling an empty pipeline with a configuration, the simulated
+ * cache hierarchy whose stalls it adds (or NULL) and a symbol map (or NULL)
+ * Returns 0 if success and -1 if allocation fails
+ */
+extern int start_timing_model(TimingModel *, PipelineConfig *, struct CacheModel *, SymbolMap *);
+
+/**
+ * Passes an instruction, executed as a micro-op at a given PC and leaving the
+ * PC at a given address, through the pipeline: it issues once the registers
+ * it reads are ready, and a branch whose direction (or br whose target) was
+ * mispredicted costs the misprediction penalty
+ * Pre: the micro-op is a single instruction (the CPU runs in precise mode)
+ */
+extern void model_timing(TimingModel *, MicroOp *, uint64_t, uint64_t);
+
+/**
+ * Writes the estimated cycles, stalls and branch prediction accuracy overall
+ * and of each basic block (hottest first) to a file stream
+ */
+extern void write_timing_report(TimingModel *, FILE *);
+
+/**
+ * Stops modelling a pipeline, freeing it
+ */
+extern void stop_timing_model(TimingModel *);
+
+#endif
\ No newline at end of file
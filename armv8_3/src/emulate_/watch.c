@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "watch.h"
+#include "micro_op.h"
+#include "../common/utilities.h"
+
+// Separates the fields of a watchpoint
+#define WATCH_SEPARATOR ':'
+
+/**
+ * Sets the protection of a page, recording it as its current protection
+ */
+static void protect_page(WatchList *, int, int);
+
+/**
+ * Restores the armed protection of every page which has been unprotected
+ */
+static void rearm_pages(WatchList *);
+
+/**
+ * Records an access to a watched page during the current instruction
+ */
+static void record_hit(WatchList *, WatchType, uint64_t);
+
+/**
+ * Returns true if an access of a given type to a range of guest memory
+ * (address, length in bytes) overlaps a watchpoint of that type
+ */
+static bool is_watched(WatchList *, WatchType, uint64_t, uint64_t);
+
+/**
+ * Returns the name of a type of access
+ */
+static const char *get_type_name(WatchType);
+
+int parse_watchpoint(char *string, WatchPoint *watchpoint) {
+    WatchPoint point = { .length = DEFAULT_WATCH_LENGTH, .type = WATCH_WRITE };
+
+    // ADDR (decimal, or hexadecimal with a 0x prefix)
+    char *end;
+    point.address = strtoull(string, &end, 0);
+    if (end == string) {
+        return -1;
+    }
+    // :LEN
+    if (end[0] == WATCH_SEPARATOR && end[1] != 'r' && end[1] != 'w') {
+        char *length = end + 1;
+        point.length = strtoull(length, &end, 0);
+        if (end == length) {
+            return -1;
+        }
+    }
+    // :r or :w
+    if (end[0] == WATCH_SEPARATOR && (end[1] == 'r' || end[1] == 'w')) {
+        point.type = end[1] == 'r' ? WATCH_READ : WATCH_WRITE;
+        end += 2;
+    }
+    if (end[0] != '\0' || point.length == 0 || point.address >= MEMORY_SIZE
+            || point.length > MEMORY_SIZE - point.address) {
+        return -1;
+    }
+
+    *watchpoint = point;
+    return 0;
+}
+
+int arm_watchpoints(WatchList *watches, uint8_t *memory) {
+    watches->memory = memory;
+    watches->page_size = sysconf(_SC_PAGESIZE);
+    if (watches->page_size <= 0 || MEMORY_SIZE / watches->page_size > MAX_WATCH_PAGES) {
+        return -1;
+    }
+
+    // Every page starts accessible, and is restricted by each watchpoint on it
+    int num_pages = MEMORY_SIZE / watches->page_size;
+    for (int page = 0; page < num_pages; page++) {
+        watches->armed[page] = PROT_READ | PROT_WRITE;
+        watches->current[page] = PROT_READ | PROT_WRITE;
+    }
+    for (int i = 0; i < watches->num_points; i++) {
+        WatchPoint *point = &watches->points[i];
+        int first = point->address / watches->page_size;
+        int last = (point->address + point->length - 1) / watches->page_size;
+        for (int page = first; page <= last; page++) {
+            watches->armed[page] &= point->type == WATCH_READ ? PROT_NONE : PROT_READ;
+        }
+    }
+
+    for (int page = 0; page < num_pages; page++) {
+        if (watches->armed[page] != watches->current[page]) {
+            uint8_t *start = memory + page * watches->page_size;
+            if (mprotect(start, watches->page_size, watches->armed[page]) != 0) {
+                return -1;
+            }
+            watches->current[page] = watches->armed[page];
+        }
+    }
+    watches->touched = false;
+    watches->probing = false;
+    watches->num_hits = 0;
+    watches->stopped = false;
+    watches->hit_count = 0;
+    return 0;
+}
+
+void disarm_watchpoints(WatchList *watches) {
+    int num_pages = MEMORY_SIZE / watches->page_size;
+    for (int page = 0; page < num_pages; page++) {
+        watches->armed[page] = PROT_READ | PROT_WRITE;
+    }
+    watches->touched = true;
+    rearm_pages(watches);
+    watches->memory = NULL;
+}
+
+bool handle_watch_fault(WatchList *watches, void *host) {
+    uint8_t *byte = host;
+    if (watches->memory == NULL || byte < watches->memory || byte >= watches->memory + MEMORY_SIZE) {
+        return false;
+    }
+    uint64_t address = byte - watches->memory;
+    int page = address / watches->page_size;
+
+    switch (watches->current[page]) {
+        case PROT_NONE:
+            // A read or a write - allows reads only, so that a write faults
+            // again (otherwise the access was a read)
+            watches->probing = true;
+            watches->probe = address;
+            protect_page(watches, page, PROT_READ);
+            return true;
+        case PROT_READ:
+            // A write
+            watches->probing = false;
+            record_hit(watches, WATCH_WRITE, address);
+            protect_page(watches, page, PROT_READ | PROT_WRITE);
+            return true;
+        default:
+            // The page is not protected, so the fault is not a watch hit
+            return false;
+    }
+}
+
+int execute_watched(MicroOp *op, CPUState *cpu) {
+    WatchList *watches = cpu->watches;
+
+    // Fetching and decoding may have unprotected pages, which are re-armed so
+    // that only the accesses of the instruction itself are reported
+    rearm_pages(watches);
+    watches->probing = false;
+    watches->num_hits = 0;
+
+    uint64_t pc = cpu->pc;
+    int retired = execute_micro_op(op, cpu);
+
+    // A fault on a no-access page which did not fault again was a read
+    if (watches->probing) {
+        watches->probing = false;
+        record_hit(watches, WATCH_READ, watches->probe);
+    }
+
+    // Reports each hit on a watchpoint of its type (the access is at most a
+    // register wide, so it may start before the watched range)
+    int bytes = (op->sf == BIT_MODE_32 ? BIT_SIZE_32 : BIT_SIZE_64) / CHAR_BIT;
+    bool hit_any = false;
+    for (int i = 0; i < watches->num_hits; i++) {
+        WatchHit *hit = &watches->hits[i];
+        // A range access may also have faulted at a byte it recorded itself
+        bool reported = false;
+        for (int j = 0; j < i; j++) {
+            reported = reported || (watches->hits[j].type == hit->type && watches->hits[j].address == hit->address);
+        }
+        if (!reported && is_watched(watches, hit->type, hit->address, bytes)) {
+            if (!watches->quiet) {
+                fprintf(stderr, "Watchpoint hit: %s at 0x%lx by instruction at PC = 0x%lx\n",
+                    get_type_name(hit->type), hit->address, pc);
+            }
+            hit_any = true;
+        }
+    }
+    if (hit_any) {
+        watches->hit_count++;
+        watches->last_index = cpu->retired;
+        watches->last_pc = pc;
+        watches->stopped = watches->stop;
+    }
+
+    rearm_pages(watches);
+    return retired;
+}
+
+void record_range(WatchList *watches, WatchType type, uint64_t address, uint64_t length) {
+    for (int i = 0; i < watches->num_points; i++) {
+        WatchPoint *point = &watches->points[i];
+        if (point->type == type && address < point->address + point->length
+                && point->address < address + length) {
+            record_hit(watches, type, address > point->address ? address : point->address);
+        }
+    }
+}
+
+static void protect_page(WatchList *watches, int page, int protection) {
+    mprotect(watches->memory + page * watches->page_size, watches->page_size, protection);
+    watches->current[page] = protection;
+    watches->touched = true;
+}
+
+static void rearm_pages(WatchList *watches) {
+    if (!watches->touched) {
+        return;
+    }
+    int num_pages = MEMORY_SIZE / watches->page_size;
+    for (int page = 0; page < num_pages; page++) {
+        if (watches->current[page] != watches->armed[page]) {
+            protect_page(watches, page, watches->armed[page]);
+        }
+    }
+    watches->touched = false;
+}
+
+static void record_hit(WatchList *watches, WatchType type, uint64_t address) {
+    if (watches->num_hits < MAX_WATCH_HITS) {
+        WatchHit hit = { .type = type, .address = address };
+        watches->hits[watches->num_hits++] = hit;
+    }
+}
+
+static bool is_watched(WatchList *watches, WatchType type, uint64_t address, uint64_t length) {
+    for (int i = 0; i < watches->num_points; i++) {
+        WatchPoint *point = &watches->points[i];
+        if (point->type == type && address < point->address + point->length
+                && point->address < address + length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *get_type_name(WatchType type) {
+    return type == WATCH_READ ? "read" : "write";
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/utilities.h"
+#include "micro_op.h"
+
+// Maximum number of watchpoints which can be set
+#define MAX_WATCHPOINTS 16
+// Maximum number of guest memory pages (of the smallest host page size, 4KB)
+#define MAX_WATCH_PAGES (MEMORY_SIZE / 4096)
+// Maximum number of hits recorded during a single instruction
+#define MAX_WATCH_HITS 4
+// Length in bytes of a watchpoint if none is given (a word)
+#define DEFAULT_WATCH_LENGTH 4
+
+/**
+ * Represents the 2 types of memory access which can be watched
+ */
+typedef enum {
+    WATCH_READ,
+    WATCH_WRITE,
+} WatchType;
+
+/**
+ * Represents a watchpoint: a range of guest memory (address, length in bytes)
+ * and the type of access to it which is reported
+ */
+typedef struct {
+    uint64_t address;
+    uint64_t length;
+    WatchType type;
+} WatchPoint;
+
+/**
+ * Represents an access to a watched page, recorded by the SIGSEGV handler:
+ * type:    Read or write
+ * address: Guest address of the first byte accessed in the page
+ */
+typedef struct {
+    WatchType type;
+    uint64_t address;
+} WatchHit;
+
+/**
+ * Represents the watchpoints of the emulator and the state of the guest
+ * memory pages which back them:
+ * points:     The watchpoints, in the order they were given
+ * stop:       If set, execution stops after the first instruction which hits
+ * stopped:    Set when execution should stop
+ * memory:     Guest memory (NULL unless armed)
+ * page_size:  Host page size in bytes
+ * armed:      Protection of each page while armed - no access for pages with
+ *             a read watchpoint, read-only for pages with a write watchpoint
+ * current:    Current protection of each page
+ * touched:    Set if a page has been unprotected since it was last armed
+ * probing:    Set if a fault on a no-access page is awaiting a second fault,
+ *             which would make it a write rather than a read
+ * probe:      Guest address of that fault
+ * hits:       Accesses to watched pages during the current instruction
+ * quiet:      If set, hits are counted but not written to stderr
+ * hit_count:  Number of instructions which have hit a watchpoint since armed
+ * last_index: Index (number of instructions retired before it) and PC of the
+ * last_pc:    last instruction which hit a watchpoint
+ */
+typedef struct WatchList {
+    WatchPoint points[MAX_WATCHPOINTS];
+    int num_points;
+    bool stop;
+    bool stopped;
+    uint8_t *memory;
+    long page_size;
+    int armed[MAX_WATCH_PAGES];
+    int current[MAX_WATCH_PAGES];
+    volatile bool touched;
+    volatile bool probing;
+    volatile uint64_t probe;
+    WatchHit hits[MAX_WATCH_HITS];
+    volatile int num_hits;
+    bool quiet;
+    uint64_t hit_count;
+    uint64_t last_index;
+    uint64_t last_pc;
+} WatchList;
+
+/**
+ * Parses a watchpoint of the form ADDR[:LEN][:r|w] (LEN defaults to a word, and
+ * the type to w)
+ * Returns 0 if success and -1 if the watchpoint is invalid
+ */
+extern int parse_watchpoint(char *, WatchPoint *);
+
+/**
+ * Protects the host pages which back watched guest memory, so that accesses to
+ * them raise SIGSEGV - accesses to every other page run at full speed
+ * Returns 0 if success and -1 otherwise
+ */
+extern int arm_watchpoints(WatchList *, uint8_t *);
+
+/**
+ * Removes the protection of every watched page
+ */
+extern void disarm_watchpoints(WatchList *);
+
+/**
+ * Handles SIGSEGV on a host address: if it lies in a protected page of guest
+ * memory, records the access, unprotects the page (enough for the access to
+ * be retried) and returns true, otherwise returns false
+ */
+extern bool handle_watch_fault(WatchList *, void *);
+
+/**
+ * Executes a micro-op while watchpoints are armed: records (and unless quiet,
+ * writes a line to stderr for) each watchpoint it hits, then re-arms any page
+ * it unprotected
+ * Returns the number of instructions retired
+ */
+extern int execute_watched(MicroOp *, CPUState *);
+
+/**
+ * Records an access of a given type to a range of guest memory (address,
+ * length in bytes) by a micro-op which accesses more than a register at once
+ * (eg: a runtime call), as a hit at the first byte of each watchpoint of that
+ * type which it overlaps - a page fault only records the first byte accessed
+ * in each page
+ */
+extern void record_range(WatchList *, WatchType, uint64_t, uint64_t);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "../emulate_/scheduler.h"
+
+// Expected positional argument: path of the Unix socket
+#define NUM_POSITIONAL_ARGUMENTS 1
+
+/**
+ * Represents the identifiers of the long-only options
+ */
+enum {
+    WORKERS_OPTION = 256,
+    QUANTUM_OPTION,
+    CONNECTIONS_OPTION,
+};
+
+/**
+ * Defines the long options accepted by the server
+ */
+static struct option longOptions[] = {
+    {"workers", required_argument, NULL, WORKERS_OPTION},
+    {"quantum", required_argument, NULL, QUANTUM_OPTION},
+    {"connections", required_argument, NULL, CONNECTIONS_OPTION},
+    {NULL, 0, NULL, 0},
+};
+
+/**
+ * The entry point of the emulation server program.
+ * Accepts jobs (a binary, its initial state and an instruction limit) on a
+ * Unix socket, and time-slices them across a pool of worker threads, on
+ * emulators which are initialised once, so that each job costs no process
+ * startup or allocation, and short jobs are not held up behind long ones.
+ * Replies to each job with the final state of the emulator, or its digest.
+ * Runs until it receives SIGINT or SIGTERM.
+ */
+int main(int argc, char **argv) {
+    // A worker thread for each online processor, unless given by --workers
+    ServerConfig config = {
+        .num_workers = sysconf(_SC_NPROCESSORS_ONLN),
+        .quantum = DEFAULT_QUANTUM,
+        .max_connections = DEFAULT_CONNECTIONS,
+    };
+    if (config.num_workers < 1) {
+        config.num_workers = 1;
+    }
+
+    // Parses the options - any option other than --workers, --quantum or
+    // --connections is invalid
+    bool valid = true;
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        char *end;
+        if (option == WORKERS_OPTION) {
+            long workers = strtol(optarg, &end, 10);
+            valid = valid && end != optarg && *end == '\0' && workers > 0 && workers <= INT_MAX;
+            config.num_workers = workers;
+        } else if (option == QUANTUM_OPTION) {
+            config.quantum = strtoull(optarg, &end, 0);
+            valid = valid && end != optarg && *end == '\0' && config.quantum > 0;
+        } else if (option == CONNECTIONS_OPTION) {
+            long connections = strtol(optarg, &end, 10);
+            valid = valid && end != optarg && *end == '\0' && connections > 0 && connections <= INT_MAX;
+            config.max_connections = connections;
+        } else {
+            valid = false;
+        }
+    }
+
+    // Exits the program if the options or argument count are invalid
+    if (!valid || argc - optind != NUM_POSITIONAL_ARGUMENTS) {
+        fprintf(stderr, "%s\n", "Usage: ./emulated [--workers N] [--quantum N] [--connections N] <socket_path>");
+        return EXIT_FAILURE;
+    }
+    config.socket_path = argv[optind];
+
+    if (run_server(&config) != 0) {
+        perror("Server could not be started");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
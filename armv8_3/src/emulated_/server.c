@@ -0,0 +1,525 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "../common/utilities.h"
+#include "../emulate_/emulator.h"
+#include "../emulate_/binary_loader.h"
+#include "../emulate_/digest.h"
+#include "../emulate_/seed.h"
+#include "../emulate_/scheduler.h"
+
+// Maximum size of a binary image sent in a job (a segmented image holds its
+// headers as well as the contents of memory)
+#define MAX_IMAGE_SIZE (2 * MEMORY_SIZE)
+// Delimiters between the fields of the header of a job
+#define HEADER_DELIMITERS " \t\r\n"
+// Number of required and optional fields in the header of a job
+#define NUM_REQUIRED_FIELDS 3
+#define NUM_HEADER_FIELDS 5
+// Number of nanoseconds in a millisecond
+#define NANOSECONDS_PER_MILLISECOND 1000000
+
+/**
+ * Represents an emulator on which jobs run, with the running digest of its
+ * memory, which is started again for each job whose final state is digested
+ */
+typedef struct {
+    CPUState cpu;
+    MemoryDigest digest;
+} Emulator;
+
+/**
+ * Represents the state of the server:
+ * scheduler:   Scheduler which runs the guest of every job
+ * listener:    Listening socket
+ * connections: Number of further connections which may be served at once
+ * lock:        Guards the pool of emulators
+ * pool:        Idle emulators, which have each been initialised
+ * num_pooled:  Number of idle emulators
+ * capacity:    Maximum number of idle emulators (one for each worker thread)
+ */
+typedef struct {
+    Scheduler scheduler;
+    int listener;
+    sem_t connections;
+    pthread_mutex_t lock;
+    Emulator **pool;
+    int num_pooled;
+    int capacity;
+} Server;
+
+/**
+ * Represents an accepted connection, served by its own thread
+ */
+typedef struct {
+    Server *server;
+    int connection;
+} Connection;
+
+/**
+ * Represents a job sent to the server:
+ * image_size: Size of the binary image in bytes
+ * limit:      Maximum number of instructions retired (NO_LIMIT if none)
+ * digest:     If set, replies with the digest of the final state instead of
+ *             the final state itself
+ * priority:   Priority of the guest
+ * deadline:   Deadline of the guest (NO_DEADLINE if none)
+ * seed:       Seed applied to the initial state (see apply_seed)
+ * image:      Binary image
+ */
+typedef struct {
+    uint64_t image_size;
+    uint64_t limit;
+    bool digest;
+    int priority;
+    uint64_t deadline;
+    char *seed;
+    uint8_t *image;
+} Job;
+
+/**
+ * Represents the completion of the guest of a job, which the thread serving
+ * its connection waits for
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    bool finished;
+} Completion;
+
+/**
+ * Names of the reasons for which a job stops, as sent in its reply
+ */
+static const char *reasonNames[] = {
+    [STOP_HALT] = "halt",
+    [STOP_MEMORY_FAULT] = "fault",
+    [STOP_LIMIT] = "limit",
+};
+
+/**
+ * Accepts connections until the listening socket is shut down, serving each
+ * on its own (detached) thread - waits for a connection to close before
+ * accepting another while the maximum number are being served
+ */
+static void *accept_connections(void *);
+
+/**
+ * Runs the jobs sent on a connection in turn, replying to each, until the
+ * client closes it or a job is invalid
+ */
+static void *serve_connection(void *);
+
+/**
+ * Reads the next job sent on a connection
+ * Returns 1 if a job was read, 0 if the connection was closed before the next
+ * job, and -1 if the job is invalid (setting the reason)
+ */
+static int read_job(FILE *, Job *, const char **);
+
+/**
+ * Runs a job on an emulator from the pool, and writes its reply to a
+ * connection
+ * Returns 0 if success and -1 if the job is invalid (setting the reason) or
+ * the reply could not be written
+ */
+static int run_job(Server *, Job *, FILE *, const char **);
+
+/**
+ * Signals the completion of the guest of a job (called by the scheduler)
+ */
+static void finish_job(Guest *);
+
+/**
+ * Initialises a new emulator
+ * Returns a pointer to the emulator, or NULL if it could not be initialised
+ */
+static Emulator *new_emulator(void);
+
+/**
+ * Takes an idle emulator from the pool, or initialises a new one if none is
+ * idle, and resets it
+ * Returns a pointer to the emulator, or NULL if none could be initialised
+ */
+static Emulator *take_emulator(Server *);
+
+/**
+ * Returns an emulator to the pool (freeing it if the pool is full)
+ */
+static void return_emulator(Server *, Emulator *);
+
+/**
+ * Frees an emulator, with its guest memory
+ */
+static void discard_emulator(Emulator *);
+
+/**
+ * Frees every emulator in the pool
+ */
+static void free_pool(Server *);
+
+int run_server(ServerConfig *config) {
+    // Creates the listening socket, replacing any stale socket at the path
+    Server server = { .pool = NULL, .num_pooled = 0, .capacity = config->num_workers };
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(config->socket_path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    strcpy(address.sun_path, config->socket_path);
+    server.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.listener == -1) {
+        return -1;
+    }
+    unlink(config->socket_path);
+    if (bind(server.listener, (struct sockaddr *) &address, sizeof(address)) != 0
+            || listen(server.listener, SOMAXCONN) != 0) {
+        close(server.listener);
+        return -1;
+    }
+
+    // Blocks SIGINT and SIGTERM in every thread, so that they are only taken
+    // by sigwait below, and ignores SIGPIPE so that a client which closes its
+    // connection early does not stop the server
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Initialises an emulator for each worker thread in advance
+    pthread_mutex_init(&server.lock, NULL);
+    server.pool = malloc(server.capacity * sizeof(Emulator *));
+    for (int i = 0; server.pool != NULL && i < server.capacity; i++) {
+        Emulator *emulator = new_emulator();
+        if (emulator == NULL) {
+            break;
+        }
+        server.pool[server.num_pooled++] = emulator;
+    }
+
+    pthread_t acceptor;
+    if (server.pool == NULL || sem_init(&server.connections, 0, config->max_connections) != 0
+            || start_scheduler(&server.scheduler, config->num_workers, config->quantum) != 0) {
+        free_pool(&server);
+        close(server.listener);
+        unlink(config->socket_path);
+        return -1;
+    }
+    if (pthread_create(&acceptor, NULL, &accept_connections, &server) != 0) {
+        stop_scheduler(&server.scheduler);
+        free_pool(&server);
+        close(server.listener);
+        unlink(config->socket_path);
+        return -1;
+    }
+
+    // Waits for SIGINT or SIGTERM, then stops accepting connections and
+    // running guests (connections still open are closed on exit)
+    int signal_number;
+    sigwait(&stop_signals, &signal_number);
+    shutdown(server.listener, SHUT_RDWR);
+    // Wakes the acceptor if it is waiting for a connection to close
+    sem_post(&server.connections);
+    pthread_join(acceptor, NULL);
+    stop_scheduler(&server.scheduler);
+    close(server.listener);
+    unlink(config->socket_path);
+    return 0;
+}
+
+static void *accept_connections(void *argument) {
+    Server *server = argument;
+    for (;;) {
+        // Takes a connection slot, which the serving thread gives back once
+        // the connection is closed
+        if (sem_wait(&server->connections) != 0) {
+            continue;
+        }
+        int connection = accept(server->listener, NULL, NULL);
+        if (connection == -1) {
+            sem_post(&server->connections);
+            // Fails with EINVAL once the listening socket has been shut down
+            if (errno == EINVAL) {
+                break;
+            }
+            continue;
+        }
+        Connection *served = malloc(sizeof(Connection));
+        pthread_t thread;
+        if (served == NULL) {
+            close(connection);
+            sem_post(&server->connections);
+            continue;
+        }
+        *served = (Connection) { .server = server, .connection = connection };
+        if (pthread_create(&thread, NULL, &serve_connection, served) != 0) {
+            close(connection);
+            free(served);
+            sem_post(&server->connections);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static void *serve_connection(void *argument) {
+    Connection *served = argument;
+    Server *server = served->server;
+    int connection = served->connection;
+    free(served);
+
+    // Jobs are read and replies written through separate streams
+    int reply_fd = dup(connection);
+    FILE *in = fdopen(connection, "r");
+    FILE *out = reply_fd == -1 ? NULL : fdopen(reply_fd, "w");
+    if (in == NULL || out == NULL) {
+        if (in != NULL) {
+            fclose(in);
+        } else {
+            close(connection);
+        }
+        if (out != NULL) {
+            fclose(out);
+        } else if (reply_fd != -1) {
+            close(reply_fd);
+        }
+        sem_post(&server->connections);
+        return NULL;
+    }
+
+    for (;;) {
+        Job job = { .seed = NULL, .image = NULL };
+        const char *error = NULL;
+        int read = read_job(in, &job, &error);
+        int result = read == 1 ? run_job(server, &job, out, &error) : -1;
+        free(job.seed);
+        free(job.image);
+        if (error != NULL) {
+            fprintf(out, "error %s\n", error);
+            fflush(out);
+        }
+        if (result != 0) {
+            break;
+        }
+    }
+    fclose(in);
+    fclose(out);
+    sem_post(&server->connections);
+    return NULL;
+}
+
+static int read_job(FILE *in, Job *job, const char **error) {
+    char *header = NULL;
+    size_t size = 0;
+    if (getline(&header, &size, in) == -1) {
+        free(header);
+        return 0;
+    }
+    uint64_t received = get_scheduler_time();
+
+    // Parses the header: image size, instruction limit, reply, and optionally
+    // priority and deadline
+    char *fields[NUM_HEADER_FIELDS];
+    int num_fields = 0;
+    for (char *field = strtok(header, HEADER_DELIMITERS); field != NULL;
+            field = strtok(NULL, HEADER_DELIMITERS)) {
+        if (num_fields == NUM_HEADER_FIELDS) {
+            num_fields++;
+            break;
+        }
+        fields[num_fields++] = field;
+    }
+    bool valid = num_fields >= NUM_REQUIRED_FIELDS && num_fields <= NUM_HEADER_FIELDS;
+    uint64_t numbers[NUM_HEADER_FIELDS] = {0};
+    for (int i = 0; valid && i < num_fields; i++) {
+        // The reply is the only field which is not a number
+        if (i == 2) {
+            job->digest = strcmp(fields[i], "digest") == 0;
+            valid = job->digest || strcmp(fields[i], "output") == 0;
+            continue;
+        }
+        char *end;
+        numbers[i] = strtoull(fields[i], &end, 0);
+        valid = end != fields[i] && *end == '\0';
+    }
+    free(header);
+    job->image_size = numbers[0];
+    job->limit = numbers[1] == 0 ? NO_LIMIT : numbers[1];
+    job->priority = (int) numbers[3];
+    uint64_t deadline = numbers[4];
+    if (!valid || job->image_size > MAX_IMAGE_SIZE || numbers[3] > INT32_MAX
+            || deadline > (NO_DEADLINE - received) / NANOSECONDS_PER_MILLISECOND) {
+        *error = "Invalid job header";
+        return -1;
+    }
+    job->deadline = deadline == 0 ? NO_DEADLINE : received + deadline * NANOSECONDS_PER_MILLISECOND;
+
+    // Reads the seed line, then the image
+    size = 0;
+    job->image = malloc(job->image_size);
+    if (getline(&job->seed, &size, in) == -1 || (job->image == NULL && job->image_size > 0)
+            || fread(job->image, sizeof(uint8_t), job->image_size, in) != job->image_size) {
+        *error = "Incomplete job";
+        return -1;
+    }
+    return 1;
+}
+
+static int run_job(Server *server, Job *job, FILE *out, const char **error) {
+    // Loads the image into a reset emulator, then applies the seed
+    Emulator *emulator = take_emulator(server);
+    if (emulator == NULL) {
+        *error = "Emulator could not be initialised";
+        return -1;
+    }
+    CPUState *cpu = &emulator->cpu;
+    // An empty image leaves memory empty, as an empty binary file does
+    int loaded = 0;
+    if (job->image_size > 0) {
+        FILE *image = fmemopen(job->image, job->image_size, "rb");
+        loaded = image == NULL ? -1 : load_file(image, cpu->memory);
+        if (image != NULL) {
+            fclose(image);
+        }
+    }
+    if (loaded < 0) {
+        return_emulator(server, emulator);
+        *error = "Binary image could not be loaded";
+        return -1;
+    }
+    if (apply_seed(cpu, job->seed, NULL) != 0) {
+        return_emulator(server, emulator);
+        *error = "Invalid seed";
+        return -1;
+    }
+
+    // Runs the guest on the scheduler until it stops, digesting its final
+    // state if requested
+    if (job->digest) {
+        if (start_digest(&emulator->digest, cpu->memory, true) != 0) {
+            return_emulator(server, emulator);
+            *error = "State digest could not be computed";
+            return -1;
+        }
+        cpu->digest = &emulator->digest;
+    }
+    Completion completion = { .finished = false };
+    pthread_mutex_init(&completion.lock, NULL);
+    pthread_cond_init(&completion.done, NULL);
+    Guest guest = {
+        .cpu = cpu,
+        .priority = job->priority,
+        .deadline = job->deadline,
+        .limit = job->limit,
+        .finished = &finish_job,
+        .context = &completion,
+    };
+    bool submitted = submit_guest(&server->scheduler, &guest) == 0;
+    pthread_mutex_lock(&completion.lock);
+    while (submitted && !completion.finished) {
+        pthread_cond_wait(&completion.done, &completion.lock);
+    }
+    pthread_mutex_unlock(&completion.lock);
+    pthread_cond_destroy(&completion.done);
+    pthread_mutex_destroy(&completion.lock);
+
+    // Writes the final state (or its digest) to a buffer, so that its length
+    // is sent first
+    char *payload = NULL;
+    size_t length = 0;
+    FILE *buffer = submitted ? open_memstream(&payload, &length) : NULL;
+    if (cpu->digest != NULL) {
+        Digest state = get_state_digest(cpu->digest, cpu);
+        stop_digest(cpu->digest);
+        cpu->digest = NULL;
+        if (buffer != NULL) {
+            write_digest(state, buffer);
+            fprintf(buffer, "%s", "\n");
+        }
+    } else if (buffer != NULL) {
+        write_output(cpu, buffer);
+    }
+    uint64_t retired = cpu->retired;
+    uint64_t fault = cpu->fault;
+    return_emulator(server, emulator);
+    if (buffer == NULL || fclose(buffer) != 0) {
+        free(payload);
+        *error = submitted ? "Reply could not be written" : "Job could not be scheduled";
+        return -1;
+    }
+
+    fprintf(out, "%s %lu 0x%lx %zu\n", reasonNames[guest.reason], retired, fault, length);
+    fwrite(payload, sizeof(char), length, out);
+    free(payload);
+    return fflush(out) == 0 ? 0 : -1;
+}
+
+static void finish_job(Guest *guest) {
+    Completion *completion = guest->context;
+    pthread_mutex_lock(&completion->lock);
+    completion->finished = true;
+    pthread_cond_signal(&completion->done);
+    pthread_mutex_unlock(&completion->lock);
+}
+
+static Emulator *new_emulator(void) {
+    Emulator *emulator = malloc(sizeof(Emulator));
+    if (emulator != NULL && initialise_emulator(&emulator->cpu) != 0) {
+        free(emulator);
+        return NULL;
+    }
+    return emulator;
+}
+
+static Emulator *take_emulator(Server *server) {
+    pthread_mutex_lock(&server->lock);
+    Emulator *emulator = server->num_pooled > 0 ? server->pool[--server->num_pooled] : NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    if (emulator == NULL) {
+        return new_emulator();
+    }
+    if (reset_emulator(&emulator->cpu) != 0) {
+        discard_emulator(emulator);
+        return NULL;
+    }
+    return emulator;
+}
+
+static void return_emulator(Server *server, Emulator *emulator) {
+    pthread_mutex_lock(&server->lock);
+    if (server->num_pooled < server->capacity) {
+        server->pool[server->num_pooled++] = emulator;
+        emulator = NULL;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (emulator != NULL) {
+        discard_emulator(emulator);
+    }
+}
+
+static void discard_emulator(Emulator *emulator) {
+    free_emulator(&emulator->cpu);
+    free(emulator);
+}
+
+static void free_pool(Server *server) {
+    for (int i = 0; i < server->num_pooled; i++) {
+        discard_emulator(server->pool[i]);
+    }
+    free(server->pool);
+    pthread_mutex_destroy(&server->lock);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+
+// Default maximum number of connections served at once
+#define DEFAULT_CONNECTIONS 64
+
+/**
+ * Represents the configuration of the emulation server:
+ * socket_path:     Path of the Unix socket on which jobs are accepted
+ * num_workers:     Number of host threads which run guests
+ * quantum:         Number of instructions a guest runs before it is preempted
+ * max_connections: Maximum number of connections served at once
+ */
+typedef struct {
+    char *socket_path;
+    int num_workers;
+    uint64_t quantum;
+    int max_connections;
+} ServerConfig;
+
+/**
+ * Runs the emulation server until it receives SIGINT or SIGTERM:
+ * Listens on a Unix (stream) socket, and runs the jobs sent on each accepted
+ * connection in turn until the client closes it (jobs on separate
+ * connections run concurrently, up to max_connections at once - any further
+ * connection waits in the listen backlog until one closes). Each job runs on
+ * an emulator taken from a pool of up to num_workers emulators which are
+ * initialised once and reset between jobs (an emulator needed beyond those is
+ * initialised for the job and freed after it), and is
+ * time-sliced with every other job across the worker threads, a quantum of
+ * instructions at a time (see Scheduler)
+ * A job is sent as:
+ *   <image_size> <limit> <output|digest> [<priority> [<deadline>]]\n
+ *   <seed>\n
+ *   <image_size bytes of a binary image (flat or segmented)>
+ * where limit is the maximum number of instructions retired (0 if none - a
+ * call to the runtime page runs whole, so it may retire past it), a
+ * job of higher priority (default 0) runs first, a job of equal priority with
+ * an earlier deadline (in milliseconds from when the job is received, 0 if
+ * none) runs first, and the seed sets the initial state as for --batch (empty
+ * if unchanged)
+ * The reply to each job is sent as:
+ *   <halt|fault|limit> <retired> <fault_address> <length>\n
+ *   <length bytes: the final state as written by write_output, or its digest>
+ * or, if the job is invalid, as error <message>\n - the connection is then
+ * closed
+ * Returns 0 if success and -1 if the server could not be started
+ */
+extern int run_server(ServerConfig *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "monitor.h"
+#include "../common/live_stats.h"
+
+// Expected positional argument: name of the live counters
+#define NUM_POSITIONAL_ARGUMENTS 1
+// Default number of milliseconds between rows of the table
+#define DEFAULT_INTERVAL 1000
+// Number of nanoseconds in a millisecond
+#define NANOSECONDS_PER_MILLISECOND 1000000
+
+/**
+ * Represents the identifiers of the long-only options
+ */
+enum {
+    INTERVAL_OPTION = 256,
+    PROMETHEUS_OPTION,
+    PEEK_OPTION,
+};
+
+/**
+ * Defines the long options accepted by the monitor
+ */
+static struct option longOptions[] = {
+    {"interval", required_argument, NULL, INTERVAL_OPTION},
+    {"prometheus", no_argument, NULL, PROMETHEUS_OPTION},
+    {"peek", required_argument, NULL, PEEK_OPTION},
+    {NULL, 0, NULL, 0},
+};
+
+/**
+ * The entry point of the live counter monitor program.
+ * Maps the live counters which an emulator publishes with --live NAME (see
+ * live_stats.h) read-only, and writes a row of them to stdout every interval
+ * until the guest stops, without pausing it.
+ * With --peek ADDR, also maps guest memory read-only through the memory file
+ * named by the counters, and shows the word at ADDR in each row, as the guest
+ * writes it.
+ * With --prometheus, writes a single snapshot in the Prometheus text
+ * exposition format instead, for a metrics agent to collect.
+ */
+int main(int argc, char **argv) {
+    // Parses the options - any option other than --interval, --prometheus or
+    // --peek is invalid
+    uint64_t interval = DEFAULT_INTERVAL;
+    bool prometheus = false;
+    bool peek = false;
+    uint64_t address = 0;
+    bool valid = true;
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        if (option == INTERVAL_OPTION) {
+            char *end;
+            interval = strtoull(optarg, &end, 0);
+            valid = valid && end != optarg && *end == '\0' && interval > 0;
+        } else if (option == PROMETHEUS_OPTION) {
+            prometheus = true;
+        } else if (option == PEEK_OPTION) {
+            char *end;
+            address = strtoull(optarg, &end, 0);
+            valid = valid && end != optarg && *end == '\0';
+            peek = true;
+        } else {
+            valid = false;
+        }
+    }
+
+    // Exits the program if the options or argument count are invalid
+    if (!valid || argc - optind != NUM_POSITIONAL_ARGUMENTS) {
+        fprintf(stderr, "%s\n", "Usage: ./emustat [--interval MS] [--prometheus] [--peek ADDR] <name>");
+        return EXIT_FAILURE;
+    }
+    char *name = argv[optind];
+
+    const LiveStats *stats = open_live_stats(name);
+    if (stats == NULL) {
+        fprintf(stderr, "Live counters /dev/shm/%s could not be opened.\n", name);
+        return EXIT_FAILURE;
+    }
+
+    LiveStats snapshot;
+    if (prometheus) {
+        read_live_stats(stats, &snapshot);
+        write_prometheus(&snapshot, name, stdout);
+    } else {
+        // Maps guest memory if a word of it is shown
+        read_live_stats(stats, &snapshot);
+        printf("Guest memory: %s\n", snapshot.memory[0] == '\0' ? "not shared" : snapshot.memory);
+        const uint8_t *memory = NULL;
+        if (peek && (memory = open_guest_memory(&snapshot)) == NULL) {
+            fprintf(stderr, "Guest memory %s could not be mapped.\n", snapshot.memory);
+            close_live_stats(stats);
+            return EXIT_FAILURE;
+        }
+
+        // Writes a row every interval, and a last row once the guest stops
+        struct timespec delay = {
+            .tv_sec = interval / 1000,
+            .tv_nsec = interval % 1000 * NANOSECONDS_PER_MILLISECOND,
+        };
+        write_live_header(peek, stdout);
+        do {
+            read_live_stats(stats, &snapshot);
+            write_live_row(&snapshot, memory, address, stdout);
+            fflush(stdout);
+        } while (is_live(&snapshot) && nanosleep(&delay, NULL) == 0);
+        if (memory != NULL) {
+            close_guest_memory(memory, snapshot.size);
+        }
+    }
+    close_live_stats(stats);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
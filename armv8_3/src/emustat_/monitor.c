@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "monitor.h"
+#include "../common/live_stats.h"
+
+// Number of instructions retired per second in a MIPS
+#define INSTRUCTIONS_PER_MIPS 1e6
+// Number of nanoseconds in a second
+#define NANOSECONDS 1e9
+
+/**
+ * Represents a metric of the Prometheus export, and the field of the live
+ * counters it samples
+ */
+typedef struct {
+    const char *name;
+    const char *type;
+    const char *help;
+    double (*sample)(const LiveStats *);
+} Metric;
+
+/**
+ * Returns the value of each metric sampled from a snapshot of live counters
+ */
+static double sample_retired(const LiveStats *);
+static double sample_pc(const LiveStats *);
+static double sample_mips(const LiveStats *);
+static double sample_loads(const LiveStats *);
+static double sample_stores(const LiveStats *);
+static double sample_running(const LiveStats *);
+static double sample_uptime(const LiveStats *);
+
+/**
+ * Defines the metrics of the Prometheus export, in the order they are written
+ */
+static const Metric metrics[] = {
+    {"emulate_instructions_retired_total", "counter", "Instructions retired by the guest.", &sample_retired},
+    {"emulate_pc", "gauge", "Program counter of the guest.", &sample_pc},
+    {"emulate_mips", "gauge", "Millions of instructions retired per second over the last second.", &sample_mips},
+    {"emulate_loads_total", "counter", "Loads from guest memory.", &sample_loads},
+    {"emulate_stores_total", "counter", "Stores to guest memory.", &sample_stores},
+    {"emulate_running", "gauge", "Whether the guest is still running (1) or has stopped (0).", &sample_running},
+    {"emulate_uptime_seconds", "gauge", "Seconds from the start of the guest to the last update.", &sample_uptime},
+};
+#define NUM_METRICS (sizeof(metrics) / sizeof(Metric))
+
+/**
+ * Defines the names of the states of the guest
+ */
+static const char *stateNames[] = {
+    [LIVE_RUNNING] = "running",
+    [LIVE_HALTED] = "halted",
+    [LIVE_FAULTED] = "faulted",
+    [LIVE_STOPPED] = "stopped",
+    [LIVE_EXITED] = "exited",
+};
+
+/**
+ * Writes a string to a file stream as the value of a Prometheus label,
+ * escaping backslashes, double quotes and newlines
+ */
+static void write_label_value(char *, FILE *);
+
+const LiveStats *open_live_stats(char *name) {
+    char path[NAME_MAX];
+    if (*name == '\0' || strchr(name, '/') != NULL || strlen(name) + 1 >= NAME_MAX) {
+        return NULL;
+    }
+    snprintf(path, NAME_MAX, "/%s", name);
+
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+    void *page = mmap(NULL, LIVE_STATS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (page == MAP_FAILED) {
+        return NULL;
+    }
+
+    // The magic and version are written once, before the first update
+    const LiveStats *stats = page;
+    if (memcmp(stats->magic, LIVE_STATS_MAGIC, LIVE_STATS_MAGIC_LENGTH) != 0
+            || stats->version != LIVE_STATS_VERSION) {
+        munmap(page, LIVE_STATS_SIZE);
+        return NULL;
+    }
+    return stats;
+}
+
+void read_live_stats(const LiveStats *stats, LiveStats *snapshot) {
+    LiveStats *shared = (LiveStats *) stats;
+    for (;;) {
+        uint64_t sequence = atomic_load_explicit(&shared->sequence, memory_order_acquire);
+        if (sequence % 2 == 0) {
+            memcpy(snapshot, (const void *) stats, sizeof(LiveStats));
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&shared->sequence, memory_order_relaxed) == sequence) {
+                return;
+            }
+        }
+        sched_yield();
+    }
+}
+
+bool is_live(const LiveStats *snapshot) {
+    // An emulator which was killed never publishes that its guest stopped
+    return snapshot->state == LIVE_RUNNING && (kill(snapshot->pid, 0) == 0 || errno != ESRCH);
+}
+
+void write_live_header(bool peek, FILE *fp) {
+    fprintf(fp, "%10s %16s %10s %10s %14s %14s",
+        "Seconds", "Retired", "PC", "MIPS", "Loads", "Stores");
+    if (peek) {
+        fprintf(fp, " %18s", "Peek");
+    }
+    fprintf(fp, "  %s\n", "State");
+}
+
+void write_live_row(const LiveStats *snapshot, const uint8_t *memory, uint64_t address, FILE *fp) {
+    fprintf(fp, "%10.1f %16lu 0x%08lx %10.2f %14lu %14lu",
+        sample_uptime(snapshot), snapshot->retired, snapshot->pc, sample_mips(snapshot),
+        snapshot->loads, snapshot->stores);
+    if (memory != NULL) {
+        fprintf(fp, " 0x%016lx", peek_guest_memory(memory, snapshot->size, address));
+    }
+    const char *state = snapshot->state <= LIVE_EXITED ? stateNames[snapshot->state] : "unknown";
+    fprintf(fp, "  %s\n", state);
+}
+
+void write_prometheus(const LiveStats *snapshot, char *name, FILE *fp) {
+    for (int i = 0; i < NUM_METRICS; i++) {
+        fprintf(fp, "# HELP %s %s\n", metrics[i].name, metrics[i].help);
+        fprintf(fp, "# TYPE %s %s\n", metrics[i].name, metrics[i].type);
+        fprintf(fp, "%s{name=\"", metrics[i].name);
+        write_label_value(name, fp);
+        fprintf(fp, "\",pid=\"%lu\"} %.15g\n", snapshot->pid, metrics[i].sample(snapshot));
+    }
+}
+
+const uint8_t *open_guest_memory(const LiveStats *snapshot) {
+    if (snapshot->memory[0] == '\0' || snapshot->size == 0) {
+        return NULL;
+    }
+    char path[LIVE_PATH_LENGTH];
+    snprintf(path, LIVE_PATH_LENGTH, "%s", snapshot->memory);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    void *memory = mmap(NULL, snapshot->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+uint64_t peek_guest_memory(const uint8_t *memory, uint64_t size, uint64_t address) {
+    if (address > size - sizeof(uint64_t)) {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (int i = sizeof(uint64_t) - 1; i >= 0; i--) {
+        value = value << CHAR_BIT | memory[address + i];
+    }
+    return value;
+}
+
+void close_guest_memory(const uint8_t *memory, uint64_t size) {
+    munmap((void *) memory, size);
+}
+
+void close_live_stats(const LiveStats *stats) {
+    munmap((void *) stats, LIVE_STATS_SIZE);
+}
+
+static double sample_retired(const LiveStats *snapshot) {
+    return snapshot->retired;
+}
+
+static double sample_pc(const LiveStats *snapshot) {
+    return snapshot->pc;
+}
+
+static double sample_mips(const LiveStats *snapshot) {
+    return snapshot->rate / INSTRUCTIONS_PER_MIPS;
+}
+
+static double sample_loads(const LiveStats *snapshot) {
+    return snapshot->loads;
+}
+
+static double sample_stores(const LiveStats *snapshot) {
+    return snapshot->stores;
+}
+
+static double sample_running(const LiveStats *snapshot) {
+    return is_live(snapshot);
+}
+
+static double sample_uptime(const LiveStats *snapshot) {
+    return (snapshot->updated - snapshot->started) / NANOSECONDS;
+}
+
+static void write_label_value(char *value, FILE *fp) {
+    for (char *c = value; *c != '\0'; c++) {
+        if (*c == '\\' || *c == '"') {
+            fprintf(fp, "\\%c", *c);
+        } else if (*c == '\n') {
+            fprintf(fp, "%s", "\\n");
+        } else {
+            fputc(*c, fp);
+        }
+    }
+}
\ No newline at end of file
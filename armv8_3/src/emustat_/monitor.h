@@ -0,0 +1,76 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../common/live_stats.h"
+
+/**
+ * Maps the live counters published by an emulator under a given name
+ * (/dev/shm/NAME) read-only
+ * Returns a pointer to them, or NULL if they cannot be mapped or are not live
+ * counters of a known version
+ */
+extern const LiveStats *open_live_stats(char *);
+
+/**
+ * Copies a consistent snapshot of the live counters (one written by a single
+ * update - see live_stats.h), retrying while they are being updated
+ */
+extern void read_live_stats(const LiveStats *, LiveStats *);
+
+/**
+ * Returns true if the emulator which publishes a snapshot of live counters is
+ * still running its guest (it has not stopped, and its process exists)
+ */
+extern bool is_live(const LiveStats *);
+
+/**
+ * Writes the header of the table of live counters to a file stream, with a
+ * column of a word of guest memory if set
+ */
+extern void write_live_header(bool, FILE *);
+
+/**
+ * Writes a snapshot of the live counters to a file stream as a row of the
+ * table: seconds since the guest started, instructions retired, PC, MIPS,
+ * loads, stores, then the word at a given address of guest memory mapped by
+ * open_guest_memory (unless it is NULL), and state
+ */
+extern void write_live_row(const LiveStats *, const uint8_t *, uint64_t, FILE *);
+
+/**
+ * Writes a snapshot of the live counters published under a given name to a
+ * file stream in the Prometheus text exposition format, each sample labelled
+ * with the name
+ */
+extern void write_prometheus(const LiveStats *, char *, FILE *);
+
+/**
+ * Maps the guest memory of the emulator which publishes a snapshot of live
+ * counters read-only, through the memory file it names, so that it is seen
+ * live without the emulator copying it
+ * Returns a pointer to it, or NULL if it cannot be mapped
+ */
+extern const uint8_t *open_guest_memory(const LiveStats *);
+
+/**
+ * Returns the 64-bit little-endian word at an address of guest memory of a
+ * given size, mapped by open_guest_memory (0 if it lies out of bounds) - it
+ * may be torn if the guest is writing it
+ */
+extern uint64_t peek_guest_memory(const uint8_t *, uint64_t, uint64_t);
+
+/**
+ * Unmaps guest memory mapped by open_guest_memory, of a given size
+ */
+extern void close_guest_memory(const uint8_t *, uint64_t);
+
+/**
+ * Unmaps live counters mapped by open_live_stats
+ */
+extern void close_live_stats(const LiveStats *);
+
+#endif
\ No newline at end of file
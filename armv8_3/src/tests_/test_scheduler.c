@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../common/utilities.h"
+#include "../emulate_/emulator.h"
+#include "../emulate_/scheduler.h"
+
+// Number of guests, more than twice the initial capacity of the queue (64),
+// so that the queue is full while a guest is preempted, and grows on submit
+#define NUM_GUESTS 129
+// Number of instructions a guest runs before it is preempted - long enough
+// for every other guest to be submitted while the first runs
+#define TEST_QUANTUM 200000
+// Instruction limit of each guest: preempted once, then one more instruction
+#define TEST_LIMIT (TEST_QUANTUM + 1)
+// Encoding of b . (an infinite loop)
+#define BRANCH_TO_SELF 0x14000000
+
+/**
+ * Represents the guests which have finished, which the test waits for
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int num_finished;
+} Finished;
+
+/**
+ * Counts a guest as finished (called by the scheduler)
+ */
+static void finish_guest(Guest *);
+
+/**
+ * Returns the number of guests the scheduler is running for a quantum
+ */
+static int get_num_running(Scheduler *);
+
+/**
+ * Tests the scheduler by preempting more guests than the queue initially
+ * holds, while the queue is full: each guest loops forever, so it is
+ * preempted at the end of its first quantum and queued again, and must then
+ * stop exactly at its limit.
+ * Returns EXIT_SUCCESS if every guest stops at its limit, and EXIT_FAILURE
+ * otherwise.
+ */
+int main(void) {
+    static CPUState cpus[NUM_GUESTS];
+    static Guest guests[NUM_GUESTS];
+    Finished finished = { .num_finished = 0 };
+    pthread_mutex_init(&finished.lock, NULL);
+    pthread_cond_init(&finished.done, NULL);
+
+    // Loads every guest in advance, so that they are submitted in quick
+    // succession
+    for (int i = 0; i < NUM_GUESTS; i++) {
+        if (initialise_emulator(&cpus[i]) != 0) {
+            fprintf(stderr, "%s", "Emulator could not be initialised.\n");
+            return EXIT_FAILURE;
+        }
+        uint32_t instruction = BRANCH_TO_SELF;
+        memcpy(cpus[i].memory, &instruction, sizeof(instruction));
+        guests[i] = (Guest) {
+            .cpu = &cpus[i],
+            .priority = 0,
+            .deadline = NO_DEADLINE,
+            .limit = TEST_LIMIT,
+            .finished = &finish_guest,
+            .context = &finished,
+        };
+    }
+
+    // A single thread runs the first guest, while every other guest is
+    // queued behind it
+    Scheduler scheduler;
+    if (start_scheduler(&scheduler, 1, TEST_QUANTUM) != 0) {
+        fprintf(stderr, "%s", "Scheduler could not be started.\n");
+        return EXIT_FAILURE;
+    }
+    if (submit_guest(&scheduler, &guests[0]) != 0) {
+        fprintf(stderr, "%s", "Guest could not be submitted.\n");
+        return EXIT_FAILURE;
+    }
+    while (get_num_running(&scheduler) == 0) {
+        sched_yield();
+    }
+    for (int i = 1; i < NUM_GUESTS; i++) {
+        if (submit_guest(&scheduler, &guests[i]) != 0) {
+            fprintf(stderr, "%s", "Guest could not be submitted.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    pthread_mutex_lock(&finished.lock);
+    while (finished.num_finished < NUM_GUESTS) {
+        pthread_cond_wait(&finished.done, &finished.lock);
+    }
+    pthread_mutex_unlock(&finished.lock);
+    stop_scheduler(&scheduler);
+
+    int failures = 0;
+    for (int i = 0; i < NUM_GUESTS; i++) {
+        if (guests[i].reason != STOP_LIMIT || cpus[i].retired != TEST_LIMIT) {
+            fprintf(stderr, "Guest %d stopped after %lu instructions (expected %d).\n",
+                    i, cpus[i].retired, TEST_LIMIT);
+            failures++;
+        }
+        free_emulator(&cpus[i]);
+    }
+    pthread_cond_destroy(&finished.done);
+    pthread_mutex_destroy(&finished.lock);
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    printf("%s", "Scheduler test passed.\n");
+    return EXIT_SUCCESS;
+}
+
+static void finish_guest(Guest *guest) {
+    Finished *finished = guest->context;
+    pthread_mutex_lock(&finished->lock);
+    finished->num_finished++;
+    pthread_cond_signal(&finished->done);
+    pthread_mutex_unlock(&finished->lock);
+}
+
+static int get_num_running(Scheduler *scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    int num_running = scheduler->num_running;
+    pthread_mutex_unlock(&scheduler->lock);
+    return num_running;
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "translator.h"
+#include "../common/utilities.h"
+#include "../emulate_/binary_loader.h"
+
+// Expected positional arguments: paths to input .bin file & output .c file
+#define NUM_POSITIONAL_ARGUMENTS 2
+// Host compiler used by --compile, unless given by the CC environment variable
+#define DEFAULT_COMPILER "cc"
+// Exit status of a child process which could not run the compiler
+#define EXEC_FAILURE 127
+
+/**
+ * Represents the identifiers of the long-only options
+ */
+enum {
+    COMPILE_OPTION = 256,
+};
+
+/**
+ * Defines the long options accepted by the translator
+ */
+static struct option longOptions[] = {
+    {"compile", required_argument, NULL, COMPILE_OPTION},
+    {NULL, 0, NULL, 0},
+};
+
+/**
+ * Compiles a C source file given by a path with the host compiler, into an
+ * executable given by a path - returns 0 if success and -1 otherwise
+ */
+static int compile(char *, char *);
+
+/**
+ * The entry point of the translator program.
+ * Loads a binary file (flat or segmented) into memory, as the emulator does,
+ * and writes an equivalent C program, which writes the same output as the
+ * emulator when run (to the path given by its first argument, or to stdout).
+ * With --compile, also compiles the C program into a native executable.
+ * Exits the program if an error occurs at any point.
+ */
+int main(int argc, char **argv) {
+    // Parses the options - any option other than --compile is invalid
+    char *exec_path = NULL;
+    bool valid = true;
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        if (option == COMPILE_OPTION) {
+            exec_path = optarg;
+        } else {
+            valid = false;
+        }
+    }
+
+    // Exits the program if the options or argument count are invalid
+    if (!valid || argc - optind != NUM_POSITIONAL_ARGUMENTS) {
+        fprintf(stderr, "%s\n",
+            "Usage: ./translate [--compile <exec_path>] <input_path> <output_path>");
+        return EXIT_FAILURE;
+    }
+    char *input_path = argv[optind];
+    char *output_path = argv[optind + 1];
+
+    // Opens binary file given by 1st positional argument in read binary mode
+    FILE *in = open_file(input_path);
+    if (in == NULL) {
+        perror("Could not open input file");
+        return EXIT_FAILURE;
+    }
+
+    // Loads the image into zero-initialised memory, as the emulator does
+    uint8_t *memory = calloc(MEMORY_SIZE, sizeof(uint8_t));
+    if (memory == NULL) {
+        perror("Memory could not be allocated");
+        return EXIT_FAILURE;
+    }
+    int image_size = load_file(in, memory);
+    if (image_size == -1) {
+        perror("Could not load input file");
+        return EXIT_FAILURE;
+    }
+    if (close_file(in) != 0) {
+        perror("Could not close input file");
+        return EXIT_FAILURE;
+    }
+
+    // Opens output C file given by 2nd positional argument in write mode
+    FILE *out = fopen(output_path, "w");
+    if (out == NULL) {
+        perror("Could not open output file");
+        return EXIT_FAILURE;
+    }
+
+    // Writes the translated program
+    if (translate_image(memory, image_size, out) != 0) {
+        perror("Could not write output file");
+        return EXIT_FAILURE;
+    }
+    free(memory);
+
+    // Closes the output file and exits the program if an error occurs
+    if (fclose(out) != 0) {
+        perror("Could not close output file");
+        return EXIT_FAILURE;
+    }
+
+    // Compiles the translated program if requested
+    if (exec_path != NULL && compile(output_path, exec_path) != 0) {
+        fprintf(stderr, "Could not compile %s\n", output_path);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int compile(char *source_path, char *exec_path) {
+    char *compiler = getenv("CC");
+    if (compiler == NULL) {
+        compiler = DEFAULT_COMPILER;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    }
+    if (pid == 0) {
+        // Only returns if the compiler could not be run
+        execlp(compiler, compiler, "-O2", "-o", exec_path, source_path, (char *) NULL);
+        _exit(EXEC_FAILURE);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1) {
+        return -1;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
\ No newline at end of file
@@ -0,0 +1,812 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "translator.h"
+#include "../common/utilities.h"
+#include "../common/instructions.h"
+#include "../emulate_/micro_op.h"
+#include "../emulate_/decoder.h"
+#include "../emulate_/memory.h"
+#include "../emulate_/runtime.h"
+
+// Number of image words written per line of the generated image table
+#define WORDS_PER_LINE 4
+
+/**
+ * Represents a binary image being translated:
+ * out:       Stream of the generated C source
+ * memory:    Memory holding the image
+ * num_words: Number of words in the image (the image end is num_words * 4)
+ * ops:       Micro-op of each word of the image
+ * reachable: Set if a word is reachable from address 0 by falling through or
+ *            by direct branches (only these words are emitted, unless dynamic)
+ * target:    Set if a word starts a basic block which is branched to
+ * dynamic:   Set if the image contains a reachable br, or a branch to the
+ *            runtime page (whose routines return through x30) - its targets
+ *            are only known at run time, so every word is emitted as a target
+ */
+typedef struct {
+    FILE *out;
+    uint8_t *memory;
+    uint64_t num_words;
+    MicroOp *ops;
+    bool *reachable;
+    bool *target;
+    bool dynamic;
+} Translation;
+
+/**
+ * Represents an entry of the emit table, which describes the operation of a
+ * specialised handler (see micro_op.h):
+ * func_ptr: Writes the C statements of a micro-op of the handler
+ * width:    Bit width of the operation (32 or 64)
+ * operator: C operator of the operation (arithmetic, logical, multiply)
+ * flags:    Flag setter of an arithmetic operation (a macro of the runtime)
+ * shift:    Shift applied to the 2nd operand register (NULL for immediates)
+ * negate:   Set if the 2nd operand of a logical operation is negated
+ * set_flags: Set if a logical operation sets the flags
+ * opc:      Opcode of a wide move
+ * load:     Set if a transfer is a load, otherwise it is a store
+ * mode:     Addressing mode of a transfer
+ */
+typedef struct EmitEntry EmitEntry;
+typedef void (*EmitPtr)(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+struct EmitEntry {
+    EmitPtr func_ptr;
+    int width;
+    const char *operator;
+    const char *flags;
+    const char *shift;
+    bool negate;
+    bool set_flags;
+    int opc;
+    bool load;
+    int mode;
+};
+
+/**
+ * Writes the C statements of each kind of micro-op at a given address
+ */
+static void emit_arithmetic(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_logical(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_multiply(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_wide_move(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_transfer(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_load_literal(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_nop(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_b(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_br(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+static void emit_b_cond(Translation *, MicroOp *, uint64_t, const EmitEntry *);
+
+/**
+ * Defines the static table of emitters, indexed by HandlerId - generated from
+ * the same operation lists as the handlers, so that each entry carries the
+ * operator, flag setter and shift of its handler
+ * Fused pairs and idioms have no entry, as they are never formed by lowering
+ */
+#define ARITHMETIC_IMM_EMIT(W, NAME, name, symbol, setter) \
+    [UOP_##NAME##_IMM_##W] = { .func_ptr = &emit_arithmetic, .width = W, \
+        .operator = #symbol, .flags = #setter },
+#define ARITHMETIC_IMM_EMITS(NAME, name, symbol, setter) \
+    FOR_EACH_WIDTH(ARITHMETIC_IMM_EMIT, NAME, name, symbol, setter)
+#define WIDE_MOVE_EMIT(W, NAME, opcode) \
+    [UOP_##NAME##_##W] = { .func_ptr = &emit_wide_move, .width = W, .opc = opcode },
+#define WIDE_MOVE_EMITS(NAME, name, opcode) FOR_EACH_WIDTH(WIDE_MOVE_EMIT, NAME, opcode)
+#define ARITHMETIC_REG_EMIT(W, SHIFT, NAME, symbol, setter) \
+    [UOP_##NAME##_##SHIFT##_##W] = { .func_ptr = &emit_arithmetic, .width = W, \
+        .operator = #symbol, .flags = #setter, .shift = "SHIFT_" #SHIFT },
+#define ARITHMETIC_REG_SHIFT_EMITS(SHIFT, shift, NAME, symbol, setter) \
+    FOR_EACH_WIDTH(ARITHMETIC_REG_EMIT, SHIFT, NAME, symbol, setter)
+#define ARITHMETIC_REG_EMITS(NAME, name, symbol, setter) \
+    FOR_EACH_ARITHMETIC_SHIFT(ARITHMETIC_REG_SHIFT_EMITS, NAME, symbol, setter)
+#define LOGICAL_EMIT(W, SHIFT, NAME, symbol, negated, sets) \
+    [UOP_##NAME##_##SHIFT##_##W] = { .func_ptr = &emit_logical, .width = W, \
+        .operator = #symbol, .shift = "SHIFT_" #SHIFT, .negate = negated, \
+        .set_flags = sets },
+#define LOGICAL_SHIFT_EMITS(SHIFT, shift, NAME, symbol, negated, sets) \
+    FOR_EACH_WIDTH(LOGICAL_EMIT, SHIFT, NAME, symbol, negated, sets)
+#define LOGICAL_EMITS(NAME, name, symbol, negated, sets) \
+    FOR_EACH_LOGICAL_SHIFT(LOGICAL_SHIFT_EMITS, NAME, symbol, negated, sets)
+#define MULTIPLY_EMIT(W, NAME, symbol) \
+    [UOP_##NAME##_##W] = { .func_ptr = &emit_multiply, .width = W, .operator = #symbol },
+#define MULTIPLY_EMITS(NAME, name, symbol) FOR_EACH_WIDTH(MULTIPLY_EMIT, NAME, symbol)
+#define TRANSFER_EMIT(W, NAME, L, addressing) \
+    [UOP_##NAME##_##W] = { .func_ptr = &emit_transfer, .width = W, \
+        .load = (L) == LOAD_L, .mode = addressing },
+#define TRANSFER_EMITS(NAME, name, L, addressing) FOR_EACH_WIDTH(TRANSFER_EMIT, NAME, L, addressing)
+#define LOAD_LITERAL_EMIT(W, NAME) \
+    [UOP_##NAME##_##W] = { .func_ptr = &emit_load_literal, .width = W },
+static const EmitEntry emitTable[NUM_HANDLERS] = {
+    [UOP_NOP] = { .func_ptr = &emit_nop },
+    ARITHMETIC_OPS(ARITHMETIC_IMM_EMITS)
+    WIDE_MOVE_OPS(WIDE_MOVE_EMITS)
+    ARITHMETIC_OPS(ARITHMETIC_REG_EMITS)
+    LOGICAL_OPS(LOGICAL_EMITS)
+    MULTIPLY_OPS(MULTIPLY_EMITS)
+    TRANSFER_OPS(TRANSFER_EMITS)
+    FOR_EACH_WIDTH(LOAD_LITERAL_EMIT, LDR_LITERAL)
+    [UOP_B] = { .func_ptr = &emit_b },
+    [UOP_BR] = { .func_ptr = &emit_br },
+    [UOP_B_COND] = { .func_ptr = &emit_b_cond },
+};
+
+/**
+ * The start of the generated program, before the image tables
+ */
+static const char header[] =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdbool.h>\n"
+    "#include <string.h>\n";
+
+/**
+ * The runtime of the generated program, after the image tables: the macros used
+ * by the translated instructions (following the handlers and flag setters of
+ * the emulator) and the guest memory, whose accesses behave like the emulator's
+ * (an address outside memory faults at that address, and an access which runs
+ * past its end faults at the end)
+ * Translated instructions are never re-read, so a store which changes one of
+ * them, or execution beyond the image of anything but zero words (which are
+ * undefined, and executed as nops), is reported as unsupported
+ */
+static const char runtime[] =
+    "#define SIGN_OF(W, value) ((value) >> ((W) - 1))\n"
+    "#define SHIFT_LSL(W, value, amount) ((uint##W##_t) ((uint64_t) (value) << (amount)))\n"
+    "#define SHIFT_LSR(W, value, amount) ((uint##W##_t) ((uint64_t) (value) >> (amount)))\n"
+    "#define SHIFT_ASR(W, value, amount) \\\n"
+    "    ((uint##W##_t) ((int64_t) (int##W##_t) (value) >> (amount)))\n"
+    "#define SHIFT_ROR(W, value, amount) \\\n"
+    "    ((amount) == 0 ? (value) : (uint##W##_t) ((uint64_t) (value) >> (amount) \\\n"
+    "        | (uint64_t) (value) << ((W) - (amount))))\n"
+    "#define NO_FLAGS(W, op1, op2, result)\n"
+    "#define SET_FLAGS_ADD(W, op1, op2, result) \\\n"
+    "    n = SIGN_OF(W, result); z = (result) == 0; c = (result) < (op1); \\\n"
+    "    v = SIGN_OF(W, op1) == SIGN_OF(W, op2) && SIGN_OF(W, op2) != SIGN_OF(W, result);\n"
+    "#define SET_FLAGS_SUB(W, op1, op2, result) \\\n"
+    "    n = SIGN_OF(W, result); z = (result) == 0; c = (op1) >= (op2); \\\n"
+    "    v = SIGN_OF(W, op1) != SIGN_OF(W, op2) && SIGN_OF(W, op2) == SIGN_OF(W, result);\n"
+    "#define FAULT(address) do { pc = (address); goto fault; } while (0)\n"
+    "\n"
+    "static uint8_t memory[MEMORY_SIZE];\n"
+    "static uint8_t original[MEMORY_SIZE];\n"
+    "static bool translated[MEMORY_SIZE / 4];\n"
+    "static uint64_t fault_address;\n"
+    "\n"
+    "static uint32_t read_word(const uint8_t *bytes, uint64_t address) {\n"
+    "    return bytes[address] | bytes[address + 1] << 8 | bytes[address + 2] << 16\n"
+    "        | (uint32_t) bytes[address + 3] << 24;\n"
+    "}\n"
+    "\n"
+    "static void load_image(void) {\n"
+    "    for (size_t i = 0; i < sizeof(image) / sizeof(image[0]); i++) {\n"
+    "        for (int j = 0; j < 4; j++) {\n"
+    "            memory[image[i][0] + j] = image[i][1] >> (j * 8);\n"
+    "        }\n"
+    "    }\n"
+    "    memcpy(original, memory, CODE_END);\n"
+    "    for (size_t i = 0; i < sizeof(code) / sizeof(code[0]); i++) {\n"
+    "        for (uint32_t word = code[i][0] / 4; word < code[i][1] / 4; word++) {\n"
+    "            translated[word] = true;\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void unsupported(uint64_t pc) {\n"
+    "    fprintf(stderr, \"Self-modifying code is not supported (PC = 0x%lx).\\n\", pc);\n"
+    "    exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static void check_code(uint64_t base, uint64_t length, uint64_t pc) {\n"
+    "    for (uint64_t word = base / 4; word * 4 < base + length; word++) {\n"
+    "        if (translated[word] && read_word(memory, word * 4) != read_word(original, word * 4)) {\n"
+    "            unsupported(pc);\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static bool load(uint64_t address, int bytes, uint64_t *value) {\n"
+    "    *value = 0;\n"
+    "    for (int i = 0; i < bytes; i++) {\n"
+    "        if (address >= MEMORY_SIZE - i) {\n"
+    "            fault_address = address + i;\n"
+    "            return false;\n"
+    "        }\n"
+    "        *value |= (uint64_t) memory[address + i] << (i * 8);\n"
+    "    }\n"
+    "    return true;\n"
+    "}\n"
+    "\n"
+    "static bool store(uint64_t address, int bytes, uint64_t value, uint64_t pc) {\n"
+    "    for (int i = 0; i < bytes; i++) {\n"
+    "        if (address >= MEMORY_SIZE - i) {\n"
+    "            fault_address = address + i;\n"
+    "            return false;\n"
+    "        }\n"
+    "        memory[address + i] = value >> (i * 8);\n"
+    "    }\n"
+    "    check_code(address, bytes, pc);\n"
+    "    return true;\n"
+    "}\n"
+    "\n"
+    "static int write_output(int argc, char **argv, uint64_t registers[], uint64_t pc,\n"
+    "        bool n, bool z, bool c, bool v) {\n"
+    "    FILE *fp = argc > 1 ? fopen(argv[1], \"w\") : stdout;\n"
+    "    if (fp == NULL) {\n"
+    "        perror(\"Could not open output file\");\n"
+    "        return -1;\n"
+    "    }\n"
+    "    fprintf(fp, \"Registers:\\n\");\n"
+    "    for (int i = 0; i < 31; i++) {\n"
+    "        fprintf(fp, \"X%02d = %016lx\\n\", i, registers[i]);\n"
+    "    }\n"
+    "    fprintf(fp, \"PC  = %016lx\\n\", pc);\n"
+    "    fprintf(fp, \"PSTATE : %c%c%c%c\\n\", n ? 'N' : '-', z ? 'Z' : '-', c ? 'C' : '-',\n"
+    "        v ? 'V' : '-');\n"
+    "    fprintf(fp, \"Non-Zero memory:\\n\");\n"
+    "    for (uint64_t i = 0; i < MEMORY_SIZE; i += 4) {\n"
+    "        uint32_t word = read_word(memory, i);\n"
+    "        if (word != 0) {\n"
+    "            fprintf(fp, \"0x%08lx : %08x\\n\", i, word);\n"
+    "        }\n"
+    "    }\n"
+    "    return fp == stdout ? fflush(fp) : fclose(fp);\n"
+    "}\n";
+
+/**
+ * The routines of the runtime page (see runtime.h), written only if it can be
+ * reached: each accesses guest memory as the emulator's does (faulting at the
+ * first byte outside it, with the PC left at the entry), and returns its
+ * result in x0 - a write to translated instructions is reported as unsupported
+ */
+static const char runtimeCalls[] =
+    "static bool check_range(uint64_t address, uint64_t length) {\n"
+    "    if (address >= MEMORY_SIZE && length > 0) {\n"
+    "        fault_address = address;\n"
+    "        return false;\n"
+    "    }\n"
+    "    if (length > MEMORY_SIZE - address) {\n"
+    "        fault_address = MEMORY_SIZE;\n"
+    "        return false;\n"
+    "    }\n"
+    "    return true;\n"
+    "}\n"
+    "\n"
+    "static bool runtime_call(uint64_t pc, uint64_t *result, uint64_t first, uint64_t second,\n"
+    "        uint64_t length) {\n"
+    "    *result = first;\n"
+    "    switch ((pc - RUNTIME_PAGE) / 4) {\n"
+    "        case RUNTIME_MEMCPY:\n"
+    "            if (!check_range(second, length) || !check_range(first, length)) {\n"
+    "                return false;\n"
+    "            }\n"
+    "            memmove(memory + first, memory + second, length);\n"
+    "            check_code(first, length, pc);\n"
+    "            return true;\n"
+    "        case RUNTIME_MEMSET:\n"
+    "            if (!check_range(first, length)) {\n"
+    "                return false;\n"
+    "            }\n"
+    "            memset(memory + first, (uint8_t) second, length);\n"
+    "            check_code(first, length, pc);\n"
+    "            return true;\n"
+    "        case RUNTIME_MEMCMP: {\n"
+    "            if (!check_range(first, length) || !check_range(second, length)) {\n"
+    "                return false;\n"
+    "            }\n"
+    "            uint64_t i = 0;\n"
+    "            while (i < length && memory[first + i] == memory[second + i]) {\n"
+    "                i++;\n"
+    "            }\n"
+    "            *result = i == length ? 0 : (uint64_t) ((int64_t) memory[first + i] - memory[second + i]);\n"
+    "            return true;\n"
+    "        }\n"
+    "        default: {\n"
+    "            if (!check_range(first, 1)) {\n"
+    "                return false;\n"
+    "            }\n"
+    "            uint8_t *end = memchr(memory + first, 0, MEMORY_SIZE - first);\n"
+    "            if (end == NULL) {\n"
+    "                fault_address = MEMORY_SIZE;\n"
+    "                return false;\n"
+    "            }\n"
+    "            *result = end - (memory + first);\n"
+    "            return true;\n"
+    "        }\n"
+    "    }\n"
+    "}\n";
+
+/**
+ * Lowers every word of the image into a micro-op (undefined words are nops)
+ */
+static void lower_image(Translation *);
+
+/**
+ * Marks the words reachable from address 0 by falling through or branching,
+ * and the words which are branched to
+ */
+static void find_reachable(Translation *);
+
+/**
+ * Marks a word at a given address as reachable (and as a target, if it is
+ * branched to), pushing it onto a worklist if it was not reachable yet
+ * Addresses beyond the image are ignored
+ */
+static void reach(Translation *, uint64_t, bool, uint64_t *, uint64_t *);
+
+/**
+ * Writes the image tables: the non-zero words of the image, and the address
+ * ranges of the translated words
+ */
+static void emit_tables(Translation *);
+
+/**
+ * Writes the main function - the translated instructions, followed by the
+ * dispatch of computed branches, the exit from the translated code, the fault
+ * handler and the final output
+ */
+static void emit_main(Translation *);
+
+/**
+ * Writes an expression which reads a register in a given bit width
+ */
+static void emit_read(Translation *, int, uint32_t);
+
+/**
+ * Writes the start of a statement which writes a register in a given bit width
+ * (the caller writes the value, then ");")
+ */
+static void emit_write(Translation *, int, uint32_t);
+
+/**
+ * Writes a jump to a given address: a goto if it is translated, otherwise an
+ * exit from the translated code
+ */
+static void emit_jump(Translation *, uint64_t);
+
+/**
+ * Returns the C expression of a condition code over the flag variables
+ */
+static const char *get_condition(uint8_t);
+
+int translate_image(uint8_t *memory, int image_size, FILE *out) {
+    Translation translation = {
+        .out = out,
+        .memory = memory,
+        .num_words = (image_size + INSTR_BYTES - 1) / INSTR_BYTES,
+    };
+    // Allocates at least one entry, so that an empty image translates too
+    uint64_t entries = translation.num_words + 1;
+    translation.ops = calloc(entries, sizeof(MicroOp));
+    translation.reachable = calloc(entries, sizeof(bool));
+    translation.target = calloc(entries, sizeof(bool));
+    int result = -1;
+    if (translation.ops != NULL && translation.reachable != NULL && translation.target != NULL) {
+        lower_image(&translation);
+        find_reachable(&translation);
+        fputs(header, out);
+        fprintf(out, "\n#define MEMORY_SIZE %d\n", MEMORY_SIZE);
+        fprintf(out, "#define CODE_END %lu\n\n", translation.num_words * INSTR_BYTES);
+        emit_tables(&translation);
+        fprintf(out, "\n%s\n", runtime);
+        if (translation.dynamic) {
+            fprintf(out, "#define RUNTIME_PAGE 0x%x\n", RUNTIME_PAGE);
+            fprintf(out, "#define RUNTIME_END 0x%x\n", RUNTIME_PAGE + NUM_RUNTIME_CALLS * INSTR_BYTES);
+            fprintf(out, "#define RUNTIME_MEMCPY %d\n", RUNTIME_MEMCPY);
+            fprintf(out, "#define RUNTIME_MEMSET %d\n", RUNTIME_MEMSET);
+            fprintf(out, "#define RUNTIME_MEMCMP %d\n\n", RUNTIME_MEMCMP);
+            fprintf(out, "%s\n", runtimeCalls);
+        }
+        emit_main(&translation);
+        result = ferror(out) ? -1 : 0;
+    }
+    free(translation.ops);
+    free(translation.reachable);
+    free(translation.target);
+    return result;
+}
+
+static void lower_image(Translation *translation) {
+    for (uint64_t i = 0; i < translation->num_words; i++) {
+        uint64_t address = i * INSTR_BYTES;
+        uint32_t instr = read_memory(BIT_MODE_32, translation->memory, address);
+        Instr decoded;
+        // The halt word is checked for when emitting, so it needs no micro-op
+        if (instr == NOP_PATTERN || instr == HALT_PATTERN || decode(instr, &decoded) != 0) {
+            translation->ops[i] = (MicroOp) { .handler = UOP_NOP };
+        } else {
+            lower_instr(&decoded, address, &translation->ops[i]);
+        }
+    }
+}
+
+static void find_reachable(Translation *translation) {
+    uint64_t *worklist = malloc((translation->num_words + 1) * sizeof(uint64_t));
+    if (worklist == NULL) {
+        // Without a worklist, every word is treated as reachable
+        translation->dynamic = true;
+    }
+    uint64_t length = 0;
+    if (worklist != NULL) {
+        reach(translation, 0, false, worklist, &length);
+    }
+    while (length > 0) {
+        uint64_t index = worklist[--length];
+        uint64_t address = index * INSTR_BYTES;
+        MicroOp *op = &translation->ops[index];
+        if (read_memory(BIT_MODE_32, translation->memory, address) == HALT_PATTERN) {
+            continue;
+        }
+        // A routine of the runtime page returns through x30, as a br does
+        if ((op->handler == UOP_B || op->handler == UOP_B_COND) && is_runtime_entry((int64_t) op->imm)) {
+            translation->dynamic = true;
+        }
+        switch (op->handler) {
+            case UOP_B:
+                reach(translation, (int64_t) op->imm, true, worklist, &length);
+                break;
+            case UOP_BR:
+                translation->dynamic = true;
+                break;
+            case UOP_B_COND:
+                reach(translation, (int64_t) op->imm, true, worklist, &length);
+                reach(translation, address + INSTR_BYTES, false, worklist, &length);
+                break;
+            default:
+                reach(translation, address + INSTR_BYTES, false, worklist, &length);
+                break;
+        }
+    }
+    free(worklist);
+
+    // A computed branch may jump to any word of the image
+    if (translation->dynamic) {
+        for (uint64_t i = 0; i < translation->num_words; i++) {
+            translation->target[i] = true;
+        }
+    }
+}
+
+static void reach(Translation *translation, uint64_t address, bool branched,
+        uint64_t *worklist, uint64_t *length) {
+    uint64_t index = address / INSTR_BYTES;
+    if (address % INSTR_BYTES != 0 || index >= translation->num_words) {
+        return;
+    }
+    translation->target[index] = translation->target[index] || branched;
+    if (!translation->reachable[index]) {
+        translation->reachable[index] = true;
+        worklist[(*length)++] = index;
+    }
+}
+
+static void emit_tables(Translation *translation) {
+    FILE *out = translation->out;
+    // Non-zero words of the image, as {address, word} pairs
+    fprintf(out, "static const uint32_t image[][2] = {");
+    int count = 0;
+    for (uint64_t i = 0; i < translation->num_words; i++) {
+        uint32_t word = read_memory(BIT_MODE_32, translation->memory, i * INSTR_BYTES);
+        if (word != 0) {
+            fprintf(out, "%s{0x%08lx, 0x%08x},", count % WORDS_PER_LINE == 0 ? "\n    " : " ",
+                i * INSTR_BYTES, word);
+            count++;
+        }
+    }
+    // An empty initialiser is not valid C, so an empty image writes 0 to 0
+    fprintf(out, "%s\n};\n\n", count == 0 ? "\n    {0, 0}," : "");
+
+    // Address ranges [start, end) of the translated words
+    fprintf(out, "static const uint32_t code[][2] = {\n");
+    count = 0;
+    for (uint64_t i = 0; i < translation->num_words; i++) {
+        if (translation->reachable[i] && (i == 0 || !translation->reachable[i - 1])) {
+            uint64_t end = i;
+            while (end < translation->num_words && translation->reachable[end]) {
+                end++;
+            }
+            fprintf(out, "    {0x%08lx, 0x%08lx},\n", i * INSTR_BYTES, end * INSTR_BYTES);
+            count++;
+        }
+    }
+    fprintf(out, "%s};\n", count == 0 ? "    {0, 0},\n" : "");
+}
+
+static void emit_main(Translation *translation) {
+    FILE *out = translation->out;
+    fprintf(out, "int main(int argc, char **argv) {\n");
+    fprintf(out, "    load_image();\n");
+    // Registers are 0, and the flags are {N, Z, C, V} = {0, 1, 0, 0}, as in
+    // the emulator
+    for (int i = 0; i < NUM_GENERAL_REGISTERS; i++) {
+        fprintf(out, "    uint64_t x%d = 0;\n", i);
+    }
+    fprintf(out, "    bool n = false, z = true, c = false, v = false;\n");
+    fprintf(out, "    uint64_t pc = 0;\n");
+    fprintf(out, "    int status = EXIT_SUCCESS;\n");
+
+    bool leader = true;
+    for (uint64_t i = 0; i < translation->num_words; i++) {
+        if (!translation->reachable[i] && !translation->dynamic) {
+            leader = true;
+            continue;
+        }
+        uint64_t address = i * INSTR_BYTES;
+        uint32_t instr = read_memory(BIT_MODE_32, translation->memory, address);
+        MicroOp *op = &translation->ops[i];
+
+        // Separates basic blocks, labelling those which are branched to
+        if (leader || translation->target[i]) {
+            fprintf(out, "\n");
+        }
+        if (translation->target[i]) {
+            fprintf(out, "block_%08lx:\n", address);
+        }
+        leader = instr == HALT_PATTERN || op->handler == UOP_B || op->handler == UOP_BR
+            || op->handler == UOP_B_COND;
+
+        fprintf(out, "    /* 0x%08lx: %s */ ", address,
+            instr == HALT_PATTERN ? "halt" : get_handler_name(op->handler));
+        // Words which only a computed branch reaches may be data, so stores to
+        // them are allowed - they are checked when they are executed instead
+        if (!translation->reachable[i]) {
+            fprintf(out, "if (read_word(memory, 0x%lx) != 0x%x) unsupported(0x%lx); ",
+                address, instr, address);
+        }
+        if (instr == HALT_PATTERN) {
+            fprintf(out, "pc = 0x%lx; goto halt;", address);
+        } else {
+            const EmitEntry *entry = &emitTable[op->handler];
+            assert(entry->func_ptr != NULL);
+            entry->func_ptr(translation, op, address, entry);
+        }
+        fprintf(out, "\n");
+    }
+
+    // Falls through past the last word of the image
+    fprintf(out, "\n    pc = CODE_END;\n    goto leave;\n");
+
+    // Computed branches jump to the translated word at their target
+    if (translation->dynamic) {
+        fprintf(out, "\ndispatch:\n    switch (pc) {\n");
+        for (uint64_t i = 0; i < translation->num_words; i++) {
+            fprintf(out, "        case 0x%lx: goto block_%08lx;\n", i * INSTR_BYTES, i * INSTR_BYTES);
+        }
+        fprintf(out, "        default: goto leave;\n    }\n");
+    }
+
+    // A routine of the runtime page runs, then returns to x30
+    fprintf(out, "\nleave:\n");
+    if (translation->dynamic) {
+        fprintf(out,
+            "    if (pc >= RUNTIME_PAGE && pc < RUNTIME_END && pc %% 4 == 0) {\n"
+            "        if (!runtime_call(pc, &x0, x0, x1, x2)) {\n"
+            "            goto fault;\n"
+            "        }\n"
+            "        pc = x%d;\n"
+            "        goto dispatch;\n"
+            "    }\n", RUNTIME_LINK_REGISTER);
+    }
+
+    // Execution beyond the image slides over zero words (nops) to the end of
+    // memory, where fetching faults
+    fprintf(out,
+        "    if (pc < MEMORY_SIZE) {\n"
+        "        if (pc < CODE_END || pc %% 4 != 0) {\n"
+        "            unsupported(pc);\n"
+        "        }\n"
+        "        for (; pc < MEMORY_SIZE; pc += 4) {\n"
+        "            if (read_word(memory, pc) != 0) {\n"
+        "                unsupported(pc);\n"
+        "            }\n"
+        "        }\n"
+        "    }\n"
+        "    fault_address = pc;\n"
+        "    goto fault;\n"
+        "\nfault:\n"
+        "    fprintf(stderr, \"Memory fault at address 0x%%lx (PC = 0x%%lx).\\n\", fault_address, pc);\n"
+        "    status = EXIT_FAILURE;\n"
+        "\nhalt: ;\n"
+        "    uint64_t registers[] = {");
+    for (int i = 0; i < NUM_GENERAL_REGISTERS; i++) {
+        fprintf(out, "%sx%d", i == 0 ? "" : ", ", i);
+    }
+    fprintf(out, "};\n"
+        "    if (write_output(argc, argv, registers, pc, n, z, c, v) != 0) {\n"
+        "        return EXIT_FAILURE;\n"
+        "    }\n"
+        "    return status;\n"
+        "}\n");
+}
+
+static void emit_arithmetic(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    fprintf(out, "{ uint%d_t op1 = ", w);
+    emit_read(translation, w, op->rn);
+    fprintf(out, "; uint%d_t op2 = ", w);
+    if (entry->shift == NULL) {
+        fprintf(out, "0x%x", (uint32_t) op->imm);
+    } else {
+        fprintf(out, "%s(%d, ", entry->shift, w);
+        emit_read(translation, w, op->rm);
+        fprintf(out, ", %d)", op->aux);
+    }
+    fprintf(out, "; uint%d_t result = op1 %s op2; %s(%d, op1, op2, result) ",
+        w, entry->operator, entry->flags, w);
+    emit_write(translation, w, op->rd);
+    fprintf(out, "result); }");
+}
+
+static void emit_logical(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    fprintf(out, "{ uint%d_t rn = ", w);
+    emit_read(translation, w, op->rn);
+    fprintf(out, "; uint%d_t op2 = %s(%d, ", w, entry->shift, w);
+    emit_read(translation, w, op->rm);
+    fprintf(out, ", %d); uint%d_t result = rn %s %sop2; ", op->aux, w, entry->operator,
+        entry->negate ? "~" : "");
+    if (entry->set_flags) {
+        fprintf(out, "n = SIGN_OF(%d, result); z = result == 0; c = false; v = false; ", w);
+    }
+    emit_write(translation, w, op->rd);
+    fprintf(out, "result); }");
+}
+
+static void emit_multiply(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    emit_write(translation, w, op->rd);
+    emit_read(translation, w, op->aux);
+    fprintf(out, " %s ", entry->operator);
+    emit_read(translation, w, op->rn);
+    fprintf(out, " * ");
+    emit_read(translation, w, op->rm);
+    fprintf(out, ");");
+}
+
+static void emit_wide_move(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    // The operand imm16 << shift is known, so only movk reads its register
+    uint64_t operand = (uint64_t) (uint32_t) op->imm << op->aux;
+    emit_write(translation, w, op->rd);
+    if (entry->opc == MOVZ_OPC) {
+        fprintf(out, "0x%lx", operand);
+    } else if (entry->opc == MOVN_OPC) {
+        fprintf(out, "~(uint64_t) 0x%lx", operand);
+    } else {
+        uint64_t mask = (((uint64_t) 1 << IMM16_LENGTH) - 1) << op->aux;
+        fprintf(out, "(");
+        emit_read(translation, w, op->rd);
+        fprintf(out, " & ~(uint64_t) 0x%lx) | 0x%lx", mask, operand);
+    }
+    fprintf(out, ");");
+}
+
+static void emit_transfer(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    // Mirrors the transfer handlers: the base register is read in the bit
+    // width of the transfer, and written back after the access
+    fprintf(out, "{ uint64_t base = ");
+    emit_read(translation, w, op->rn);
+    fprintf(out, "; uint64_t write_back = base + (uint64_t) %d; uint64_t transfer = ", op->imm);
+    if (entry->mode == UNSIGNED_OFFSET || entry->mode == PRE_INDEX) {
+        fprintf(out, "write_back");
+    } else if (entry->mode == REGISTER_OFFSET) {
+        fprintf(out, "base + ");
+        emit_read(translation, w, op->rm);
+    } else {
+        fprintf(out, "base");
+    }
+    fprintf(out, "; ");
+    if (entry->load) {
+        fprintf(out, "uint64_t value; if (!load(transfer, %d, &value)) FAULT(0x%lx); ",
+            w / CHAR_BIT, address);
+        emit_write(translation, w, op->rd);
+        fprintf(out, "value); ");
+    } else {
+        fprintf(out, "if (!store(transfer, %d, ", w / CHAR_BIT);
+        emit_read(translation, w, op->rd);
+        fprintf(out, ", 0x%lx)) FAULT(0x%lx); ", address, address);
+    }
+    if (entry->mode == PRE_INDEX || entry->mode == POST_INDEX) {
+        emit_write(translation, w, op->rn);
+        fprintf(out, "write_back); ");
+    }
+    fprintf(out, "}");
+}
+
+static void emit_load_literal(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    FILE *out = translation->out;
+    int w = entry->width;
+    fprintf(out, "{ uint64_t value; if (!load(0x%lx, %d, &value)) FAULT(0x%lx); ",
+        (uint64_t) (int64_t) op->imm, w / CHAR_BIT, address);
+    emit_write(translation, w, op->rd);
+    fprintf(out, "value); }");
+}
+
+static void emit_nop(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    fprintf(translation->out, ";");
+}
+
+static void emit_b(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    emit_jump(translation, (int64_t) op->imm);
+}
+
+static void emit_br(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    fprintf(translation->out, "pc = ");
+    emit_read(translation, BIT_SIZE_64, op->rn);
+    fprintf(translation->out, "; goto dispatch;");
+}
+
+static void emit_b_cond(Translation *translation, MicroOp *op, uint64_t address,
+        const EmitEntry *entry) {
+    fprintf(translation->out, "if (%s) ", get_condition(op->aux));
+    emit_jump(translation, (int64_t) op->imm);
+}
+
+static void emit_read(Translation *translation, int width, uint32_t index) {
+    if (index == ZERO_REG_INDEX) {
+        fprintf(translation->out, "(uint%d_t) %d", width, ZERO_REG_VAL);
+    } else {
+        fprintf(translation->out, "(uint%d_t) x%u", width, index);
+    }
+}
+
+static void emit_write(Translation *translation, int width, uint32_t index) {
+    // Writes to the zero register are discarded
+    if (index == ZERO_REG_INDEX) {
+        fprintf(translation->out, "(void) (");
+    } else {
+        fprintf(translation->out, "x%u = (uint%d_t) (", index, width);
+    }
+}
+
+static void emit_jump(Translation *translation, uint64_t target) {
+    uint64_t index = target / INSTR_BYTES;
+    if (target % INSTR_BYTES == 0 && index < translation->num_words
+            && translation->target[index]) {
+        fprintf(translation->out, "goto block_%08lx;", target);
+    } else {
+        fprintf(translation->out, "{ pc = 0x%lx; goto leave; }", target);
+    }
+}
+
+static const char *get_condition(uint8_t cond) {
+    switch (cond) {
+        case EQ:
+            return "z";
+        case NE:
+            return "!z";
+        case GE:
+            return "n == v";
+        case LT:
+            return "n != v";
+        case GT:
+            return "!z && n == v";
+        case LE:
+            return "!(!z && n == v)";
+        case AL:
+            return "true";
+        default:
+            // Assume valid condition code - should not reach this case
+            assert(0);
+            return "false";
+    }
+}
\ No newline at end of file
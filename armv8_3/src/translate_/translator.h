@@ -0,0 +1,19 @@
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Translates a binary image of a given size (loaded into memory) into the C
+ * source of a standalone program, which runs the guest with its registers as
+ * local variables and writes the same final state as the emulator
+ * Each basic block reachable from address 0 becomes a labelled run of C
+ * statements, with the semantics of the corresponding micro-op handlers, and
+ * a call to the runtime page (see runtime.h) runs its routine as in the
+ * emulator
+ * Returns 0 if success and -1 otherwise
+ */
+extern int translate_image(uint8_t *, int, FILE *);
+
+#endif
\ No newline at end of file